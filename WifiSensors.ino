@@ -8,11 +8,24 @@
 #define VALUES_PROCESSING_TIME 50
 #define SERVER_PROCESSING_TIME 100
 #define LOW_MEMORY 2000
+#define LOW_STACK_MEMORY 512
+#define MEMORY_CHECK_TIME 1000
+#define RESTART_DELAY 500
+#define TIME_CHECK_INTERVAL 1000
 #define STATUS_PIN 13
 
 #include "arduino_secrets.h"
+#include "src/WifiSensorsBackup.h"
+#include "src/WifiSensorsBinary.h"
+#include "src/WifiSensorsDeviceLog.h"
 #include "src/WifiSensorsDevices.h"
+#include "src/WifiSensorsEvents.h"
+#include "src/WifiSensorsLink.h"
+#include "src/WifiSensorsMetrics.h"
+#include "src/WifiSensorsPersist.h"
+#include "src/WifiSensorsScheduler.h"
 #include "src/WifiSensorsUtils.h"
+#include "src/WifiSensorsWebSocket.h"
 
 #include <algorithm>
 #include <FlashStorage.h>
@@ -20,15 +33,20 @@
 #include <WiFiNINA.h>
 #include <Wire.h>
 
-FlashStorage(conf_flash_store, ServerConfig);
-FlashStorage(pinout_flash_store, Pinout);
-FlashStorage(devices_flash_store, Devices);
+PersistFlash(conf_store, ServerConfig);
+PersistFlash(pinout_store, Pinout);
+PersistFlash(boot_store, uint32_t);
+DeviceLogFlash(devices_log);
 
 volatile RunningMode runMode = RUN_MODE_SERVER;
 volatile RunStatus runStatus = RUN_STATUS_BOOT;
 volatile bool runStatuChanged = false;
 int status = WL_IDLE_STATUS;
 bool restatPending = false;
+bool clientServed = false;
+bool lowStackWarned = false;
+unsigned long lastMemoryCheck = 0;
+unsigned long lastTimeCheck = 0;
 unsigned long then;
 String currentLine;
 String requestPath;
@@ -36,53 +54,137 @@ String requestPath;
 Pinout pinout;
 Devices devices;
 Array<DevicesValues, WS_MAX_DEVICES> devicesValues;
-
-// devices specific
-Bounce *debouncers[WS_MAX_DEVICES];
-DHT_Unified *dht22s[WS_MAX_DEVICES];
-DallasTemperature *dallasTemp[WS_MAX_DEVICES];
-DeviceAddress dallasDeviceAddress[WS_MAX_DEVICES];
-uint16_t dallasConversionTime[WS_MAX_DEVICES];
-unsigned long dallasLastTempMeasurement[WS_MAX_DEVICES];
-// end devices specific
+ValueHistory devicesHistory[WS_MAX_DEVICES][WS_MAX_DEVICE_VALUES];
+PollScheduler pollScheduler;
+LoopProfile loopProfile;
+DeviceProfile devicesProfile[WS_MAX_DEVICES];
+Metrics metrics;
+
+// GET /?since=..&wait=.. requests waiting for value changes
+typedef struct
+{
+  bool waiting;
+  WiFiClient client;
+  uint32_t since;
+  unsigned long start;
+  unsigned long wait;
+  BinaryFormat format;
+} LongPoll;
+
+LongPoll longPolls[WS_LONGPOLL_CLIENTS];
+EventStream events;
+WebSockets webSockets;
+bool requestParked = false;
+
+// request headers kept in HttpRequest, others are skipped
+const char *const requestHeaders[] = {"Authorization", "Last-Event-ID", "Upgrade", "Sec-WebSocket-Key", "Accept", "Content-Type"};
 
 ServerStats stats;
 ServerConfig serverConfig;
+uint32_t bootCount = 0;
 String authHeader;
 WiFiClient wifiClient;
 WiFiServer server(WS_SERVER_PORT);
 
 void setup()
 {
+  WifiSensorsUtils::paintStack();
+  profileReset(loopProfile);
+  setupMetrics();
+  persistInit(conf_store, "config", serverConfig, &stats);
+  persistInit(pinout_store, "pinout", pinout, &stats);
+  devlogInit(devices_log, "devices", devices, &stats);
+  persistInit(boot_store, "boot", bootCount, &stats);
+  countBoot();
+
   factoryReset();
+  bootPhase(BOOT_PHASE_RESET_CHECK);
 
   setupSerial();
 
+  // association runs on NINA while pins and devices are set up
+  if (!startNetwork())
+  {
+    networkError();
+  }
+  bootPhase(BOOT_PHASE_WIFI_START);
+
   setupPins();
+  bootPhase(BOOT_PHASE_PINS);
 
   Wire.begin();
 
   setupDevices();
+  bootPhase(BOOT_PHASE_DEVICES);
+
+  if (!connectNetwork())
+  {
+    networkError();
+  }
+  bootPhase(BOOT_PHASE_WIFI_CONNECTED);
+
+  startServer();
+  bootPhase(BOOT_PHASE_SERVER);
+}
+
+// boot counter is the epoch of value change cursors, it is written later by handlePersist (or before first cursor
+// goes out), so a boot loop does not erase flash on every boot
+void countBoot()
+{
+  persistLoad(boot_store);
+  bootCount++;
+  persistChanged(boot_store);
+  valueSeqBoot(bootCount);
+}
+
+// cursor of this boot must not be handed out again by a boot which did not store the counter
+void commitBootEpoch()
+{
+  persistCommit(boot_store);
+}
 
-  setupServer();
+void bootPhase(BootPhase phase)
+{
+  stats.boot[phase] = millis();
 }
 
 void loop()
 {
+#if WS_ALLOC_CHECK
+  unsigned long heapOps = WifiSensorsUtils::heapOperations();
+#endif
+  unsigned long loopStart = micros();
+  unsigned long stageStart = loopStart;
+
   showRunStatus();
+  stageStart = profileStage(loopProfile, LOOP_STAGE_STATUS, stageStart);
 
   checkWifiStatus();
+  stageStart = profileStage(loopProfile, LOOP_STAGE_WIFI, stageStart);
 
   restart(false, 0);
+  stageStart = profileStage(loopProfile, LOOP_STAGE_RESTART, stageStart);
 
   handleInputDevices();
+  stageStart = profileStage(loopProfile, LOOP_STAGE_DEVICES, stageStart);
 
   handleSerwer();
+  stageStart = profileStage(loopProfile, LOOP_STAGE_SERVER, stageStart);
 
   handleMemory();
+  stageStart = profileStage(loopProfile, LOOP_STAGE_MEMORY, stageStart);
+
+  handlePersist();
+  profileStage(loopProfile, LOOP_STAGE_PERSIST, stageStart);
+
+  profileLoop(loopProfile, loopStart);
+
+#if WS_ALLOC_CHECK
+  checkAllocations(heapOps);
+#endif
 }
 
-void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX_DEVICE_PINS> &pins, long pollInterval, Hashtable<String, String> *config)
+void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX_DEVICE_PINS> &pins, long pollInterval, Form *config)
 {
   WifiSensorsUtils::sendHeader("200 OK", "application/json");
 
@@ -130,7 +232,8 @@ void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX
       return;
     }
 
-    if ((t == 'D' && pinout.used[pin]) || (t == 'A' && pinout.used[WS_DIGITAL_PINS + pin]))
+    bool sharedBus = deviceSharedPin(devices, deviceType, t, pin);
+    if (!sharedBus && ((t == 'D' && pinout.used[pin]) || (t == 'A' && pinout.used[WS_DIGITAL_PINS + pin])))
     {
       String msg = String("pin already in use: ") + t + pin;
       WifiSensorsUtils::WifiSensorsUtils::sendError(msg);
@@ -144,8 +247,10 @@ void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX
     dev.pins[i] = dpin;
   }
 
-  if (!WifiSensorsUtils::isCallbackUrlValid(config, dev.pushCallback, true))
+  const char *error = WifiSensorsUtils::parseCallbackUrl(config, dev.pushCallback);
+  if (error != NULL)
   {
+    WifiSensorsUtils::sendError(error);
     return;
   }
 
@@ -162,7 +267,7 @@ void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX
 
   setupNewDevice(dev.deviceId, true);
 
-  devices_flash_store.write(devices);
+  devlogChanged(devices_log, WS_DEVLOG_META);
 
   wifiClient.println();
   wifiClient.print("{\"status\":\"ok\",\"device\":");
@@ -171,36 +276,93 @@ void addDevice(DeviceType deviceType, byte requiredPins, Array<DevicePin, WS_MAX
   wifiClient.println();
 }
 
+void checkAllocations(unsigned long heapOpsBefore)
+{
+  // steady state only, requests are allowed to allocate
+  if (clientServed || millis() < WS_ALLOC_CHECK_WARMUP)
+  {
+    return;
+  }
+
+  stats.allocLoops++;
+  unsigned long ops = WifiSensorsUtils::heapOperations() - heapOpsBefore;
+  if (ops > 0)
+  {
+    stats.allocFailures++;
+    stats.allocLastOps = ops;
+    Serial.print(F("ALLOC CHECK FAILED, heap operations in loop: "));
+    Serial.println(ops);
+  }
+}
+
 void checkWifiStatus()
 {
+  switch (linkPoll(stats.link, runMode == RUN_MODE_AP, millis()))
+  {
+  case LINK_EVENT_AP_CLIENT_CONNECTED:
+    Serial.println(F("Urządzenie połączone z AP"));
+    break;
+  case LINK_EVENT_AP_CLIENT_DISCONNECTED:
+    Serial.println(F("Urządzenie rozłączone z AP"));
+    break;
+  case LINK_EVENT_UP:
+    Serial.print(F("Wifi connection restored in ms: "));
+    Serial.println(stats.link.connectTime);
+    break;
+  case LINK_EVENT_DOWN:
+    Serial.println(F("Wifi connection lost, reconnecting"));
+    linkReconnectStart(stats.link, stats.link.lostSince);
+    break;
+  default:
+    break;
+  }
+  status = stats.link.status;
+
   if (runMode == RUN_MODE_AP)
   {
-    if (status != WiFi.status())
-    {
-      status = WiFi.status();
+    return;
+  }
 
-      if (status == WL_AP_CONNECTED)
-      {
-        Serial.println(F("Urządzenie połączone z AP"));
-      }
-      else
-      {
-        Serial.println(F("Urządzenie rozłączone z AP"));
-      }
-    }
+  if (!linkReconnect(stats.link, serverConfig, millis()))
+  {
+    Serial.println(F("Wifi reconnect failed, restarting"));
+    restart(true, 0);
   }
-  else
+
+  // network time is not ready right after connection, take it when it is
+  if (stats.wifiConnectionTime == 0 && status == WL_CONNECTED && millis() - lastTimeCheck >= TIME_CHECK_INTERVAL)
   {
-    status = WifiSensorsUtils::waitForWiFiStatus();
-    if (status == WL_CONNECT_FAILED || status == WL_CONNECTION_LOST || status == WL_DISCONNECTED)
-    {
-      Serial.println(F("Wifi connection failed, restarting in 10 sec"));
-      restart(true, 10000);
-    }
+    lastTimeCheck = millis();
+    stats.wifiConnectionTime = WiFi.getTime();
   }
 }
 
+// answers waiting request with values changed since its sequence, current client is kept
+void answerLongPoll(byte i)
+{
+  WiFiClient current = wifiClient;
+  wifiClient = longPolls[i].client;
+  longPolls[i].waiting = false;
+  sendValues(longPolls[i].since, longPolls[i].format);
+  delay(10);
+  wifiClient.stop();
+  wifiClient = current;
+}
+
+void commitStores()
+{
+  persistCommit(conf_store);
+  persistCommit(pinout_store);
+  devlogCommit(devices_log);
+}
+
 bool configureNetwork()
+{
+  return startNetwork() && connectNetwork();
+}
+
+// loads config and starts AP or association without waiting for it
+bool startNetwork()
 {
   if (WiFi.status() == WL_NO_MODULE)
   {
@@ -217,21 +379,18 @@ bool configureNetwork()
   snprintf(stats.macStr, sizeof(stats.macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
            mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
 
-  serverConfig = conf_flash_store.read();
+  persistLoad(conf_store);
   authHeader = String(serverConfig.serverauth);
 
   if (!serverConfig.set)
   {
-    if (SECRET_SSID != "")
+    if (SECRET_SSID[0] != '\0')
     {
-      String ssid = String(SECRET_SSID);
-      String pass = String(SECRET_PASS);
-      String serverauth = String(SECRET_SERVER_AUTH);
       Callback callback;
       callback.set = false;
-      WifiSensorsUtils::writeServerConfig(serverConfig, ssid, pass, serverauth, callback);
-      authHeader = serverauth;
-      conf_flash_store.write(serverConfig);
+      WifiSensorsUtils::writeServerConfig(serverConfig, SECRET_SSID, SECRET_PASS, SECRET_SERVER_AUTH, callback);
+      authHeader = String(SECRET_SERVER_AUTH);
+      persistChanged(conf_store);
     }
     else
     {
@@ -257,33 +416,47 @@ bool configureNetwork()
         }
       }
 
-      // wait 10 seconds for connection:
-      delay(10000);
+      linkInit(stats.link, status, millis());
     }
   }
 
   if (runMode == RUN_MODE_SERVER)
   {
-    for (int i = 0; i < 6; i++)
+    Serial.print(F("Próba połączenia z siecią Wi-Fi: "));
+    Serial.println(serverConfig.ssid);
+    unsigned long start = millis();
+    linkReconnectStart(stats.link, start);
+    linkBegin(stats.link, serverConfig, start);
+  }
+  return true;
+}
+
+// waits for association started by startNetwork, falls back to AP mode or restart when it fails
+bool connectNetwork()
+{
+  if (runMode == RUN_MODE_SERVER)
+  {
+    status = WiFi.status();
+    while (status != WL_CONNECTED && millis() - stats.link.reconnectStart < WS_LINK_CONNECT_TIMEOUT)
     {
-      Serial.print(F("Próba połączenia z siecią Wi-Fi: "));
-      Serial.println(serverConfig.ssid);
-      status = WiFi.begin(serverConfig.ssid, serverConfig.pass);
-      if (status == WL_CONNECTED)
-      {
+      linkReconnect(stats.link, serverConfig, millis());
+      delay(WS_LINK_DOWN_CHECK_INTERVAL);
+      status = WiFi.status();
+    }
 
-        if (!serverConfig.valid)
-        {
-          serverConfig.valid = true;
-          conf_flash_store.write(serverConfig);
-        }
-        setRunStatus(RUN_STATUS_OK);
-        delay(5000);
-        stats.wifiConnectionTime = WiFi.getTime();
-        Serial.println(stats.wifiConnectionTime + millis() / 1000);
-        return true;
+    if (status == WL_CONNECTED)
+    {
+      if (!serverConfig.valid)
+      {
+        serverConfig.valid = true;
+        persistChanged(conf_store);
       }
-      delay(5000);
+      setRunStatus(RUN_STATUS_OK);
+      linkConnected(stats.link, millis());
+      linkInit(stats.link, status, millis());
+      Serial.print(F("Połączono w ms: "));
+      Serial.println(stats.link.connectTime);
+      return true;
     }
 
     // if not connected switch back to AP mode
@@ -293,7 +466,7 @@ bool configureNetwork()
     {
       runMode = RUN_MODE_AP;
       serverConfig.set = false;
-      conf_flash_store.write(serverConfig);
+      persistChanged(conf_store);
       setRunStatus(RUN_STATUS_ERROR);
     }
 
@@ -314,11 +487,12 @@ void factoryReset()
     {
       Serial.println(F("FACTORY RESET!"));
       serverConfig.set = false;
-      conf_flash_store.write(serverConfig);
+      persistChanged(conf_store);
       pinout.set = false;
-      pinout_flash_store.write(pinout);
+      persistChanged(pinout_store);
       devices.set = false;
-      devices_flash_store.write(devices);
+      devlogChanged(devices_log, WS_DEVLOG_META);
+      commitStores();
       restart(true, 3000);
     }
   }
@@ -332,49 +506,67 @@ void handleInputDevices()
 {
   then = millis();
 
-  for (byte i = 0; i < devices.count; i++)
+  byte deviceId;
+  while (schedulerNext(pollScheduler, then, deviceId))
   {
-    Device *dev = &(devices.devices[i]);
-
-    if (!dev->active || dev->pollInterval == -1 || deviceIsOutput(dev->type))
+    if (deviceId >= devices.count)
     {
+      schedulerRemove(pollScheduler, deviceId);
       continue;
     }
-    if (dev->pollInterval == 0 || ((devicesValues[dev->deviceId].lastPoll + dev->pollInterval) < then))
+    Device *dev = &(devices.devices[deviceId]);
+
+    // keep poll cadence, skip polls missed while busy; devices polled on every loop wait for next one
+    unsigned long due = pollScheduler.due[deviceId] + dev->pollInterval;
+    if (dev->pollInterval == 0)
+    {
+      due = then + 1;
+    }
+    else if (!schedulerBefore(then, due))
+    {
+      due = then + dev->pollInterval;
+    }
+    schedulerAdd(pollScheduler, deviceId, due);
+
+    devicesValues[dev->deviceId].lastPoll = then;
+    byte warnCnt = 0;
+    bool push = false;
+    DeviceProfile &profile = devicesProfile[deviceId];
+    const DeviceDriver *driver = deviceDriver(dev->type);
+    if (driver != NULL)
     {
-      devicesValues[dev->deviceId].lastPoll = then;
-      byte warnCnt = 0;
-      switch (dev->type)
+      unsigned long start = micros();
+      warnCnt += driver->poll(dev, &stats, push);
+      histogramAdd(profile.read, micros() - start);
+      if (warnCnt > 0)
       {
-      case DEVICE_BUTTON:
-        warnCnt += readButton(dev, &stats);
-        break;
-      case DEVICE_DHT22:
-        warnCnt += readDHT22(dev, &stats);
-        break;
-      case DEVICE_GENERIC_ANALOG_INPUT:
-        warnCnt += readAnalog(dev, &stats);
-        break;
-      case DEVICE_GENERIC_DIGITAL_INPUT:
-        warnCnt += readDigital(dev, &stats);
-        break;
-      case DEVICE_MOTION:
-        warnCnt += readMotion(dev, &stats);
-        break;
-      case DEVICE_SWITCH:
-        warnCnt += readSwitch(dev, &stats);
-        break;
-      case DEVICE_TEMP_DALLAS:
-        warnCnt += readTempDallas(dev, &stats);
-        break;
+        profile.readFailures++;
       }
+    }
 
-      if (warnCnt > 0)
+    if (push && dev->pushCallback.set && !stats.link.down)
+    {
+      unsigned long start = micros();
+      byte pushWarnCnt = devicePush(dev);
+      histogramAdd(profile.push, micros() - start);
+      if (pushWarnCnt > 0)
       {
-        stats.processingWarnings += warnCnt;
-        WifiSensorsUtils::processWarning(serverConfig.callback, stats);
+        profile.pushFailures++;
+        warnCnt += pushWarnCnt;
       }
     }
+
+    if (warnCnt > 0)
+    {
+      stats.processingWarnings += warnCnt;
+      WifiSensorsUtils::processWarning(serverConfig.callback, stats);
+    }
+
+    if (millis() - then > VALUES_PROCESSING_TIME)
+    {
+      // rest of due devices in next loop
+      break;
+    }
   }
 
   unsigned long took = millis() - then;
@@ -388,7 +580,22 @@ void handleInputDevices()
 
 bool handleDelete(HttpRequest &req)
 {
-  if (req.path == "/device")
+  if (req.path == "/profile")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
+    profileReset(loopProfile);
+    for (byte i = 0; i < WS_MAX_DEVICES; i++)
+    {
+      deviceProfileReset(devicesProfile[i]);
+    }
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    WifiSensorsUtils::sendStatusOk();
+    return true;
+  }
+  else if (req.path == "/device")
   {
     String deviceId;
     if (!WifiSensorsUtils::readParam(req, "id", deviceId))
@@ -398,8 +605,8 @@ bool handleDelete(HttpRequest &req)
       return true;
     }
 
-    int id = deviceId.toInt();
-    if (id >= devices.count)
+    byte id;
+    if (!parseDeviceId(deviceId.c_str(), id))
     {
       WifiSensorsUtils::sendHeader("200 OK", "application/json");
       WifiSensorsUtils::sendError("device does not exist");
@@ -407,14 +614,22 @@ bool handleDelete(HttpRequest &req)
     }
 
     devices.devices[id].active = false;
-    devices_flash_store.write(devices);
+    devlogChanged(devices_log, id);
+    scheduleDevice(id);
+    deviceRelease(id);
 
     byte requiredPins = WifiSensorsUtils::deviceRequirePins(devices.devices[id].type);
     for (byte i = 0; i < requiredPins; i++)
     {
-      WifiSensorsUtils::unsetPinMode(pinout, devices.devices[id].pins[i]);
+      DevicePin dpin = devices.devices[id].pins[i];
+      if (deviceSharedPin(devices, devices.devices[id].type, dpin.type, dpin.pin))
+      {
+        // other sensors still on this bus
+        continue;
+      }
+      WifiSensorsUtils::unsetPinMode(pinout, dpin);
     }
-    pinout_flash_store.write(pinout);
+    persistChanged(pinout_store);
 
     WifiSensorsUtils::sendHeader("200 OK", "application/json");
     WifiSensorsUtils::sendStatusOk();
@@ -439,10 +654,17 @@ bool handleGet(HttpRequest &req)
       {
         return true;
       }
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      wifiClient.println();
-      sendDevicesValues();
-      wifiClient.println();
+      String param;
+      // cursor from before reboot, client gets all values
+      uint32_t since = 0;
+      bool resume = WifiSensorsUtils::readParam(req, "since", param) && valueSince(param.c_str(), since);
+      unsigned long wait = WifiSensorsUtils::readParam(req, "wait", param) ? strtoul(param.c_str(), NULL, 10) : 0;
+      if (wait > 0 && resume && since == valueSeq())
+      {
+        parkLongPoll(since, wait, requestFormat(req));
+        return true;
+      }
+      sendValues(since, requestFormat(req));
     }
     return true;
   }
@@ -453,12 +675,26 @@ bool handleGet(HttpRequest &req)
       return true;
     }
 
+    String format;
+    if (WifiSensorsUtils::readParam(req, "format", format) && format == "json")
+    {
+      wifiClient.println("HTTP/1.1 200 OK");
+      wifiClient.println("Content-Type: application/json");
+      wifiClient.println("Content-Disposition: attachment; filename=backup.json");
+      wifiClient.println();
+      WifiSensorsUtils::sendBackup(serverConfig, devices, devicesValues);
+      wifiClient.println();
+      return true;
+    }
+
     wifiClient.println("HTTP/1.1 200 OK");
     wifiClient.println("Content-Type: application/octet-stream");
     wifiClient.println("Content-Disposition: attachment; filename=backup.bin");
     wifiClient.println();
-    WifiSensorsUtils::sendBackup(serverConfig, devices, devicesValues);
-    wifiClient.println();
+    if (!backupWrite(wifiClient, serverConfig, pinout, devices))
+    {
+      Serial.println(F("Backup section too large!"));
+    }
     return true;
   }
   else if (req.path == "/config")
@@ -481,8 +717,15 @@ bool handleGet(HttpRequest &req)
     {
       return true;
     }
-    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    BinaryFormat format = requestFormat(req);
+    WifiSensorsUtils::sendHeader("200 OK", binaryContentTypes[format]);
     wifiClient.println();
+    if (format != BINARY_NONE)
+    {
+      BinaryWriter out(wifiClient, format);
+      binaryDevices(out, devices, devicesValues);
+      return true;
+    }
     WifiSensorsUtils::sendDevices(devices, devicesValues, true, false);
     wifiClient.println();
     wifiClient.println();
@@ -500,142 +743,352 @@ bool handleGet(HttpRequest &req)
     wifiClient.println();
     return true;
   }
-  else if (req.path == "/pinout")
+  else if (req.path == "/history")
   {
     if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
       return true;
     }
-    WifiSensorsUtils::sendHeader("200 OK", "application/json");
-    wifiClient.println();
-    WifiSensorsUtils::sendPinout(pinout);
+    String deviceId;
+    byte id;
+    if (!WifiSensorsUtils::readParam(req, "id", deviceId) || !parseDeviceId(deviceId.c_str(), id))
+    {
+      WifiSensorsUtils::sendHeader("200 OK", "application/json");
+      WifiSensorsUtils::sendError("device does not exist");
+      return true;
+    }
+    String from, res;
+    WifiSensorsUtils::readParam(req, "from", from);
+    // anything but canonical 0, 60 or 900 is rejected, toInt() alone would read it as raw
+    if (WifiSensorsUtils::readParam(req, "res", res) && (String(res.toInt()) != res || !historyResValid(res.toInt())))
+    {
+      WifiSensorsUtils::sendHeader("400 Bad Request", "application/json");
+      WifiSensorsUtils::sendError("res must be 0, 60 or 900");
+      return true;
+    }
+
+    WifiSensorsUtils::sendHeader("200 OK", "text/csv");
     wifiClient.println();
+    WifiSensorsUtils::sendHistory(devices.devices[id], devicesValues[id], devicesHistory[id], from.toInt(), res.toInt());
     wifiClient.println();
     return true;
   }
-  else if (req.path == "/status")
+#if WS_DRIVER_TEMP_DALLAS
+  else if (req.path == "/onewire")
   {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
     WifiSensorsUtils::sendHeader("200 OK", "application/json");
     wifiClient.println();
-    String status;
-    WifiSensorsUtils::getStatusStr(status, &stats);
-    wifiClient.println(status);
+    sendDallasBuses();
     wifiClient.println();
     return true;
   }
-  else if (req.path == "/pinsvalues")
+#endif
+  else if (req.path == "/pinout")
   {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
     WifiSensorsUtils::sendHeader("200 OK", "application/json");
     wifiClient.println();
-    WifiSensorsUtils::sendPinsValues();
+    WifiSensorsUtils::sendPinout(pinout);
+    wifiClient.println();
+    wifiClient.println();
+    return true;
   }
-
-  return false;
-}
-
-bool handlePost(HttpRequest &req, String &payload)
-{
-  if (req.path == "/config")
+  else if (req.path == "/events")
   {
     if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
       return true;
     }
-    WifiSensorsUtils::sendHeader("200 OK", "application/json");
-
-    Hashtable<String, String> config;
-    WifiSensorsUtils::parseConfigFromPayload(payload, &config);
-
-    String deviceId;
-    if (!WifiSensorsUtils::readParam(req, "id", deviceId))
+    String lastEventId;
+    // resume from before reboot, client gets all values
+    uint32_t since = 0;
+    if (WifiSensorsUtils::readHeader(req, "Last-Event-ID", lastEventId))
     {
-      if (handleServerConfig(&config))
-      {
-        WifiSensorsUtils::sendStatusOk();
-      }
-      else
-      {
-        WifiSensorsUtils::sendError("Server config invalid!");
-      }
+      valueSince(lastEventId.c_str(), since);
     }
-    else
+    if (!eventsSubscribe(events, wifiClient, since))
     {
-      if (WifiSensorsUtils::isCallbackUrlValid(&config, devices.devices[deviceId.toInt()].pushCallback, true) && deviceConfigUpdated(&config, &devices.devices[deviceId.toInt()]))
-      {
-        devices_flash_store.write(devices);
-        WifiSensorsUtils::sendStatusOk();
-      }
-      else
-      {
-        WifiSensorsUtils::sendError("Device config invalid!");
-      }
+      WifiSensorsUtils::sendHeader("503 Service Unavailable", "application/json");
+      WifiSensorsUtils::sendError("too many subscribers");
+      return true;
     }
-
+    commitBootEpoch();
+    WifiSensorsUtils::sendHeader("200 OK", "text/event-stream");
+    wifiClient.println("Cache-Control: no-cache");
+    wifiClient.println();
+    wifiClient.print("retry: 2000\n\n");
+    requestParked = true;
+    // subscriber owns the socket now, global client must not write to or stop it
+    wifiClient = WiFiClient();
     return true;
   }
-  else if (req.path == "/creds")
+  else if (req.path == "/ws")
   {
-    WifiSensorsUtils::sendHeader("200 OK", "text/html");
-    wifiClient.println();
-    wifiClient.println("<html><body>");
-
-    Hashtable<String, String> config;
-    WifiSensorsUtils::parseConfigFromPayload(payload, &config);
-
-    if (handleServerConfig(&config))
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
-      wifiClient.println("Zapisano. Restart za 3 sekundy ...");
-      wifiClient.println("</html></body>");
-      wifiClient.println();
-
-      runMode = RUN_MODE_SERVER;
-      restart(true, 3000);
+      return true;
     }
-    else
+    String upgrade, key;
+    char accept[WS_WEBSOCKET_ACCEPT_LEN];
+    if (!WifiSensorsUtils::readHeader(req, "Upgrade", upgrade) || !upgrade.equalsIgnoreCase("websocket") ||
+        !WifiSensorsUtils::readHeader(req, "Sec-WebSocket-Key", key) || !wsAcceptKey(key.c_str(), accept))
     {
-      wifiClient.println("Bledne dane ...");
-      wifiClient.println("</html></body>");
-      wifiClient.println();
+      WifiSensorsUtils::sendHeader("400 Bad Request", "application/json");
+      WifiSensorsUtils::sendError("websocket upgrade expected");
+      return true;
     }
+    if (!wsAccept(webSockets, wifiClient, 0))
+    {
+      WifiSensorsUtils::sendHeader("503 Service Unavailable", "application/json");
+      WifiSensorsUtils::sendError("too many clients");
+      return true;
+    }
+    commitBootEpoch();
+    wifiClient.println("HTTP/1.1 101 Switching Protocols");
+    wifiClient.println("Upgrade: websocket");
+    wifiClient.println("Connection: Upgrade");
+    wifiClient.print("Sec-WebSocket-Accept: ");
+    wifiClient.println(accept);
+    wifiClient.println();
+    requestParked = true;
+    // WebSocket slot owns the socket now, global client must not write to or stop it
+    wifiClient = WiFiClient();
     return true;
   }
-  else if (req.path == "/device")
+  else if (req.path == "/metrics")
   {
     if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
       return true;
     }
-    if (devices.count == WS_MAX_DEVICES)
+    WifiSensorsUtils::sendHeader("200 OK", "text/plain; version=0.0.4");
+    wifiClient.println();
+    metricsSend(wifiClient, metrics, stats, devices, devicesProfile, devicesValues);
+    return true;
+  }
+  else if (req.path == "/profile")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("maximum number of devices added");
       return true;
     }
-
-    String deviceType;
-    if (!WifiSensorsUtils::readParam(req, "type", deviceType))
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    wifiClient.println();
+    WifiSensorsUtils::sendProfile(loopProfile, devices, devicesProfile);
+    wifiClient.println();
+    return true;
+  }
+  else if (req.path == "/stats")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("missing params: type");
       return true;
     }
-
-    String pinId;
-    String pinM;
-    Array<DevicePin, WS_MAX_DEVICE_PINS> pins;
-    DeviceType type = deviceTypeFromStr(deviceType);
-    byte requiredPins = WifiSensorsUtils::deviceRequirePins(type);
-    for (byte i = 0; i < requiredPins; i++)
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    wifiClient.println();
+    String deviceId;
+    if (WifiSensorsUtils::readParam(req, "id", deviceId))
     {
-      pinId = String("pin") + i;
-      pinM = String("pin") + i + "type";
-      if (WifiSensorsUtils::readParam(req, pinId.c_str(), pinId) && WifiSensorsUtils::readParam(req, pinM.c_str(), pinM))
+      byte id;
+      if (!parseDeviceId(deviceId.c_str(), id))
       {
-        DevicePin dpin;
-        dpin.pin = pinId.substring(1).toInt();
-        dpin.mode = pinModeFromStr(pinM);
-        dpin.type = pinId.substring(0, 1).charAt(0);
-        pins[i] = dpin;
+        WifiSensorsUtils::sendError("device does not exist");
+        return true;
+      }
+      WifiSensorsUtils::sendDeviceStats(devices.devices[id], devicesValues[id]);
+      wifiClient.println();
+    }
+    else
+    {
+      WifiSensorsUtils::sendDevicesStats(devices, devicesValues);
+    }
+    wifiClient.println();
+    return true;
+  }
+  else if (req.path == "/status")
+  {
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    wifiClient.println();
+    String status;
+    WifiSensorsUtils::getStatusStr(status, &stats);
+    wifiClient.println(status);
+    wifiClient.println();
+    return true;
+  }
+  else if (req.path == "/pinsvalues")
+  {
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    wifiClient.println();
+    WifiSensorsUtils::sendPinsValues();
+  }
+
+  return false;
+}
+
+// first body byte, not consumed, waits up to WS_BODY_TIMEOUT ms when body did not come with headers, -1 when there is none
+int peekBody()
+{
+  unsigned long start = millis();
+  while (!wifiClient.available() && wifiClient.connected() && millis() - start < WS_BODY_TIMEOUT)
+  {
+    delay(1);
+  }
+  return wifiClient.peek();
+}
+
+// binary backup is sent as application/octet-stream, curl --data-binary sends it as form, so body magic decides then
+bool restoreBinary(HttpRequest &req)
+{
+  String contentType;
+  if (WifiSensorsUtils::readHeader(req, "Content-Type", contentType) && contentType.startsWith("application/octet-stream"))
+  {
+    return true;
+  }
+  return peekBody() == WS_BACKUP_MAGIC[0];
+}
+
+// POST handlers reading body from client themselves, binary body must not go through readPayloadData
+bool handlePostStream(HttpRequest &req)
+{
+  if (req.path == "/restore" && restoreBinary(req))
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
+
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    restorePrepare();
+    const char *error = NULL;
+    bool restored = backupRead(wifiClient, serverConfig, pinout, devices, error);
+    if (restored)
+    {
+      authHeader = String(serverConfig.serverauth);
+      applyPins();
+      for (byte i = 0; i < devices.count; i++)
+      {
+        setupNewDevice(i, false);
+      }
+    }
+    restoreFinish(restored, error);
+    return true;
+  }
+  return false;
+}
+
+bool handlePost(HttpRequest &req, String &payload)
+{
+  if (req.path == "/commit")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
+    commitStores();
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    if (conf_store.stats.dirty || pinout_store.stats.dirty || devices_log.stats.dirty)
+    {
+      WifiSensorsUtils::sendError("flash commit failed");
+    }
+    else
+    {
+      WifiSensorsUtils::sendStatusOk();
+    }
+    return true;
+  }
+  else if (req.path == "/config")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+
+    Form config;
+    WifiSensorsUtils::parseConfigFromPayload(payload, &config);
+
+    String deviceId;
+    const char *error = applyConfig(&config, WifiSensorsUtils::readParam(req, "id", deviceId) ? deviceId.c_str() : NULL);
+    if (error == NULL)
+    {
+      WifiSensorsUtils::sendStatusOk();
+    }
+    else
+    {
+      WifiSensorsUtils::sendError(error);
+    }
+    return true;
+  }
+  else if (req.path == "/creds")
+  {
+    WifiSensorsUtils::sendHeader("200 OK", "text/html");
+    wifiClient.println();
+    wifiClient.println("<html><body>");
+
+    Form config;
+    WifiSensorsUtils::parseConfigFromPayload(payload, &config);
+
+    if (handleServerConfig(&config) == NULL)
+    {
+      wifiClient.println("Zapisano. Restart za 3 sekundy ...");
+      wifiClient.println("</html></body>");
+      wifiClient.println();
+
+      runMode = RUN_MODE_SERVER;
+      restart(true, 3000);
+    }
+    else
+    {
+      wifiClient.println("Bledne dane ...");
+      wifiClient.println("</html></body>");
+      wifiClient.println();
+    }
+    return true;
+  }
+  else if (req.path == "/device")
+  {
+    if (WifiSensorsUtils::statusAuthorizationForbidden(authHeader, req))
+    {
+      return true;
+    }
+    if (devices.count == WS_MAX_DEVICES)
+    {
+      WifiSensorsUtils::sendHeader("200 OK", "application/json");
+      WifiSensorsUtils::sendError("maximum number of devices added");
+      return true;
+    }
+
+    String deviceType;
+    if (!WifiSensorsUtils::readParam(req, "type", deviceType))
+    {
+      WifiSensorsUtils::sendHeader("200 OK", "application/json");
+      WifiSensorsUtils::sendError("missing params: type");
+      return true;
+    }
+
+    String pinId;
+    String pinM;
+    Array<DevicePin, WS_MAX_DEVICE_PINS> pins;
+    DeviceType type = deviceTypeFromStr(deviceType);
+    byte requiredPins = WifiSensorsUtils::deviceRequirePins(type);
+    for (byte i = 0; i < requiredPins; i++)
+    {
+      pinId = String("pin") + i;
+      pinM = String("pin") + i + "type";
+      if (WifiSensorsUtils::readParam(req, pinId.c_str(), pinId) && WifiSensorsUtils::readParam(req, pinM.c_str(), pinM))
+      {
+        DevicePin dpin;
+        dpin.pin = pinId.substring(1).toInt();
+        dpin.mode = pinModeFromStr(pinM);
+        dpin.type = pinId.substring(0, 1).charAt(0);
+        pins[i] = dpin;
       }
       else
       {
@@ -659,7 +1112,7 @@ bool handlePost(HttpRequest &req, String &payload)
       }
     }
 
-    Hashtable<String, String> config;
+    Form config;
     WifiSensorsUtils::parseConfigFromPayload(payload, &config);
     addDevice(type, requiredPins, pins, pollInterval, &config);
 
@@ -680,7 +1133,7 @@ bool handlePost(HttpRequest &req, String &payload)
       dpin.mode = pinModeFromStr(pinM);
       dpin.type = pinId.substring(0, 1).charAt(0);
       WifiSensorsUtils::setPinMode(pinout, dpin);
-      pinout_flash_store.write(pinout);
+      persistChanged(pinout_store);
 
       WifiSensorsUtils::sendHeader("200 OK", "application/json");
       WifiSensorsUtils::sendStatusOk();
@@ -700,24 +1153,9 @@ bool handlePost(HttpRequest &req, String &payload)
     }
 
     WifiSensorsUtils::sendHeader("200 OK", "application/json");
-    for (byte i = 0; i < WS_DIGITAL_PINS + WS_ANALOG_PINS; i++)
-    {
-      pinout.used[i] = false;
-    }
-    if (WifiSensorsUtils::restoreBackup(serverConfig, pinout, devices, devicesValues, payload, authHeader))
-    {
-      stats.devices = devices.count;
-      conf_flash_store.write(serverConfig);
-      pinout_flash_store.write(pinout);
-      devices_flash_store.write(devices);
-      WifiSensorsUtils::sendStatusOk();
-    }
-    else
-    {
-      WifiSensorsUtils::sendError("Backup invalid!");
-      // restart to re-read previous config
-      restart(true, 100);
-    }
+    payload = decode(payload);
+    restorePrepare();
+    restoreFinish(WifiSensorsUtils::restoreBackup(serverConfig, pinout, devices, devicesValues, payload, authHeader), "Backup invalid!");
     return true;
   }
   else if (req.path == "/set")
@@ -727,24 +1165,15 @@ bool handlePost(HttpRequest &req, String &payload)
       return true;
     }
     String pinId;
-    if (WifiSensorsUtils::readParam(req, "id", pinId))
+    const char *error = WifiSensorsUtils::readParam(req, "id", pinId) ? setPin(pinId.c_str(), HIGH) : "missing params: id";
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    if (error == NULL)
     {
-      if (WifiSensorsUtils::pinUsedByDevice(pinout, pinId))
-      {
-        String msg = String("pin is used by device");
-        WifiSensorsUtils::WifiSensorsUtils::sendError(msg);
-        return true;
-      }
-
-      WifiSensorsUtils::setPinValue(pinId.charAt(0), pinId.substring(1).toInt(), HIGH);
-
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
       WifiSensorsUtils::sendStatusOk();
     }
     else
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("missing params: id");
+      WifiSensorsUtils::sendError(error);
     }
     return true;
   }
@@ -755,36 +1184,15 @@ bool handlePost(HttpRequest &req, String &payload)
       return true;
     }
     String deviceId;
-    if (WifiSensorsUtils::readParam(req, "id", deviceId))
+    const char *error = WifiSensorsUtils::readParam(req, "id", deviceId) ? turnDevice(deviceId.c_str(), false) : "missing params: id";
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    if (error == NULL)
     {
-      byte id = deviceId.toInt();
-      if (devices.devices[id].active && (devices.devices[id].type == DEVICE_RELAY || devices.devices[id].type == DEVICE_BUTTON))
-      {
-        DevicePin dpin = devices.devices[id].pins[0];
-        devicesValues[id].values[0] = "off";
-
-        if (devices.devices[id].config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x0)
-        {
-          WifiSensorsUtils::setPinValue(dpin.type, dpin.pin, HIGH);
-        }
-        else
-        {
-          WifiSensorsUtils::setPinValue(dpin.type, dpin.pin, LOW);
-        }
-
-        WifiSensorsUtils::sendHeader("200 OK", "application/json");
-        WifiSensorsUtils::sendStatusOk();
-      }
-      else
-      {
-        WifiSensorsUtils::sendHeader("200 OK", "application/json");
-        WifiSensorsUtils::sendError("wrong device type");
-      }
+      WifiSensorsUtils::sendStatusOk();
     }
     else
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("missing params: id");
+      WifiSensorsUtils::sendError(error);
     }
     return true;
   }
@@ -795,35 +1203,15 @@ bool handlePost(HttpRequest &req, String &payload)
       return true;
     }
     String deviceId;
-    if (WifiSensorsUtils::readParam(req, "id", deviceId))
+    const char *error = WifiSensorsUtils::readParam(req, "id", deviceId) ? turnDevice(deviceId.c_str(), true) : "missing params: id";
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    if (error == NULL)
     {
-      byte id = deviceId.toInt();
-      if (devices.devices[id].active && (devices.devices[id].type == DEVICE_RELAY || devices.devices[id].type == DEVICE_BUTTON))
-      {
-        DevicePin dpin = devices.devices[id].pins[0];
-        devicesValues[id].values[0] = "on";
-        if (devices.devices[id].config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x0)
-        {
-          WifiSensorsUtils::setPinValue(dpin.type, dpin.pin, LOW);
-        }
-        else
-        {
-          WifiSensorsUtils::setPinValue(dpin.type, dpin.pin, HIGH);
-        }
-
-        WifiSensorsUtils::sendHeader("200 OK", "application/json");
-        WifiSensorsUtils::sendStatusOk();
-      }
-      else
-      {
-        WifiSensorsUtils::sendHeader("200 OK", "application/json");
-        WifiSensorsUtils::sendError("wrong device type");
-      }
+      WifiSensorsUtils::sendStatusOk();
     }
     else
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("missing params: id");
+      WifiSensorsUtils::sendError(error);
     }
     return true;
   }
@@ -834,24 +1222,15 @@ bool handlePost(HttpRequest &req, String &payload)
       return true;
     }
     String pinId;
-    if (WifiSensorsUtils::readParam(req, "id", pinId))
+    const char *error = WifiSensorsUtils::readParam(req, "id", pinId) ? setPin(pinId.c_str(), LOW) : "missing params: id";
+    WifiSensorsUtils::sendHeader("200 OK", "application/json");
+    if (error == NULL)
     {
-      if (WifiSensorsUtils::pinUsedByDevice(pinout, pinId))
-      {
-        String msg = String("pin is used by device");
-        WifiSensorsUtils::WifiSensorsUtils::sendError(msg);
-        return true;
-      }
-
-      WifiSensorsUtils::setPinValue(pinId.charAt(0), pinId.substring(1).toInt(), LOW);
-
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
       WifiSensorsUtils::sendStatusOk();
     }
     else
     {
-      WifiSensorsUtils::sendHeader("200 OK", "application/json");
-      WifiSensorsUtils::sendError("missing params: id");
+      WifiSensorsUtils::sendError(error);
     }
     return true;
   }
@@ -859,18 +1238,71 @@ bool handlePost(HttpRequest &req, String &payload)
   return false;
 }
 
+void handleEvents()
+{
+  eventsPump(events, devices, devicesValues, timeNow(stats));
+}
+
+void handleWebSockets()
+{
+  wsPump(webSockets, devices, devicesValues, webSocketCommand);
+}
+
+void handleLongPolls()
+{
+  unsigned long now = millis();
+  for (byte i = 0; i < WS_LONGPOLL_CLIENTS; i++)
+  {
+    LongPoll &poll = longPolls[i];
+    if (!poll.waiting)
+    {
+      continue;
+    }
+    if (!poll.client.connected())
+    {
+      poll.client.stop();
+      poll.waiting = false;
+    }
+    else if (valueSeq() != poll.since || now - poll.start >= poll.wait)
+    {
+      clientServed = true;
+      answerLongPoll(i);
+    }
+  }
+}
+
 void handleMemory()
 {
-  stats.freeMem = WifiSensorsUtils::memoryFree();
-  if (stats.freeMem < LOW_MEMORY)
+  if (millis() - lastMemoryCheck < MEMORY_CHECK_TIME)
+  {
+    return;
+  }
+  lastMemoryCheck = millis();
+
+  WifiSensorsUtils::heapStats(stats.heap);
+  stats.freeMem = stats.heap.stackGap;
+
+  if (stats.heap.stackLowWater < LOW_STACK_MEMORY && !lowStackWarned)
+  {
+    lowStackWarned = true;
+    stats.processingWarnings++;
+    WifiSensorsUtils::setWarning(stats, F("Low stack headroom: "), stats.heap.stackLowWater);
+    Serial.print(F("Low stack headroom: "));
+    Serial.println(stats.heap.stackLowWater);
+    WifiSensorsUtils::processWarning(serverConfig.callback, stats);
+  }
+
+  // largest free block is what next allocation can get, free memory split into small chunks does not help
+  if (stats.heap.largestFree < LOW_MEMORY)
   {
     stats.processingWarnings++;
-    stats.lastWarning = "Low memory: ";
-    stats.lastWarning += stats.freeMem;
-    stats.lastWarning += " ";
-    stats.lastWarning += timeNow(stats);
+    WifiSensorsUtils::setWarning(stats, F("Low memory: "), stats.heap.largestFree);
     Serial.print(F("Low memory: "));
-    Serial.println(stats.freeMem);
+    Serial.print(stats.heap.largestFree);
+    Serial.print(F(" free: "));
+    Serial.print(stats.heap.free);
+    Serial.print(F(" fragmentation: "));
+    Serial.println(stats.heap.fragmentation);
     WifiSensorsUtils::processWarning(serverConfig.callback, stats);
 
 #if LOW_MEMORY_RESTART
@@ -880,15 +1312,34 @@ void handleMemory()
   }
 }
 
+void handlePersist()
+{
+  unsigned long now = millis();
+  if (persistDue(conf_store.stats, now))
+  {
+    persistCommit(conf_store);
+  }
+  if (persistDue(boot_store.stats, now))
+  {
+    persistCommit(boot_store);
+  }
+  if (persistDue(pinout_store.stats, now))
+  {
+    persistCommit(pinout_store);
+  }
+  if (persistDue(devices_log.stats, now))
+  {
+    devlogCommit(devices_log);
+  }
+  devlogMaintain(devices_log);
+}
+
 void handleResponse(String &resp)
 {
   if (resp.indexOf(" 200 ") < 0)
   {
     stats.processingWarnings++;
-    stats.lastWarning = "Request error: ";
-    stats.lastWarning += resp;
-    stats.lastWarning += " ";
-    stats.lastWarning += timeNow(stats);
+    WifiSensorsUtils::setWarning(stats, F("Request error: "), resp.c_str());
     WifiSensorsUtils::processWarning(serverConfig.callback, stats);
   }
 }
@@ -896,9 +1347,17 @@ void handleResponse(String &resp)
 void handleSerwer()
 {
   then = millis();
-  wifiClient = server.available();
-  if (wifiClient)
+  WiFiClient client = server.available();
+  clientServed = false;
+  // frames from open WebSockets are read by handleWebSockets, their socket must not become current client
+  if (client && !wsOwns(webSockets, client))
   {
+    wifiClient = client;
+    clientServed = true;
+    if (stats.boot[BOOT_PHASE_FIRST_REQUEST] == 0)
+    {
+      bootPhase(BOOT_PHASE_FIRST_REQUEST);
+    }
     currentLine = "";
     requestPath = "";
     HttpRequest req;
@@ -937,9 +1396,13 @@ void handleSerwer()
               }
               else if (req.method == "POST")
               {
-                String payload;
-                WifiSensorsUtils::readPayloadData(payload);
-                served = handlePost(req, payload);
+                served = handlePostStream(req);
+                if (!served)
+                {
+                  String payload;
+                  WifiSensorsUtils::readPayloadData(payload);
+                  served = handlePost(req, payload);
+                }
               }
               else if (req.method == "DELETE")
               {
@@ -952,8 +1415,15 @@ void handleSerwer()
               }
             }
 
-            delay(10);
-            wifiClient.stop();
+            if (requestParked)
+            {
+              requestParked = false;
+            }
+            else
+            {
+              delay(10);
+              wifiClient.stop();
+            }
             break;
           }
           else
@@ -969,12 +1439,7 @@ void handleSerwer()
         {
           if (currentLine.length() > 0)
           {
-            if (currentLine.startsWith("Authorization:"))
-            {
-              req.headersNames[headerCnt] = "Authorization";
-              req.headersValues[headerCnt] = currentLine.substring(15);
-              headerCnt++;
-            }
+            readHeaderLine(req, headerCnt);
           }
         }
 
@@ -990,40 +1455,129 @@ void handleSerwer()
     }
   }
 
+  handleLongPolls();
+  handleEvents();
+  handleWebSockets();
+
   unsigned long took = millis() - then;
   if (took > SERVER_PROCESSING_TIME)
   {
-    String msg = "Server processing time: ";
-    msg += took;
-    Serial.println(msg);
+    Serial.print(F("Server processing time: "));
+    Serial.println(took);
   }
 }
 
-bool handleServerConfig(Hashtable<String, String> *config)
+// returns error or NULL
+const char *handleServerConfig(Form *config)
 {
   Callback callback;
-  if (WifiSensorsUtils::isCallbackUrlValid(config, callback, true) && config->containsKey("ssid"))
+  const char *error = WifiSensorsUtils::parseCallbackUrl(config, callback);
+  if (error != NULL)
+  {
+    return error;
+  }
+  const char *ssid = formGet(*config, FORM_KEY("ssid"));
+  if (ssid == NULL)
+  {
+    return "missing params: ssid";
+  }
+  const char *pass = formGet(*config, FORM_KEY("pass"));
+  const char *serverauth = formGet(*config, FORM_KEY("serverauth"));
+
+  ServerConfig updated = serverConfig;
+  WifiSensorsUtils::writeServerConfig(updated, ssid, pass != NULL ? pass : "", serverauth != NULL ? serverauth : "", callback);
+  if (!WifiSensorsUtils::readStaticIp(config, updated))
   {
-    String ssid = *config->get("ssid");
-    String pass;
-    if (config->containsKey("pass"))
+    return "static ip invalid";
+  }
+  serverConfig = updated;
+  persistChanged(conf_store);
+  authHeader = String(serverConfig.serverauth);
+  return NULL;
+}
+
+// releases devices before restore, flash keeps last good config in case backup is invalid
+void restorePrepare()
+{
+  commitStores();
+  for (byte i = 0; i < WS_DIGITAL_PINS + WS_ANALOG_PINS; i++)
+  {
+    pinout.used[i] = false;
+  }
+  schedulerClear(pollScheduler);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    deviceRelease(i);
+  }
+}
+
+void restoreFinish(bool restored, const char *error)
+{
+  if (restored)
+  {
+    stats.devices = devices.count;
+    persistChanged(conf_store);
+    persistChanged(pinout_store);
+    devlogChangedAll(devices_log);
+    WifiSensorsUtils::sendStatusOk();
+  }
+  else
+  {
+    WifiSensorsUtils::sendError(error);
+    // re-read previous config
+    setupPins();
+    setupDevices();
+    restart(true, 100);
+  }
+}
+
+// keeps current client open until values change or wait ms pass, oldest waiting request is answered when all slots are taken
+void parkLongPoll(uint32_t since, unsigned long wait, BinaryFormat format)
+{
+  byte slot = 0;
+  for (byte i = 0; i < WS_LONGPOLL_CLIENTS; i++)
+  {
+    if (!longPolls[i].waiting)
     {
-      pass = *config->get("pass");
+      slot = i;
+      break;
     }
-    String serverauth;
-    if (config->containsKey("serverauth"))
+    if (longPolls[i].start - longPolls[slot].start > 0x7FFFFFFFUL)
     {
-      serverauth = *config->get("serverauth");
-      serverauth.replace("+", " ");
+      slot = i;
     }
+  }
+  if (longPolls[slot].waiting)
+  {
+    answerLongPoll(slot);
+  }
 
-    WifiSensorsUtils::writeServerConfig(serverConfig, ssid, pass, serverauth, callback);
-    conf_flash_store.write(serverConfig);
-    authHeader = serverauth;
+  longPolls[slot].waiting = true;
+  longPolls[slot].client = wifiClient;
+  longPolls[slot].since = since;
+  longPolls[slot].start = millis();
+  longPolls[slot].wait = wait < WS_LONGPOLL_MAX_WAIT ? wait : WS_LONGPOLL_MAX_WAIT;
+  longPolls[slot].format = format;
+  requestParked = true;
+  // slot owns the socket now, global client must not write to or stop it
+  wifiClient = WiFiClient();
+}
 
-    return true;
+// stores currentLine in req when it is one of requestHeaders, names are case insensitive
+void readHeaderLine(HttpRequest &req, byte &headerCnt)
+{
+  for (byte i = 0; i < sizeof(requestHeaders) / sizeof(requestHeaders[0]) && headerCnt < WS_MAX_REQUEST_HEADERS; i++)
+  {
+    size_t len = strlen(requestHeaders[i]);
+    if (currentLine.length() > len && currentLine.charAt(len) == ':' && strncasecmp(currentLine.c_str(), requestHeaders[i], len) == 0)
+    {
+      req.headersNames[headerCnt] = requestHeaders[i];
+      req.headersValues[headerCnt] = currentLine.substring(len + 1);
+      req.headersValues[headerCnt].trim();
+      headerCnt++;
+      return;
+    }
   }
-  return false;
 }
 
 void restart(bool set, long rdelay)
@@ -1031,9 +1585,10 @@ void restart(bool set, long rdelay)
   if (restatPending)
   {
     restatPending = false;
+    commitStores();
     WiFi.end();
     Serial.println("Restart...");
-    delay(3000);
+    delay(RESTART_DELAY);
     setRunStatus(RUN_STATUS_BOOT);
     setupServer();
   }
@@ -1045,33 +1600,107 @@ void restart(bool set, long rdelay)
   }
 }
 
-void sendDevicesValues()
+void scheduleDevice(byte deviceId)
 {
+  Device *dev = &(devices.devices[deviceId]);
+  if (!dev->active || dev->pollInterval == -1 || deviceIsOutput(dev->type))
+  {
+    schedulerRemove(pollScheduler, deviceId);
+  }
+  else
+  {
+    schedulerAdd(pollScheduler, deviceId, millis());
+  }
+}
+
+// values changed after since, all values when since is 0
+void sendDevicesValues(uint32_t since)
+{
+  char valueStr[WS_VALUE_STR_LEN];
+  uint32_t seq = valueSeq();
+  bool firstDevice = true;
   wifiClient.print("{\"values\":{");
   for (byte i = 0; i < devices.count; i++)
   {
-    if (i > 0)
+    DevicesValues &values = devicesValues[devices.devices[i].deviceId];
+    bool changed = false;
+    for (byte j = 0; j < devices.devices[i].valuesCount && !changed; j++)
     {
-      wifiClient.print(",");
+      changed = valueChanged(values.values[j], since);
+    }
+    if (!changed)
+    {
+      continue;
     }
-    wifiClient.print("\"");
+
+    wifiClient.print(firstDevice ? "\"" : ",\"");
+    firstDevice = false;
     wifiClient.print(devices.devices[i].deviceId);
     wifiClient.print("\":{");
+    bool firstValue = true;
     for (byte j = 0; j < devices.devices[i].valuesCount; j++)
     {
-      if (j > 0)
+      if (!valueChanged(values.values[j], since))
+      {
+        continue;
+      }
+      if (!firstValue)
       {
         wifiClient.print(",");
       }
+      firstValue = false;
+      valueToStr(values.values[j], valueStr);
       wifiClient.print("\"");
-      wifiClient.print(devicesValues[devices.devices[i].deviceId].names[j]);
+      wifiClient.print(values.names[j]);
       wifiClient.print("\":\"");
-      wifiClient.print(devicesValues[devices.devices[i].deviceId].values[j]);
+      wifiClient.print(valueStr);
       wifiClient.print("\"");
     }
     wifiClient.print("}");
   }
-  wifiClient.println("}}");
+  char cursor[WS_VALUE_CURSOR_LEN];
+  valueCursor(seq, cursor);
+  wifiClient.print("},\"seq\":\"");
+  wifiClient.print(cursor);
+  wifiClient.println("\"}");
+}
+
+// GET / response in format from Accept header, binary body has no trailing line break
+void sendValues(uint32_t since, BinaryFormat format)
+{
+  commitBootEpoch();
+  WifiSensorsUtils::sendHeader("200 OK", binaryContentTypes[format]);
+  wifiClient.println();
+  if (format != BINARY_NONE)
+  {
+    BinaryWriter out(wifiClient, format);
+    binaryDevicesValues(out, devices, devicesValues, since, valueSeq());
+    return;
+  }
+  sendDevicesValues(since);
+  wifiClient.println();
+}
+
+BinaryFormat requestFormat(HttpRequest &req)
+{
+  String accept;
+  return WifiSensorsUtils::readHeader(req, "Accept", accept) ? binaryFormat(accept.c_str()) : BINARY_NONE;
+}
+
+// sets pin not used by any device, returns error or NULL
+const char *setPin(const char *pinId, byte value)
+{
+  if (pinId[0] == '\0')
+  {
+    return "missing params: id";
+  }
+  String pin = pinId;
+  if (WifiSensorsUtils::pinUsedByDevice(pinout, pin))
+  {
+    return "pin is used by device";
+  }
+  WifiSensorsUtils::setPinValue(pinId[0], atoi(pinId + 1), value);
+  return NULL;
 }
 
 void setRunStatus(RunStatus status)
@@ -1083,27 +1712,62 @@ void setRunStatus(RunStatus status)
 void setupDevices()
 {
   Serial.println("Setup devices");
-  devices = devices_flash_store.read();
+  devlogLoad(devices_log);
   if (!devices.set)
   {
     devices.set = true;
     devices.count = 0;
-    devices_flash_store.write(devices);
+    devlogChanged(devices_log, WS_DEVLOG_META);
   }
 
   stats.devices = devices.count;
+  stats.historyMemory = sizeof(devicesHistory);
+  schedulerClear(pollScheduler);
+  devicesInit(&stats);
   for (byte i = 0; i < devices.count; i++)
   {
     setupNewDevice(i, false);
   }
 }
 
+// registers pointers only, values are read on scrape
+void setupMetrics()
+{
+  metricsInit(metrics);
+  metricsAdd(metrics, "wifisensors_loop_duration_seconds", "Main loop time.", loopProfile.stages[LOOP_STAGE_LOOP]);
+  metricsRegister(metrics, "wifisensors_uptime_seconds", "Time since boot.", METRIC_GAUGE, METRIC_SOURCE_UPTIME, NULL);
+  metricsAdd(metrics, "wifisensors_free_memory_bytes", "Gap between heap and stack.", METRIC_GAUGE, stats.freeMem);
+  metricsAdd(metrics, "wifisensors_heap_used_bytes", "Heap bytes in use.", METRIC_GAUGE, stats.heap.used);
+  metricsAdd(metrics, "wifisensors_heap_largest_free_bytes", "Largest free heap block.", METRIC_GAUGE, stats.heap.largestFree);
+  metricsAdd(metrics, "wifisensors_heap_allocations_total", "Heap allocations.", METRIC_COUNTER, stats.heap.allocs);
+  metricsAdd(metrics, "wifisensors_heap_failed_allocations_total", "Heap allocations which returned NULL.", METRIC_COUNTER, stats.heap.failed);
+  metricsAdd(metrics, "wifisensors_warnings_total", "Processing warnings.", METRIC_COUNTER, stats.processingWarnings);
+  metricsAdd(metrics, "wifisensors_slow_device_loops_total", "Device loops over processing time threshold.", METRIC_COUNTER, stats.devicesProcessingThresold);
+  metricsAdd(metrics, "wifisensors_devices", "Configured devices.", METRIC_GAUGE, stats.devices);
+  metricsAdd(metrics, "wifisensors_wifi_down", "WiFi link is down.", METRIC_GAUGE, stats.link.down);
+  metricsAdd(metrics, "wifisensors_wifi_rssi_dbm", "WiFi signal strength.", METRIC_GAUGE, stats.link.rssi);
+  metricsAdd(metrics, "wifisensors_wifi_reconnects_total", "WiFi reconnects after link loss.", METRIC_COUNTER, stats.link.connects);
+  metricsAdd(metrics, "wifisensors_wifi_status_changes_total", "WiFi status changes.", METRIC_COUNTER, stats.link.changes);
+  metricsAdd(metrics, "wifisensors_event_subscribers", "Open /events streams.", METRIC_GAUGE, events.subscribers);
+  metricsAdd(metrics, "wifisensors_events_sent_total", "Value events sent to /events streams.", METRIC_COUNTER, events.sent);
+  metricsAdd(metrics, "wifisensors_websocket_clients", "Open WebSocket connections.", METRIC_GAUGE, webSockets.clients);
+  metricsAdd(metrics, "wifisensors_websocket_sent_total", "Value changes sent to WebSocket clients.", METRIC_COUNTER, webSockets.sent);
+  metricsAdd(metrics, "wifisensors_websocket_commands_total", "Commands received over WebSocket.", METRIC_COUNTER, webSockets.commands);
+}
+
 void setupNewDevice(byte deviceId, bool update)
 {
   Device *dev = &(devices.devices[deviceId]);
+  deviceRelease(deviceId);
+  deviceProfileReset(devicesProfile[deviceId]);
 
   devicesValues[deviceId].lastPoll = 0L;
   devices.devices[deviceId].valuesCount = deviceValuesNames(dev->type, dev->deviceId);
+  for (byte i = 0; i < WS_MAX_DEVICE_VALUES; i++)
+  {
+    statsReset(devicesValues[deviceId].stats[i], millis());
+    historyReset(devicesHistory[deviceId][i]);
+  }
 
   Serial.print(F("Setup: "));
   Serial.print(dev->deviceId);
@@ -1117,44 +1781,26 @@ void setupNewDevice(byte deviceId, bool update)
   {
     WifiSensorsUtils::setPinMode(pinout, dev->pins[i]);
   }
-  pinout_flash_store.write(pinout);
+  persistChanged(pinout_store);
 
-  switch (dev->type)
+  const DeviceDriver *driver = deviceDriver(dev->type);
+  if (driver != NULL)
   {
-  case DEVICE_BUTTON:
-    setupButton(dev);
-    break;
-  case DEVICE_DHT22:
-    setupDHT22(dev);
-    break;
-  case DEVICE_GENERIC_ANALOG_INPUT:
-  case DEVICE_GENERIC_DIGITAL_INPUT:
-    setupGeneric(dev);
-    break;
-  case DEVICE_MOTION:
-    setupButton(dev);
-    break;
-  case DEVICE_RELAY:
-    setupRelay(dev);
-    break;
-  case DEVICE_SWITCH:
-    setupButton(dev);
-    break;
-  case DEVICE_TEMP_DALLAS:
-    setupTempDallas(dev);
-    break;
+    driver->setup(dev);
   }
 
+  scheduleDevice(deviceId);
+
   if (update)
   {
-    devices_flash_store.write(devices);
+    devlogChanged(devices_log, deviceId);
   }
 }
 
 void setupPins()
 {
   Serial.println("Setup pins");
-  pinout = pinout_flash_store.read();
+  persistLoad(pinout_store);
   if (!pinout.set)
   {
     for (int pin = 0; pin < WS_ANALOG_PINS; pin++)
@@ -1169,32 +1815,65 @@ void setupPins()
     }
 
     pinout.set = true;
-    pinout_flash_store.write(pinout);
+    persistChanged(pinout_store);
   }
   else
   {
-    for (int pin = 0; pin < WS_ANALOG_PINS; pin++)
-    {
-      WifiSensorsUtils::setAnalogPinMode(pin, pinout.analog[pin]);
-    }
-    for (int pin = 2; pin < WS_DIGITAL_PINS; pin++)
+    applyPins();
+  }
+}
+
+void applyPins()
+{
+  for (int pin = 0; pin < WS_ANALOG_PINS; pin++)
+  {
+    WifiSensorsUtils::setAnalogPinMode(pin, pinout.analog[pin]);
+  }
+  for (int pin = 2; pin < WS_DIGITAL_PINS; pin++)
+  {
+    switch (pinout.digital[pin])
     {
-      switch (pinout.digital[pin])
-      {
-      case 0:
-        pinMode(pin, INPUT);
-        break;
-      case 1:
-        pinMode(pin, OUTPUT);
-        break;
-      case 2:
-        pinMode(pin, INPUT_PULLUP);
-        break;
-      }
+    case 0:
+      pinMode(pin, INPUT);
+      break;
+    case 1:
+      pinMode(pin, OUTPUT);
+      break;
+    case 2:
+      pinMode(pin, INPUT_PULLUP);
+      break;
     }
   }
 }
 
+// device config when deviceId is set, server config otherwise, returns error or NULL
+const char *applyConfig(Form *config, const char *deviceId)
+{
+  if (deviceId == NULL)
+  {
+    return handleServerConfig(config);
+  }
+  byte id;
+  if (!parseDeviceId(deviceId, id))
+  {
+    return "device does not exist";
+  }
+  Callback callback;
+  const char *error = WifiSensorsUtils::parseCallbackUrl(config, callback);
+  if (error != NULL)
+  {
+    return error;
+  }
+  devices.devices[id].pushCallback = callback;
+  if (!deviceConfigUpdated(config, &devices.devices[id]))
+  {
+    return "Device config invalid!";
+  }
+  scheduleDevice(id);
+  devlogChanged(devices_log, id);
+  return NULL;
+}
+
 void setupSerial()
 {
   Serial.begin(9600);
@@ -1211,19 +1890,29 @@ void setupServer()
   Serial.println("Setup server");
   if (!configureNetwork())
   {
-    Serial.println("Błąd wifi");
-    setRunStatus(RUN_STATUS_ERROR);
-    while (true)
-    {
-      showRunStatus();
-    }
+    networkError();
   }
 
+  startServer();
+}
+
+void startServer()
+{
   server.begin();
 
   WifiSensorsUtils::printWifiStatus(&stats);
 }
 
+void networkError()
+{
+  Serial.println("Błąd wifi");
+  setRunStatus(RUN_STATUS_ERROR);
+  while (true)
+  {
+    showRunStatus();
+  }
+}
+
 void showRunStatus()
 {
   if (!runStatuChanged)
@@ -1255,9 +1944,87 @@ void showRunStatus()
 
 void softReset()
 {
+  commitStores();
   NVIC_SystemReset();
 }
 
+// device id from request, false when it is not a number of existing device (checked before narrowing to byte)
+bool parseDeviceId(const char *str, byte &id)
+{
+  char *end;
+  long value = strtol(str, &end, 10);
+  if (end == str || *end != '\0' || value < 0 || value >= devices.count)
+  {
+    return false;
+  }
+  id = (byte)value;
+  return true;
+}
+
+// relay or button on/off, trigger config byte 0 means active LOW, returns error or NULL
+const char *turnDevice(const char *deviceId, bool on)
+{
+  byte id;
+  if (!parseDeviceId(deviceId, id))
+  {
+    return "device does not exist";
+  }
+  if (!devices.devices[id].active || (devices.devices[id].type != DEVICE_RELAY && devices.devices[id].type != DEVICE_BUTTON))
+  {
+    return "wrong device type";
+  }
+  DevicePin dpin = devices.devices[id].pins[0];
+  valueSetState(devicesValues[id].values[0], on);
+  bool activeLow = devices.devices[id].config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x0;
+  WifiSensorsUtils::setPinValue(dpin.type, dpin.pin, on == activeLow ? LOW : HIGH);
+  return NULL;
+}
+
+// cmd=turnon|turnoff|set|unset|config with fields of matching POST request
+void webSocketCommand(Form &command, Print &reply)
+{
+  const char *cmd = formGet(command, FORM_KEY("cmd"));
+  const char *id = formGet(command, FORM_KEY("id"));
+  const char *error = NULL;
+  if (cmd == NULL)
+  {
+    error = "missing params: cmd";
+  }
+  else if (strcmp(cmd, "config") == 0)
+  {
+    error = applyConfig(&command, id);
+  }
+  else if (id == NULL)
+  {
+    error = "missing params: id";
+  }
+  else if (strcmp(cmd, "turnon") == 0 || strcmp(cmd, "turnoff") == 0)
+  {
+    error = turnDevice(id, strcmp(cmd, "turnon") == 0);
+  }
+  else if (strcmp(cmd, "set") == 0 || strcmp(cmd, "unset") == 0)
+  {
+    error = setPin(id, strcmp(cmd, "set") == 0 ? HIGH : LOW);
+  }
+  else
+  {
+    error = "unknown command";
+  }
+
+  reply.print("{\"cmd\":\"");
+  reply.print(cmd != NULL ? cmd : "");
+  if (error == NULL)
+  {
+    reply.print("\",\"status\":\"ok\"}");
+  }
+  else
+  {
+    reply.print("\",\"error\":\"");
+    reply.print(error);
+    reply.print("\"}");
+  }
+}
+
 unsigned long timeNow(ServerStats &stats)
 {
   return stats.wifiConnectionTime + millis() / 1000;
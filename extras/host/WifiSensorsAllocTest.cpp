@@ -0,0 +1,83 @@
+/*
+Steady state allocation test, host version of the WS_ALLOC_CHECK assertion: boots the sketch, adds a relay and a DHT22
+with push callback, sets server warning callback, then runs loop() with the clock moving WS_ALLOC_TEST_STEP us per pass
+and no request served. After warm-up (WS_ALLOC_CHECK_WARMUP of the sketch) every pass must do zero heap operations, first with a working sensor
+(polls and pushes), then with a failing one (warnings pushed to server callback).
+Usage: ws_alloc_test [loops per phase], exit code 1 when a loop allocated
+*/
+
+#include "WifiSensorsHost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WS_ALLOC_TEST_STEP 50000ULL
+// WS_ALLOC_CHECK_WARMUP of the sketch in us
+#define WS_ALLOC_TEST_WARMUP_US 10000000ULL
+#define WS_ALLOC_TEST_DHT_PIN 3
+
+static HostResponse response;
+
+static bool request(const char *text)
+{
+  return hostRequest(text, response) && response.status == 200 && strstr(response.body, "\"status\":\"ok\"") != NULL;
+}
+
+static int runPhase(const char *name, unsigned long loops)
+{
+  unsigned long allocating = 0;
+  unsigned long maxOps = 0;
+  unsigned long pushes = hostOutboundCount();
+  for (unsigned long i = 0; i < loops; i++)
+  {
+    hostAdvance(WS_ALLOC_TEST_STEP);
+    unsigned long before = hostHeapOperations();
+    hostLoop();
+    unsigned long ops = hostHeapOperations() - before;
+    if (ops > 0)
+    {
+      allocating++;
+      maxOps = ops > maxOps ? ops : maxOps;
+    }
+    // pushes are fire and forget, receiver closes them so sockets do not run out
+    hostCloseOutbound();
+  }
+  pushes = hostOutboundCount() - pushes;
+  printf("%-10s loops %lu, pushes %lu, allocating loops %lu, max heap operations %lu\n", name, loops, pushes, allocating, maxOps);
+  if (pushes == 0)
+  {
+    fprintf(stderr, "%s: no callback was pushed, phase did not cover the push path\n", name);
+    return 1;
+  }
+  return allocating > 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long loops = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+
+  hostSetup();
+  hostAcceptOutbound(true);
+  hostPinSet(WS_ALLOC_TEST_DHT_PIN, 1); // HIGH, sensor answers
+  if (!request("POST /device?type=RELAY&pin0=D2&pin0type=OUTPUT&interval=1000 HTTP/1.1\r\nHost: board\r\nContent-Length: 0\r\n\r\n") ||
+      !request("POST /device?type=DHT22&pin0=D3&pin0type=INPUT&interval=1000 HTTP/1.1\r\nHost: board\r\nContent-Length: 78\r\n\r\ncallback=192.168.1.2%3A8080%2Fsensor%3Ftemp%3D%3Ctemp%3E%26humid%3D%3Chumid%3E") ||
+      !request("POST /config HTTP/1.1\r\nHost: board\r\nContent-Length: 65\r\n\r\nssid=host&callback=192.168.1.2%3A8080%2Fwarning%3Fmsg%3D%3Cmsg%3E"))
+  {
+    fprintf(stderr, "setup request failed:\n%s\n", response.body);
+    return 2;
+  }
+
+  // lazily built state (pools, first push, persist commit) is not steady state
+  while (hostMicros() < WS_ALLOC_TEST_WARMUP_US)
+  {
+    hostAdvance(WS_ALLOC_TEST_STEP);
+    hostLoop();
+    hostCloseOutbound();
+  }
+
+  int failed = runPhase("polling", loops);
+  hostPinSet(WS_ALLOC_TEST_DHT_PIN, 0); // LOW, sensor read fails
+  failed |= runPhase("warnings", loops);
+  return failed;
+}
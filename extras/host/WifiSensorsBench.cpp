@@ -0,0 +1,207 @@
+/*
+Host run of the parser and serializer microbenchmarks (src/WifiSensorsBench.h) with a baseline kept in a text file.
+Boots the sketch, adds a relay and a DHT22 with callback, then measures every case on the board stack: ns/op is wall
+clock (best of WS_HOST_BENCH_RUNS runs of WS_HOST_BENCH_ITERATIONS ops), allocations and bytes per op come from the
+sketch heap counters, so they are exact and repeat run to run, ns/op depends on the machine.
+Usage: ws_bench [--save] [--allocs] [baseline file]
+  without --save results are compared with the baseline (benchRegression), exit code 1 on regression
+  --save writes results as new baseline, --allocs compares allocations and bytes only (timing is not checked)
+*/
+
+#include "WifiSensorsHost.h"
+
+#include "WifiSensorsBench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef WS_HOST_BENCH_ITERATIONS
+#define WS_HOST_BENCH_ITERATIONS 2000
+#endif
+#ifndef WS_HOST_BENCH_RUNS
+#define WS_HOST_BENCH_RUNS 5
+#endif
+
+extern ServerConfig serverConfig;
+extern Devices devices;
+extern ServerStats stats;
+
+static BenchResult results[BENCH_CASES];
+static HostResponse response;
+
+static unsigned long long wallNanos()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void benchCase(BenchCase benchCase, BenchPayloads &payloads, BenchResult &result)
+{
+  memset(&result, 0, sizeof(result));
+  if (benchCase == BENCH_CONFIG_TO_STRING && devices.count == 0)
+  {
+    return;
+  }
+
+  BenchSink sink;
+  HeapStats before, after;
+  benchOp(benchCase, payloads, sink, serverConfig, devices, stats, 0);
+  WifiSensorsUtils::heapStats(before);
+  unsigned long long best = 0;
+  for (int run = 0; run < WS_HOST_BENCH_RUNS; run++)
+  {
+    unsigned long long start = wallNanos();
+    for (unsigned int i = 0; i < WS_HOST_BENCH_ITERATIONS; i++)
+    {
+      benchOp(benchCase, payloads, sink, serverConfig, devices, stats, i);
+    }
+    unsigned long long elapsed = wallNanos() - start;
+    best = run == 0 || elapsed < best ? elapsed : best;
+  }
+  WifiSensorsUtils::heapStats(after);
+
+  unsigned long ops = (unsigned long)WS_HOST_BENCH_ITERATIONS * WS_HOST_BENCH_RUNS;
+  result.ns = (uint32_t)(best / WS_HOST_BENCH_ITERATIONS);
+  result.allocs = (after.allocs - before.allocs + ops - 1) / ops;
+  result.bytes = (after.allocated - before.allocated + ops - 1) / ops;
+}
+
+// runs on the board stack, heapStats scans stack paint up to its own frame
+static void benchAll()
+{
+  BenchPayloads payloads;
+  benchPrepare(payloads);
+  for (byte i = 0; i < BENCH_CASES; i++)
+  {
+    benchCase((BenchCase)i, payloads, results[i]);
+  }
+}
+
+static bool addDevice(const char *request)
+{
+  return hostRequest(request, response) && response.status == 200 && strstr(response.body, "\"status\":\"ok\"") != NULL;
+}
+
+// lines "name ns allocs bytes", # starts a comment
+static bool loadBaseline(const char *path, BenchBaseline &baseline)
+{
+  memset(&baseline, 0, sizeof(baseline));
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+  {
+    return false;
+  }
+  char line[128];
+  byte found = 0;
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char name[64];
+    BenchResult r;
+    if (line[0] == '#' || sscanf(line, "%63s %u %u %u", name, &r.ns, &r.allocs, &r.bytes) != 4)
+    {
+      continue;
+    }
+    for (byte i = 0; i < BENCH_CASES; i++)
+    {
+      if (strcmp(name, benchCaseNames[i]) == 0)
+      {
+        baseline.results[i] = r;
+        found++;
+      }
+    }
+  }
+  fclose(f);
+  baseline.set = found == BENCH_CASES;
+  return baseline.set;
+}
+
+static bool saveBaseline(const char *path)
+{
+  FILE *f = fopen(path, "w");
+  if (f == NULL)
+  {
+    return false;
+  }
+  fprintf(f, "# ws_bench baseline: case ns/op allocs/op bytes/op, ns/op is valid only for the machine which wrote it\n");
+  for (byte i = 0; i < BENCH_CASES; i++)
+  {
+    fprintf(f, "%s %u %u %u\n", benchCaseNames[i], results[i].ns, results[i].allocs, results[i].bytes);
+  }
+  return fclose(f) == 0;
+}
+
+int main(int argc, char **argv)
+{
+  bool save = false;
+  bool allocsOnly = false;
+  const char *path = "bench_baseline.txt";
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--save") == 0)
+    {
+      save = true;
+    }
+    else if (strcmp(argv[i], "--allocs") == 0)
+    {
+      allocsOnly = true;
+    }
+    else
+    {
+      path = argv[i];
+    }
+  }
+
+  hostSetup();
+  if (!addDevice("POST /device?type=RELAY&pin0=D2&pin0type=OUTPUT&interval=1000 HTTP/1.1\r\nHost: board\r\nContent-Length: 0\r\n\r\n") ||
+      !addDevice("POST /device?type=DHT22&pin0=D3&pin0type=INPUT&interval=5000 HTTP/1.1\r\nHost: board\r\nContent-Length: 87\r\n\r\ncallback=192.168.100.200%3A8080%2Fapi%2Fv1%2Fsensors%2F%3Ctemp%3E%3Fhumid%3D%3Chumid%3E"))
+  {
+    fprintf(stderr, "adding devices failed:\n%s\n", response.body);
+    return 2;
+  }
+
+  hostRun(benchAll);
+
+  BenchBaseline baseline;
+  if (!save && !loadBaseline(path, baseline))
+  {
+    fprintf(stderr, "no complete baseline in %s, write one with --save\n", path);
+  }
+
+  int regressions = 0;
+  printf("%-24s %10s %8s %8s %10s %8s %8s\n", "case", "ns/op", "allocs", "bytes", "base ns", "allocs", "bytes");
+  for (byte i = 0; i < BENCH_CASES; i++)
+  {
+    printf("%-24s %10u %8u %8u", benchCaseNames[i], results[i].ns, results[i].allocs, results[i].bytes);
+    if (baseline.set && !save)
+    {
+      BenchResult result = results[i];
+      if (allocsOnly)
+      {
+        result.ns = baseline.results[i].ns;
+      }
+      bool regression = benchRegression(result, baseline.results[i]);
+      regressions += regression ? 1 : 0;
+      printf(" %10u %8u %8u%s", baseline.results[i].ns, baseline.results[i].allocs, baseline.results[i].bytes, regression ? "  REGRESSION" : "");
+    }
+    printf("\n");
+  }
+
+  if (save)
+  {
+    if (!saveBaseline(path))
+    {
+      perror(path);
+      return 2;
+    }
+    printf("baseline written to %s\n", path);
+    return 0;
+  }
+  if (!baseline.set)
+  {
+    return 2;
+  }
+  printf("%d regressions (tolerance %d %%%s)\n", regressions, WS_BENCH_TOLERANCE, allocsOnly ? ", allocations only" : "");
+  return regressions > 0 ? 1 : 0;
+}
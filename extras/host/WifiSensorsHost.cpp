@@ -0,0 +1,158 @@
+#include "WifiSensorsHost.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+void setup();
+void loop();
+
+// board SRAM, sketch stack grows down from its end, heap top (sbrk) stays at its start
+static uint8_t sram[WS_HOST_SRAM] __attribute__((aligned(16)));
+static ucontext_t hostContext;
+static ucontext_t boardContext;
+static void (*boardFunction)();
+static unsigned long heapOperations = 0;
+
+extern "C"
+{
+  void *__libc_malloc(size_t size);
+  void __libc_free(void *ptr);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+
+  // newlib defaults, sketch replaces them when it counts heap operations
+  __attribute__((weak)) void __malloc_lock(struct _reent *)
+  {
+  }
+
+  __attribute__((weak)) void __malloc_unlock(struct _reent *)
+  {
+  }
+
+  // newlib-nano reentrant allocator the sketch malloc wrappers call, lock is taken once per call as in newlib
+  void *_malloc_r(struct _reent *reent, size_t size)
+  {
+    __malloc_lock(reent);
+    heapOperations++;
+    void *ptr = __libc_malloc(size);
+    __malloc_unlock(reent);
+    return ptr;
+  }
+
+  void _free_r(struct _reent *reent, void *ptr)
+  {
+    if (ptr == NULL)
+    {
+      return;
+    }
+    __malloc_lock(reent);
+    heapOperations++;
+    __libc_free(ptr);
+    __malloc_unlock(reent);
+  }
+
+  void *_calloc_r(struct _reent *reent, size_t count, size_t size)
+  {
+    __malloc_lock(reent);
+    heapOperations++;
+    void *ptr = __libc_calloc(count, size);
+    __malloc_unlock(reent);
+    return ptr;
+  }
+
+  void *_realloc_r(struct _reent *reent, void *ptr, size_t size)
+  {
+    __malloc_lock(reent);
+    heapOperations++;
+    void *newPtr = __libc_realloc(ptr, size);
+    __malloc_unlock(reent);
+    return newPtr;
+  }
+
+  size_t _malloc_usable_size_r(struct _reent *, void *ptr)
+  {
+    return malloc_usable_size(ptr);
+  }
+
+  // glibc keeps free chunks itself, the walk over newlib free list finds nothing
+  void *__malloc_free_list = NULL;
+
+  // sbrk of the sketch (renamed by the build), heap top is bottom of board SRAM
+  char *hostSbrk(int)
+  {
+    return reinterpret_cast<char *>(sram);
+  }
+}
+
+unsigned long hostHeapOperations()
+{
+  return heapOperations;
+}
+
+static void boardEntry()
+{
+  boardFunction();
+}
+
+void hostRun(void (*fn)())
+{
+  boardFunction = fn;
+  if (getcontext(&boardContext) != 0)
+  {
+    perror("getcontext");
+    exit(2);
+  }
+  boardContext.uc_stack.ss_sp = sram;
+  boardContext.uc_stack.ss_size = sizeof(sram);
+  boardContext.uc_link = &hostContext;
+  makecontext(&boardContext, boardEntry, 0);
+  swapcontext(&hostContext, &boardContext);
+}
+
+void hostSetup()
+{
+  hostRun(setup);
+}
+
+void hostLoop()
+{
+  hostRun(loop);
+}
+
+static int responseStatus(const char *data, size_t length)
+{
+  // HTTP/1.1 200 OK
+  const char *space = (const char *)memchr(data, ' ', length);
+  return length > 12 && strncmp(data, "HTTP/", 5) == 0 && space != NULL ? atoi(space + 1) : 0;
+}
+
+bool hostRequest(const char *request, HostResponse &response)
+{
+  response.status = 0;
+  response.length = 0;
+  response.closed = false;
+  response.loops = 0;
+
+  int sock = hostConnect(80);
+  if (sock < 0)
+  {
+    return false;
+  }
+  hostSend(sock, request);
+
+  while (response.loops < WS_HOST_REQUEST_LOOPS && !response.closed)
+  {
+    hostLoop();
+    response.loops++;
+    response.length += hostReceive(sock, response.body + response.length, WS_HOST_TX - response.length);
+    response.closed = hostClosed(sock);
+  }
+  hostClose(sock);
+
+  response.body[response.length] = '\0';
+  response.status = responseStatus(response.body, response.length);
+  return response.closed;
+}
@@ -0,0 +1,82 @@
+#ifndef WIFISENSORS_HOST_H
+#define WIFISENSORS_HOST_H
+
+/*
+Host harness: runs the sketch (setup/loop) on a PC against mock Arduino, WiFiNINA and FlashStorage libraries.
+Sketch code runs on its own WS_HOST_SRAM bytes stack (ucontext), heap top reported by sbrk(0) is bottom of that area,
+so stack paint, stack low water and free memory work as on the board, heap goes through newlib style _malloc_r hooks
+and is counted by the sketch itself (WS_HEAP_STATS, WS_ALLOC_CHECK).
+Clock is virtual, network sockets are in memory: hostConnect opens a connection to a port the sketch listens on,
+hostSend/hostReceive move bytes, hostRequest runs one whole HTTP exchange through loop().
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WS_HOST_SRAM
+#define WS_HOST_SRAM (128 * 1024)
+#endif
+#ifndef WS_HOST_SOCKETS
+#define WS_HOST_SOCKETS 10
+#endif
+#ifndef WS_HOST_RX
+#define WS_HOST_RX 4096
+#endif
+#ifndef WS_HOST_TX
+#define WS_HOST_TX 65536
+#endif
+// loop() passes after which hostRequest gives up on a response
+#ifndef WS_HOST_REQUEST_LOOPS
+#define WS_HOST_REQUEST_LOOPS 100
+#endif
+
+// virtual clock
+unsigned long long hostMicros();
+void hostAdvance(unsigned long long us);
+
+// pin levels seen by digitalRead/analogRead
+void hostPinSet(uint32_t pin, int value);
+int hostPin(uint32_t pin);
+
+// runs fn on the board stack
+void hostRun(void (*fn)());
+// sketch setup() and loop() on the board stack
+void hostSetup();
+void hostLoop();
+
+// heap operations counted by the sketch hooks (newlib lock count), all heap calls of the process
+unsigned long hostHeapOperations();
+
+// WiFi module state
+void hostWiFiAvailable(bool available);
+void hostWiFiDrop();
+
+// in memory sockets, index or -1 when none is free
+int hostConnect(uint16_t port);
+size_t hostSend(int sock, const char *data, size_t len);
+size_t hostSend(int sock, const char *data);
+size_t hostReceive(int sock, char *out, size_t size);
+// sketch stopped its side
+bool hostClosed(int sock);
+void hostClose(int sock);
+// outbound connections (push callbacks) are refused unless accepted, last one is kept for inspection
+void hostAcceptOutbound(bool accept);
+int hostLastOutbound();
+// outbound connections opened so far
+unsigned long hostOutboundCount();
+// peer closes all outbound connections (callback receiver answered)
+void hostCloseOutbound();
+
+typedef struct
+{
+  int status;
+  size_t length;
+  bool closed;
+  unsigned int loops;
+  char body[WS_HOST_TX + 1];
+} HostResponse;
+
+// writes request to new connection on port 80, runs loop() until sketch closes it (or WS_HOST_REQUEST_LOOPS passes)
+bool hostRequest(const char *request, HostResponse &response);
+
+#endif
@@ -0,0 +1,92 @@
+/*
+Load generator: boots the sketch on host, adds a relay, then sends requests to /, /devices, /status and /turnon
+one at a time (the board serves one client at a time) and reports requests per second, p50/p99 latency in wall clock
+micros and heap operations per request. Latency covers loop() passes from request written to connection closed.
+Usage: ws_load [requests per route] [max heap operations per request, exit code 1 when exceeded]
+*/
+
+#include "WifiSensorsHost.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WS_LOAD_MAX_REQUESTS 100000
+
+typedef struct
+{
+  const char *name;
+  const char *request;
+} LoadRoute;
+
+static const LoadRoute routes[] = {
+    {"/", "GET / HTTP/1.1\r\nHost: board\r\n\r\n"},
+    {"/devices", "GET /devices HTTP/1.1\r\nHost: board\r\n\r\n"},
+    {"/status", "GET /status HTTP/1.1\r\nHost: board\r\n\r\n"},
+    {"/turnon", "POST /turnon?id=0 HTTP/1.1\r\nHost: board\r\nContent-Length: 0\r\n\r\n"},
+};
+
+static HostResponse response;
+static unsigned long latencies[WS_LOAD_MAX_REQUESTS];
+
+static bool request(const char *text)
+{
+  return hostRequest(text, response) && response.status == 200;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+  long maxHeapOps = argc > 2 ? strtol(argv[2], NULL, 10) : -1;
+  if (count == 0 || count > WS_LOAD_MAX_REQUESTS)
+  {
+    fprintf(stderr, "requests per route must be 1..%d\n", WS_LOAD_MAX_REQUESTS);
+    return 2;
+  }
+
+  hostSetup();
+  if (!request("POST /device?type=RELAY&pin0=D2&pin0type=OUTPUT&interval=1000 HTTP/1.1\r\nHost: board\r\nContent-Length: 0\r\n\r\n") ||
+      strstr(response.body, "\"status\":\"ok\"") == NULL)
+  {
+    fprintf(stderr, "adding device failed:\n%s\n", response.body);
+    return 2;
+  }
+
+  int failed = 0;
+  printf("%-10s %10s %10s %10s %14s\n", "route", "req/s", "p50 us", "p99 us", "heap ops/req");
+  for (size_t r = 0; r < sizeof(routes) / sizeof(routes[0]); r++)
+  {
+    // warm up: lazily built state (pools, reserved strings) is not part of steady state
+    for (int i = 0; i < 10; i++)
+    {
+      request(routes[r].request);
+    }
+
+    unsigned long heapOps = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < count; i++)
+    {
+      unsigned long opsBefore = hostHeapOperations();
+      std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+      if (!request(routes[r].request))
+      {
+        fprintf(stderr, "%s failed with status %d:\n%s\n", routes[r].name, response.status, response.body);
+        return 2;
+      }
+      latencies[i] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count();
+      heapOps += hostHeapOperations() - opsBefore;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies, latencies + count);
+    double opsPerRequest = (double)heapOps / count;
+    printf("%-10s %10.0f %10lu %10lu %14.1f\n", routes[r].name, count / seconds, latencies[count / 2], latencies[(count * 99) / 100 < count ? (count * 99) / 100 : count - 1], opsPerRequest);
+    if (maxHeapOps >= 0 && opsPerRequest > maxHeapOps)
+    {
+      failed = 1;
+    }
+  }
+  return failed;
+}
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""Turns the sketch into C++ the way Arduino builder does: Arduino.h first, prototypes of sketch functions before the
+first function definition, #line directives keep compiler messages pointing at the .ino."""
+
+import re
+import sys
+
+DEFINITION = re.compile(r'^([A-Za-z_][\w:<>,\s\*&]*?[\s\*&])([A-Za-z_]\w*)\s*\(([^;{]*)\)\s*$')
+KEYWORDS = ('if', 'while', 'for', 'switch', 'return')
+
+
+def main(source, target):
+    with open(source) as f:
+        lines = f.read().split('\n')
+
+    prototypes = []
+    first = None
+    for i, line in enumerate(lines):
+        match = DEFINITION.match(line)
+        if match and i + 1 < len(lines) and lines[i + 1].strip() == '{' and match.group(2) not in KEYWORDS:
+            prototypes.append(line.strip() + ';')
+            if first is None:
+                first = i
+
+    name = source.replace('\\', '/')
+    out = ['#include <Arduino.h>', '#line 1 "%s"' % name]
+    out += lines[:first]
+    out += prototypes
+    out.append('#line %d "%s"' % (first + 1, name))
+    out += lines[first:]
+    with open(target, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1], sys.argv[2])
@@ -0,0 +1,1427 @@
+#include "Arduino.h"
+
+#include "../WifiSensorsHost.h"
+
+#include <ctype.h>
+
+#ifndef WS_HOST_CLOCK_STEP
+#define WS_HOST_CLOCK_STEP 1
+#endif
+#ifndef WS_HOST_PINS
+#define WS_HOST_PINS 32
+#endif
+
+HostSerial Serial;
+
+static unsigned long long clockMicros = 0;
+static int pinLevels[WS_HOST_PINS];
+static bool serialEcho = getenv("WS_HOST_SERIAL") != NULL;
+
+unsigned long long hostMicros()
+{
+  return clockMicros;
+}
+
+void hostAdvance(unsigned long long us)
+{
+  clockMicros += us;
+}
+
+void hostPinSet(uint32_t pin, int value)
+{
+  if (pin < WS_HOST_PINS)
+  {
+    pinLevels[pin] = value;
+  }
+}
+
+int hostPin(uint32_t pin)
+{
+  return pin < WS_HOST_PINS ? pinLevels[pin] : LOW;
+}
+
+unsigned long millis()
+{
+  clockMicros += WS_HOST_CLOCK_STEP;
+  return (unsigned long)(clockMicros / 1000);
+}
+
+unsigned long micros()
+{
+  clockMicros += WS_HOST_CLOCK_STEP;
+  return (unsigned long)clockMicros;
+}
+
+void delay(unsigned long ms)
+{
+  clockMicros += ms * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  clockMicros += us;
+}
+
+void yield()
+{
+}
+
+void pinMode(uint32_t pin, uint32_t mode)
+{
+  if (mode == INPUT_PULLUP)
+  {
+    hostPinSet(pin, HIGH);
+  }
+}
+
+int digitalRead(uint32_t pin)
+{
+  return hostPin(pin);
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+  hostPinSet(pin, value ? HIGH : LOW);
+}
+
+int analogRead(uint32_t pin)
+{
+  return hostPin(pin);
+}
+
+void analogWrite(uint32_t pin, int value)
+{
+  hostPinSet(pin, value);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long howbig)
+{
+  return howbig == 0 ? 0 : rand() % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  return howsmall >= howbig ? howsmall : random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+  srand(seed);
+}
+
+void NVIC_SystemReset()
+{
+  fprintf(stderr, "NVIC_SystemReset called\n");
+  exit(3);
+}
+
+static char *numberToString(unsigned long long value, bool negative, char *str, int base)
+{
+  char tmp[66];
+  int i = 0;
+  do
+  {
+    int digit = value % base;
+    tmp[i++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  char *p = str;
+  if (negative)
+  {
+    *p++ = '-';
+  }
+  while (i > 0)
+  {
+    *p++ = tmp[--i];
+  }
+  *p = '\0';
+  return str;
+}
+
+char *itoa(int value, char *str, int base)
+{
+  return ltoa(value, str, base);
+}
+
+char *ltoa(long value, char *str, int base)
+{
+  bool negative = value < 0 && base == 10;
+  unsigned long abs = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+  if (base != 10)
+  {
+    abs = (uint32_t)value;
+  }
+  return numberToString(abs, negative, str, base);
+}
+
+char *utoa(unsigned value, char *str, int base)
+{
+  return numberToString(value, false, str, base);
+}
+
+char *ultoa(unsigned long value, char *str, int base)
+{
+  return numberToString(value, false, str, base);
+}
+
+char *dtostrf(double value, signed char width, unsigned char prec, char *str)
+{
+  sprintf(str, "%*.*f", width, prec, value);
+  return str;
+}
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+  {
+    if (write(*buffer++))
+    {
+      n++;
+    }
+    else
+    {
+      break;
+    }
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh)
+{
+  return print(reinterpret_cast<const char *>(ifsh));
+}
+
+size_t Print::print(const String &s)
+{
+  return write(s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[])
+{
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  return write(c);
+}
+
+size_t Print::print(unsigned char b, int base)
+{
+  return print((unsigned long)b, base);
+}
+
+size_t Print::print(int n, int base)
+{
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+  return print((long long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long long n, int base)
+{
+  if (base == 0)
+  {
+    return write(n);
+  }
+  if (base == 10 && n < 0)
+  {
+    size_t t = print('-');
+    return printNumber(0ULL - (unsigned long long)n, 10) + t;
+  }
+  // board longs are 32 bit, other bases print them as unsigned of that width
+  return printNumber(base == 10 ? (unsigned long long)n : (uint32_t)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+  return base == 0 ? write(n) : printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+  return printFloat(n, digits);
+}
+
+size_t Print::print(const Printable &x)
+{
+  return x.printTo(*this);
+}
+
+size_t Print::println(void)
+{
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *ifsh)
+{
+  size_t n = print(ifsh);
+  return n + println();
+}
+
+size_t Print::println(const String &s)
+{
+  size_t n = print(s);
+  return n + println();
+}
+
+size_t Print::println(const char c[])
+{
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(char c)
+{
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(unsigned char b, int base)
+{
+  size_t n = print(b, base);
+  return n + println();
+}
+
+size_t Print::println(int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(double num, int digits)
+{
+  size_t n = print(num, digits);
+  return n + println();
+}
+
+size_t Print::println(const Printable &x)
+{
+  size_t n = print(x);
+  return n + println();
+}
+
+size_t Print::printNumber(unsigned long long n, uint8_t base)
+{
+  char buf[8 * sizeof(long long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2)
+  {
+    base = 10;
+  }
+  do
+  {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+// same algorithm as the core, so floats print with the same digits as on the board
+size_t Print::printFloat(double number, uint8_t digits)
+{
+  size_t n = 0;
+  if (isnan(number))
+  {
+    return print("nan");
+  }
+  if (isinf(number))
+  {
+    return print("inf");
+  }
+  if (number > 4294967040.0 || number < -4294967040.0)
+  {
+    return print("ovf");
+  }
+  if (number < 0.0)
+  {
+    n += print('-');
+    number = -number;
+  }
+
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i)
+  {
+    rounding /= 10.0;
+  }
+  number += rounding;
+
+  unsigned long intPart = (unsigned long)number;
+  double remainder = number - (double)intPart;
+  n += print(intPart);
+  if (digits > 0)
+  {
+    n += print('.');
+  }
+  while (digits-- > 0)
+  {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+// Stream
+
+void Stream::setTimeout(unsigned long timeout)
+{
+  this->timeout = timeout;
+}
+
+int Stream::timedRead()
+{
+  unsigned long start = millis();
+  do
+  {
+    int c = read();
+    if (c >= 0)
+    {
+      return c;
+    }
+    // nothing else runs while the board waits, let the clock move
+    delay(1);
+  } while (millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length)
+  {
+    int c = timedRead();
+    if (c < 0)
+    {
+      break;
+    }
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+// String, allocation follows the SAMD core WString
+
+void String::init(void)
+{
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+}
+
+void String::invalidate(void)
+{
+  if (buffer)
+  {
+    free(buffer);
+  }
+  init();
+}
+
+bool String::reserve(unsigned int size)
+{
+  if (buffer && capacity >= size)
+  {
+    return true;
+  }
+  if (changeBuffer(size))
+  {
+    if (len == 0)
+    {
+      buffer[0] = '\0';
+    }
+    return true;
+  }
+  return false;
+}
+
+bool String::changeBuffer(unsigned int maxStrLen)
+{
+  char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+  if (newbuffer)
+  {
+    buffer = newbuffer;
+    capacity = maxStrLen;
+    return true;
+  }
+  return false;
+}
+
+String &String::copy(const char *cstr, unsigned int length)
+{
+  if (!reserve(length))
+  {
+    invalidate();
+    return *this;
+  }
+  len = length;
+  memcpy(buffer, cstr, length);
+  buffer[len] = '\0';
+  return *this;
+}
+
+void String::move(String &rhs)
+{
+  if (buffer)
+  {
+    if (rhs && capacity >= rhs.len)
+    {
+      memcpy(buffer, rhs.buffer, rhs.len);
+      len = rhs.len;
+      buffer[len] = '\0';
+      rhs.len = 0;
+      return;
+    }
+    free(buffer);
+  }
+  buffer = rhs.buffer;
+  capacity = rhs.capacity;
+  len = rhs.len;
+  rhs.buffer = NULL;
+  rhs.capacity = 0;
+  rhs.len = 0;
+}
+
+String::String(const char *cstr)
+{
+  init();
+  if (cstr)
+  {
+    copy(cstr, strlen(cstr));
+  }
+}
+
+String::String(const char *cstr, unsigned int length)
+{
+  init();
+  if (cstr)
+  {
+    copy(cstr, length);
+  }
+}
+
+String::String(const String &value)
+{
+  init();
+  *this = value;
+}
+
+String::String(const __FlashStringHelper *pstr)
+{
+  init();
+  *this = pstr;
+}
+
+String::String(String &&rval)
+{
+  init();
+  move(rval);
+}
+
+String::String(StringSumHelper &&rval)
+{
+  init();
+  move(rval);
+}
+
+String::String(char c)
+{
+  init();
+  char buf[2];
+  buf[0] = c;
+  buf[1] = '\0';
+  *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base)
+{
+  init();
+  char buf[1 + 8 * sizeof(unsigned char)];
+  utoa(value, buf, base);
+  *this = buf;
+}
+
+String::String(int value, unsigned char base)
+{
+  init();
+  char buf[2 + 8 * sizeof(int)];
+  itoa(value, buf, base);
+  *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base)
+{
+  init();
+  char buf[1 + 8 * sizeof(unsigned int)];
+  utoa(value, buf, base);
+  *this = buf;
+}
+
+String::String(long value, unsigned char base)
+{
+  init();
+  char buf[2 + 8 * sizeof(long)];
+  ltoa(value, buf, base);
+  *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+  init();
+  char buf[1 + 8 * sizeof(unsigned long)];
+  ultoa(value, buf, base);
+  *this = buf;
+}
+
+String::String(float value, unsigned char decimalPlaces)
+{
+  init();
+  char buf[64];
+  *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+  init();
+  char buf[64];
+  *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::~String()
+{
+  if (buffer)
+  {
+    free(buffer);
+  }
+}
+
+String &String::operator=(const String &rhs)
+{
+  if (this == &rhs)
+  {
+    return *this;
+  }
+  if (rhs.buffer)
+  {
+    copy(rhs.buffer, rhs.len);
+  }
+  else
+  {
+    invalidate();
+  }
+  return *this;
+}
+
+String &String::operator=(String &&rval)
+{
+  if (this != &rval)
+  {
+    move(rval);
+  }
+  return *this;
+}
+
+String &String::operator=(StringSumHelper &&rval)
+{
+  if (this != &rval)
+  {
+    move(rval);
+  }
+  return *this;
+}
+
+String &String::operator=(const char *cstr)
+{
+  if (cstr)
+  {
+    copy(cstr, strlen(cstr));
+  }
+  else
+  {
+    invalidate();
+  }
+  return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *pstr)
+{
+  return *this = reinterpret_cast<const char *>(pstr);
+}
+
+bool String::concat(const String &s)
+{
+  return concat(s.buffer, s.len);
+}
+
+bool String::concat(const char *cstr, unsigned int length)
+{
+  unsigned int newlen = len + length;
+  if (!cstr)
+  {
+    return false;
+  }
+  if (length == 0)
+  {
+    return true;
+  }
+  if (!reserve(newlen))
+  {
+    return false;
+  }
+  memmove(buffer + len, cstr, length);
+  len = newlen;
+  buffer[len] = '\0';
+  return true;
+}
+
+bool String::concat(const char *cstr)
+{
+  return cstr != NULL && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c)
+{
+  char buf[2];
+  buf[0] = c;
+  buf[1] = '\0';
+  return concat(buf, 1);
+}
+
+bool String::concat(unsigned char num)
+{
+  char buf[1 + 3 * sizeof(unsigned char)];
+  itoa(num, buf, 10);
+  return concat(buf, strlen(buf));
+}
+
+bool String::concat(int num)
+{
+  char buf[2 + 3 * sizeof(int)];
+  itoa(num, buf, 10);
+  return concat(buf, strlen(buf));
+}
+
+bool String::concat(unsigned int num)
+{
+  char buf[1 + 3 * sizeof(unsigned int)];
+  utoa(num, buf, 10);
+  return concat(buf, strlen(buf));
+}
+
+bool String::concat(long num)
+{
+  char buf[2 + 3 * sizeof(long)];
+  ltoa(num, buf, 10);
+  return concat(buf, strlen(buf));
+}
+
+bool String::concat(unsigned long num)
+{
+  char buf[1 + 3 * sizeof(unsigned long)];
+  ultoa(num, buf, 10);
+  return concat(buf, strlen(buf));
+}
+
+bool String::concat(float num)
+{
+  char buf[64];
+  char *string = dtostrf(num, 4, 2, buf);
+  return concat(string, strlen(string));
+}
+
+bool String::concat(double num)
+{
+  char buf[64];
+  char *string = dtostrf(num, 4, 2, buf);
+  return concat(string, strlen(string));
+}
+
+bool String::concat(const __FlashStringHelper *str)
+{
+  return concat(reinterpret_cast<const char *>(str));
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const String &rhs)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(rhs.buffer, rhs.len))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const char *cstr)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!cstr || !a.concat(cstr, strlen(cstr)))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, char c)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(c))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, unsigned char num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, int num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, unsigned int num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, long num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, unsigned long num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, float num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, double num)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(num))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const __FlashStringHelper *rhs)
+{
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(rhs))
+  {
+    a.invalidate();
+  }
+  return a;
+}
+
+int String::compareTo(const String &s) const
+{
+  if (!buffer || !s.buffer)
+  {
+    if (s.buffer && s.len > 0)
+    {
+      return 0 - *(unsigned char *)s.buffer;
+    }
+    if (buffer && len > 0)
+    {
+      return *(unsigned char *)buffer;
+    }
+    return 0;
+  }
+  return strcmp(buffer, s.buffer);
+}
+
+bool String::equals(const String &s2) const
+{
+  return len == s2.len && compareTo(s2) == 0;
+}
+
+bool String::equals(const char *cstr) const
+{
+  if (len == 0)
+  {
+    return cstr == NULL || *cstr == 0;
+  }
+  if (cstr == NULL)
+  {
+    return buffer[0] == 0;
+  }
+  return strcmp(buffer, cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s2) const
+{
+  if (this == &s2)
+  {
+    return true;
+  }
+  if (len != s2.len)
+  {
+    return false;
+  }
+  if (len == 0)
+  {
+    return true;
+  }
+  const char *p1 = buffer;
+  const char *p2 = s2.buffer;
+  while (*p1)
+  {
+    if (tolower(*p1++) != tolower(*p2++))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool String::startsWith(const String &s2) const
+{
+  if (len < s2.len)
+  {
+    return false;
+  }
+  return startsWith(s2, 0);
+}
+
+bool String::startsWith(const String &s2, unsigned int offset) const
+{
+  if (offset > len - s2.len || !buffer || !s2.buffer)
+  {
+    return false;
+  }
+  return strncmp(&buffer[offset], s2.buffer, s2.len) == 0;
+}
+
+bool String::endsWith(const String &s2) const
+{
+  if (len < s2.len || !buffer || !s2.buffer)
+  {
+    return false;
+  }
+  return strcmp(&buffer[len - s2.len], s2.buffer) == 0;
+}
+
+char String::charAt(unsigned int loc) const
+{
+  return operator[](loc);
+}
+
+void String::setCharAt(unsigned int loc, char c)
+{
+  if (loc < len)
+  {
+    buffer[loc] = c;
+  }
+}
+
+char &String::operator[](unsigned int index)
+{
+  static char dummy_writable_char;
+  if (index >= len || !buffer)
+  {
+    dummy_writable_char = 0;
+    return dummy_writable_char;
+  }
+  return buffer[index];
+}
+
+char String::operator[](unsigned int index) const
+{
+  if (index >= len || !buffer)
+  {
+    return 0;
+  }
+  return buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+  if (!bufsize || !buf)
+  {
+    return;
+  }
+  if (index >= len)
+  {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = bufsize - 1;
+  if (n > len - index)
+  {
+    n = len - index;
+  }
+  strncpy((char *)buf, buffer + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char c) const
+{
+  return indexOf(c, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  if (fromIndex >= len)
+  {
+    return -1;
+  }
+  const char *temp = strchr(buffer + fromIndex, ch);
+  return temp == NULL ? -1 : temp - buffer;
+}
+
+int String::indexOf(const String &s2) const
+{
+  return indexOf(s2, 0);
+}
+
+int String::indexOf(const String &s2, unsigned int fromIndex) const
+{
+  if (fromIndex >= len)
+  {
+    return -1;
+  }
+  const char *found = strstr(buffer + fromIndex, s2.buffer);
+  return found == NULL ? -1 : found - buffer;
+}
+
+int String::lastIndexOf(char theChar) const
+{
+  return lastIndexOf(theChar, len - 1);
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const
+{
+  if (fromIndex >= len)
+  {
+    return -1;
+  }
+  for (int i = fromIndex; i >= 0; i--)
+  {
+    if (buffer[i] == ch)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int String::lastIndexOf(const String &s2) const
+{
+  return lastIndexOf(s2, len - s2.len);
+}
+
+int String::lastIndexOf(const String &s2, unsigned int fromIndex) const
+{
+  if (s2.len == 0 || len == 0 || s2.len > len)
+  {
+    return -1;
+  }
+  if (fromIndex >= len)
+  {
+    fromIndex = len - 1;
+  }
+  int found = -1;
+  for (char *p = buffer; p <= buffer + fromIndex; p++)
+  {
+    p = strstr(p, s2.buffer);
+    if (!p)
+    {
+      break;
+    }
+    if ((unsigned int)(p - buffer) <= fromIndex)
+    {
+      found = p - buffer;
+    }
+  }
+  return found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const
+{
+  if (left > right)
+  {
+    unsigned int temp = right;
+    right = left;
+    left = temp;
+  }
+  String out;
+  if (left >= len)
+  {
+    return out;
+  }
+  if (right > len)
+  {
+    right = len;
+  }
+  out.copy(buffer + left, right - left);
+  return out;
+}
+
+void String::replace(char find, char replace)
+{
+  if (!buffer)
+  {
+    return;
+  }
+  for (char *p = buffer; *p; p++)
+  {
+    if (*p == find)
+    {
+      *p = replace;
+    }
+  }
+}
+
+void String::replace(const String &find, const String &replace)
+{
+  if (len == 0 || find.len == 0)
+  {
+    return;
+  }
+  int diff = replace.len - find.len;
+  char *readFrom = buffer;
+  char *foundAt;
+  if (diff == 0)
+  {
+    while ((foundAt = strstr(readFrom, find.buffer)) != NULL)
+    {
+      memcpy(foundAt, replace.buffer, replace.len);
+      readFrom = foundAt + replace.len;
+    }
+  }
+  else if (diff < 0)
+  {
+    char *writeTo = buffer;
+    while ((foundAt = strstr(readFrom, find.buffer)) != NULL)
+    {
+      unsigned int n = foundAt - readFrom;
+      memmove(writeTo, readFrom, n);
+      writeTo += n;
+      memcpy(writeTo, replace.buffer, replace.len);
+      writeTo += replace.len;
+      readFrom = foundAt + find.len;
+      len += diff;
+    }
+    memmove(writeTo, readFrom, strlen(readFrom) + 1);
+  }
+  else
+  {
+    unsigned int size = len;
+    while ((foundAt = strstr(readFrom, find.buffer)) != NULL)
+    {
+      readFrom = foundAt + find.len;
+      size += diff;
+    }
+    if (size == len)
+    {
+      return;
+    }
+    if (size > capacity && !changeBuffer(size))
+    {
+      return;
+    }
+    int index = len - 1;
+    while (index >= 0 && (index = lastIndexOf(find, index)) >= 0)
+    {
+      readFrom = buffer + index + find.len;
+      memmove(readFrom + diff, readFrom, len - (readFrom - buffer));
+      len += diff;
+      buffer[len] = 0;
+      memcpy(buffer + index, replace.buffer, replace.len);
+      index--;
+    }
+  }
+}
+
+void String::remove(unsigned int index)
+{
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index >= len)
+  {
+    return;
+  }
+  if (count <= 0)
+  {
+    return;
+  }
+  if (count > len - index)
+  {
+    count = len - index;
+  }
+  char *writeTo = buffer + index;
+  len = len - count;
+  memmove(writeTo, buffer + index + count, len - index);
+  buffer[len] = 0;
+}
+
+void String::toLowerCase(void)
+{
+  if (!buffer)
+  {
+    return;
+  }
+  for (char *p = buffer; *p; p++)
+  {
+    *p = tolower(*p);
+  }
+}
+
+void String::toUpperCase(void)
+{
+  if (!buffer)
+  {
+    return;
+  }
+  for (char *p = buffer; *p; p++)
+  {
+    *p = toupper(*p);
+  }
+}
+
+void String::trim(void)
+{
+  if (!buffer || len == 0)
+  {
+    return;
+  }
+  char *begin = buffer;
+  while (isspace(*begin))
+  {
+    begin++;
+  }
+  char *end = buffer + len - 1;
+  while (isspace(*end) && end >= begin)
+  {
+    end--;
+  }
+  len = end + 1 - begin;
+  if (begin > buffer)
+  {
+    memmove(buffer, begin, len);
+  }
+  buffer[len] = 0;
+}
+
+long String::toInt(void) const
+{
+  return buffer ? atol(buffer) : 0;
+}
+
+float String::toFloat(void) const
+{
+  return float(toDouble());
+}
+
+double String::toDouble(void) const
+{
+  return buffer ? atof(buffer) : 0;
+}
+
+// IPAddress, bytes in network order, uint32_t value is raw memory as on the board
+
+IPAddress::IPAddress()
+{
+  memset(bytes, 0, sizeof(bytes));
+}
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+{
+  bytes[0] = first;
+  bytes[1] = second;
+  bytes[2] = third;
+  bytes[3] = fourth;
+}
+
+IPAddress::IPAddress(uint32_t address)
+{
+  memcpy(bytes, &address, sizeof(bytes));
+}
+
+IPAddress::IPAddress(const uint8_t *address)
+{
+  memcpy(bytes, address, sizeof(bytes));
+}
+
+IPAddress::operator uint32_t() const
+{
+  uint32_t address;
+  memcpy(&address, bytes, sizeof(address));
+  return address;
+}
+
+bool IPAddress::fromString(const char *address)
+{
+  uint16_t acc = 0;
+  uint8_t dots = 0;
+  while (*address)
+  {
+    char c = *address++;
+    if (c >= '0' && c <= '9')
+    {
+      acc = acc * 10 + (c - '0');
+      if (acc > 255)
+      {
+        return false;
+      }
+    }
+    else if (c == '.')
+    {
+      if (dots == 3)
+      {
+        return false;
+      }
+      bytes[dots++] = acc;
+      acc = 0;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  if (dots != 3)
+  {
+    return false;
+  }
+  bytes[3] = acc;
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char szRet[16];
+  sprintf(szRet, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+  return String(szRet);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  size_t n = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    n += p.print(bytes[i], DEC);
+    n += p.print('.');
+  }
+  n += p.print(bytes[3], DEC);
+  return n;
+}
+
+// Serial
+
+void HostSerial::begin(unsigned long baud)
+{
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+  if (serialEcho)
+  {
+    fputc(c, stdout);
+  }
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (serialEcho)
+  {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
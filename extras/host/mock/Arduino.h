@@ -0,0 +1,359 @@
+#ifndef WIFISENSORS_HOST_ARDUINO_H
+#define WIFISENSORS_HOST_ARDUINO_H
+
+/*
+Host implementation of the part of the Arduino SAMD core the sketch uses.
+String keeps core allocation behaviour (malloc/realloc of exact length + 1, empty literal allocates), so heap operations
+counted on host match the board. Time is virtual: millis/micros advance by WS_HOST_CLOCK_STEP us per call and delay
+advances by its argument, harness moves it with hostAdvance, so timeouts do not wait and runs are repeatable.
+*/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+enum
+{
+  A0 = 14,
+  A1,
+  A2,
+  A3,
+  A4,
+  A5,
+  A6,
+  A7
+};
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PSTR(s) (s)
+#define PROGMEM
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint32_t pin, uint32_t mode);
+int digitalRead(uint32_t pin);
+void digitalWrite(uint32_t pin, uint32_t value);
+int analogRead(uint32_t pin);
+void analogWrite(uint32_t pin, int value);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void NVIC_SystemReset();
+
+char *itoa(int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *utoa(unsigned value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+char *dtostrf(double value, signed char width, unsigned char prec, char *str);
+
+class String;
+class Print;
+
+class Printable
+{
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+public:
+  Print() : writeError(0) {}
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str)
+  {
+    return str == NULL ? 0 : write((const uint8_t *)str, strlen(str));
+  }
+  size_t write(const char *buffer, size_t size)
+  {
+    return write((const uint8_t *)buffer, size);
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  int getWriteError() { return writeError; }
+  void clearWriteError() { writeError = 0; }
+
+  size_t print(const __FlashStringHelper *);
+  size_t print(const String &);
+  size_t print(const char[]);
+  size_t print(char);
+  size_t print(unsigned char, int = DEC);
+  size_t print(int, int = DEC);
+  size_t print(unsigned int, int = DEC);
+  size_t print(long, int = DEC);
+  size_t print(unsigned long, int = DEC);
+  size_t print(long long, int = DEC);
+  size_t print(unsigned long long, int = DEC);
+  size_t print(double, int = 2);
+  size_t print(const Printable &);
+
+  size_t println(const __FlashStringHelper *);
+  size_t println(const String &s);
+  size_t println(const char[]);
+  size_t println(char);
+  size_t println(unsigned char, int = DEC);
+  size_t println(int, int = DEC);
+  size_t println(unsigned int, int = DEC);
+  size_t println(long, int = DEC);
+  size_t println(unsigned long, int = DEC);
+  size_t println(long long, int = DEC);
+  size_t println(unsigned long long, int = DEC);
+  size_t println(double, int = 2);
+  size_t println(const Printable &);
+  size_t println(void);
+
+protected:
+  void setWriteError(int err = 1) { writeError = err; }
+
+private:
+  int writeError;
+  size_t printNumber(unsigned long long n, uint8_t base);
+  size_t printFloat(double number, uint8_t digits);
+};
+
+class Stream : public Print
+{
+public:
+  Stream() : timeout(1000) {}
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout);
+  unsigned long getTimeout() { return timeout; }
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+protected:
+  int timedRead();
+  unsigned long timeout;
+};
+
+class StringSumHelper;
+
+class String
+{
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const String &str);
+  String(const __FlashStringHelper *str);
+  String(String &&rval);
+  String(StringSumHelper &&rval);
+  explicit String(char c);
+  explicit String(unsigned char, unsigned char base = 10);
+  explicit String(int, unsigned char base = 10);
+  explicit String(unsigned int, unsigned char base = 10);
+  explicit String(long, unsigned char base = 10);
+  explicit String(unsigned long, unsigned char base = 10);
+  explicit String(float, unsigned char decimalPlaces = 2);
+  explicit String(double, unsigned char decimalPlaces = 2);
+  ~String();
+
+  bool reserve(unsigned int size);
+  unsigned int length(void) const { return len; }
+
+  String &operator=(const String &rhs);
+  String &operator=(const char *cstr);
+  String &operator=(const __FlashStringHelper *str);
+  String &operator=(String &&rval);
+  String &operator=(StringSumHelper &&rval);
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(char c);
+  bool concat(unsigned char num);
+  bool concat(int num);
+  bool concat(unsigned int num);
+  bool concat(long num);
+  bool concat(unsigned long num);
+  bool concat(float num);
+  bool concat(double num);
+  bool concat(const __FlashStringHelper *str);
+
+  String &operator+=(const String &rhs) { concat(rhs); return *this; }
+  String &operator+=(const char *cstr) { concat(cstr); return *this; }
+  String &operator+=(char c) { concat(c); return *this; }
+  String &operator+=(unsigned char num) { concat(num); return *this; }
+  String &operator+=(int num) { concat(num); return *this; }
+  String &operator+=(unsigned int num) { concat(num); return *this; }
+  String &operator+=(long num) { concat(num); return *this; }
+  String &operator+=(unsigned long num) { concat(num); return *this; }
+  String &operator+=(float num) { concat(num); return *this; }
+  String &operator+=(double num) { concat(num); return *this; }
+  String &operator+=(const __FlashStringHelper *str) { concat(str); return *this; }
+
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const String &rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const char *cstr);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, char c);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned char num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, int num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned int num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, float num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, double num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const __FlashStringHelper *rhs);
+
+  // pointer to member instead of bool, so String does not take part in integer arithmetic overloads
+  typedef void (String::*StringIfHelperType)() const;
+  void StringIfHelper() const {}
+  operator StringIfHelperType() const { return buffer ? &String::StringIfHelper : 0; }
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const;
+  bool equals(const char *cstr) const;
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+  bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+  bool equalsIgnoreCase(const String &s) const;
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+  {
+    getBytes((unsigned char *)buf, bufsize, index);
+  }
+  const char *c_str() const { return buffer; }
+  char *begin() { return buffer; }
+  char *end() { return buffer + length(); }
+  const char *begin() const { return c_str(); }
+  const char *end() const { return c_str() + length(); }
+
+  int indexOf(char ch) const;
+  int indexOf(char ch, unsigned int fromIndex) const;
+  int indexOf(const String &str) const;
+  int indexOf(const String &str, unsigned int fromIndex) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(char ch, unsigned int fromIndex) const;
+  int lastIndexOf(const String &str) const;
+  int lastIndexOf(const String &str, unsigned int fromIndex) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, len); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase(void);
+  void toUpperCase(void);
+  void trim(void);
+
+  long toInt(void) const;
+  float toFloat(void) const;
+  double toDouble(void) const;
+
+protected:
+  char *buffer;
+  unsigned int capacity;
+  unsigned int len;
+
+  void init(void);
+  void invalidate(void);
+  bool changeBuffer(unsigned int maxStrLen);
+  String &copy(const char *cstr, unsigned int length);
+  void move(String &rhs);
+};
+
+class StringSumHelper : public String
+{
+public:
+  StringSumHelper(const String &s) : String(s) {}
+  StringSumHelper(const char *p) : String(p) {}
+  StringSumHelper(char c) : String(c) {}
+  StringSumHelper(unsigned char num) : String(num) {}
+  StringSumHelper(int num) : String(num) {}
+  StringSumHelper(unsigned int num) : String(num) {}
+  StringSumHelper(long num) : String(num) {}
+  StringSumHelper(unsigned long num) : String(num) {}
+  StringSumHelper(float num) : String(num) {}
+  StringSumHelper(double num) : String(num) {}
+};
+
+class IPAddress : public Printable
+{
+public:
+  IPAddress();
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+  IPAddress(uint32_t address);
+  IPAddress(const uint8_t *address);
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) { return fromString(address.c_str()); }
+
+  operator uint32_t() const;
+  bool operator==(const IPAddress &addr) const { return (uint32_t) * this == (uint32_t)addr; }
+  uint8_t operator[](int index) const { return bytes[index]; }
+  uint8_t &operator[](int index) { return bytes[index]; }
+
+  String toString() const;
+  size_t printTo(Print &p) const;
+
+private:
+  uint8_t bytes[4];
+};
+
+// USB serial, output goes to stdout when WS_HOST_SERIAL is set in environment
+class HostSerial : public Stream
+{
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  operator bool() { return true; }
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef WIFISENSORS_HOST_ARRAY_H
+#define WIFISENSORS_HOST_ARRAY_H
+
+// fixed capacity array with size, same interface as the Array library
+
+#include <stddef.h>
+
+template <typename T, size_t MAX_SIZE>
+class Array
+{
+public:
+  Array() : size_(0) {}
+
+  T &operator[](size_t index) { return values_[index]; }
+  const T &operator[](size_t index) const { return values_[index]; }
+  T &at(size_t index) { return values_[index]; }
+  T *data() { return values_; }
+  size_t size() const { return size_; }
+  size_t max_size() const { return MAX_SIZE; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == MAX_SIZE; }
+  T &front() { return values_[0]; }
+  T &back() { return values_[size_ - 1]; }
+  T *begin() { return values_; }
+  T *end() { return values_ + size_; }
+
+  void push_back(const T &value)
+  {
+    if (size_ < MAX_SIZE)
+    {
+      values_[size_++] = value;
+    }
+  }
+
+  void pop_back()
+  {
+    if (size_ > 0)
+    {
+      size_--;
+    }
+  }
+
+  void clear() { size_ = 0; }
+
+  void remove(size_t index)
+  {
+    if (index < size_)
+    {
+      for (size_t i = index; i + 1 < size_; i++)
+      {
+        values_[i] = values_[i + 1];
+      }
+      size_--;
+    }
+  }
+
+private:
+  T values_[MAX_SIZE];
+  size_t size_;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef WIFISENSORS_HOST_BOUNCE2_H
+#define WIFISENSORS_HOST_BOUNCE2_H
+
+// debouncer reading pin levels set by harness, state changes once pin stays for interval ms
+
+#include <Arduino.h>
+
+class Debouncer
+{
+public:
+  Debouncer() : intervalMs(10), state(false), lastState(false), changed(0) {}
+  virtual ~Debouncer() {}
+
+  void interval(uint16_t ms) { intervalMs = ms; }
+
+  bool update()
+  {
+    bool current = readCurrentState() != 0;
+    lastState = state;
+    if (current != state && millis() - changed >= intervalMs)
+    {
+      state = current;
+      changed = millis();
+      return true;
+    }
+    return false;
+  }
+
+  bool read() const { return state; }
+  bool fell() const { return lastState && !state; }
+  bool rose() const { return !lastState && state; }
+
+protected:
+  virtual bool readCurrentState() = 0;
+  uint16_t intervalMs;
+  bool state;
+  bool lastState;
+  unsigned long changed;
+};
+
+class Bounce : public Debouncer
+{
+public:
+  Bounce() : pin(0) {}
+
+  void attach(int pin)
+  {
+    this->pin = pin;
+    state = readCurrentState();
+    lastState = state;
+  }
+
+  void attach(int pin, int mode)
+  {
+    pinMode(pin, mode);
+    attach(pin);
+  }
+
+protected:
+  bool readCurrentState() { return digitalRead(pin) != 0; }
+  int pin;
+};
+
+#endif
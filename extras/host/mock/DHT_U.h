@@ -0,0 +1,93 @@
+#ifndef WIFISENSORS_HOST_DHT_U_H
+#define WIFISENSORS_HOST_DHT_U_H
+
+// DHT22 returning fixed 21.5 C and 45 %, pin level LOW makes it fail (NaN) like a disconnected sensor
+
+#include <Arduino.h>
+
+#define DHT22 22
+
+typedef struct
+{
+  int32_t version;
+  int32_t sensor_id;
+  int32_t type;
+  int32_t reserved0;
+  int32_t timestamp;
+  float temperature;
+  float relative_humidity;
+} sensors_event_t;
+
+typedef struct
+{
+  char name[12];
+  int32_t version;
+  int32_t sensor_id;
+  int32_t type;
+  float max_value;
+  float min_value;
+  float resolution;
+  int32_t min_delay;
+} sensor_t;
+
+class DHT_Unified
+{
+public:
+  DHT_Unified(uint8_t pin, uint8_t type, uint8_t count = 6, int32_t tempSensorId = -1, int32_t humiditySensorId = -1)
+      : pin(pin) {}
+
+  void begin() {}
+
+  class Temperature
+  {
+  public:
+    Temperature(DHT_Unified *parent) : parent(parent) {}
+    bool getEvent(sensors_event_t *event)
+    {
+      memset(event, 0, sizeof(sensors_event_t));
+      event->timestamp = millis();
+      event->temperature = parent->present() ? 21.5f : NAN;
+      return true;
+    }
+    void getSensor(sensor_t *sensor)
+    {
+      memset(sensor, 0, sizeof(sensor_t));
+      strncpy(sensor->name, "DHT22", sizeof(sensor->name) - 1);
+      sensor->min_delay = 2000000L;
+    }
+
+  private:
+    DHT_Unified *parent;
+  };
+
+  class Humidity
+  {
+  public:
+    Humidity(DHT_Unified *parent) : parent(parent) {}
+    bool getEvent(sensors_event_t *event)
+    {
+      memset(event, 0, sizeof(sensors_event_t));
+      event->timestamp = millis();
+      event->relative_humidity = parent->present() ? 45.0f : NAN;
+      return true;
+    }
+    void getSensor(sensor_t *sensor)
+    {
+      memset(sensor, 0, sizeof(sensor_t));
+      strncpy(sensor->name, "DHT22", sizeof(sensor->name) - 1);
+      sensor->min_delay = 2000000L;
+    }
+
+  private:
+    DHT_Unified *parent;
+  };
+
+  Temperature temperature() { return Temperature(this); }
+  Humidity humidity() { return Humidity(this); }
+
+private:
+  bool present() { return digitalRead(pin) != LOW; }
+  uint8_t pin;
+};
+
+#endif
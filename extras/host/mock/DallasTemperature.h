@@ -0,0 +1,65 @@
+#ifndef WIFISENSORS_HOST_DALLASTEMPERATURE_H
+#define WIFISENSORS_HOST_DALLASTEMPERATURE_H
+
+// DallasTemperature over host OneWire bus, which has no sensors
+
+#include <OneWire.h>
+
+typedef uint8_t DeviceAddress[8];
+
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature
+{
+public:
+  struct request_t
+  {
+    bool result;
+    unsigned long timestamp;
+    operator bool() { return result; }
+  };
+
+  DallasTemperature() : wire(NULL), resolution(12), waitForConversion(true) {}
+  DallasTemperature(OneWire *wire) : wire(wire), resolution(12), waitForConversion(true) {}
+
+  void setOneWire(OneWire *wire) { this->wire = wire; }
+  void begin(void) {}
+  uint8_t getDeviceCount(void) { return 0; }
+  uint8_t getDS18Count(void) { return 0; }
+  bool validAddress(const uint8_t *address) { return OneWire::crc8(address, 7) == address[7]; }
+  bool validFamily(const uint8_t *address) { return address[0] == 0x28; }
+  bool getAddress(uint8_t *address, uint8_t index) { return false; }
+  bool isConnected(const uint8_t *address) { return false; }
+  uint8_t getResolution() { return resolution; }
+  void setResolution(uint8_t bits) { resolution = bits; }
+  uint8_t getResolution(const uint8_t *address) { return resolution; }
+  bool setResolution(const uint8_t *address, uint8_t bits, bool skipGlobalBitResolutionCalculation = false) { return false; }
+  void setWaitForConversion(bool wait) { waitForConversion = wait; }
+  bool getWaitForConversion(void) { return waitForConversion; }
+  void setCheckForConversion(bool check) {}
+
+  request_t requestTemperatures(void)
+  {
+    request_t request = {true, millis()};
+    return request;
+  }
+
+  request_t requestTemperaturesByAddress(const uint8_t *address)
+  {
+    request_t request = {false, millis()};
+    return request;
+  }
+
+  bool isConversionComplete(void) { return true; }
+  uint16_t millisToWaitForConversion(uint8_t bits) { return 750 / (1 << (12 - bits)); }
+  uint16_t millisToWaitForConversion() { return millisToWaitForConversion(resolution); }
+  float getTempC(const uint8_t *address) { return DEVICE_DISCONNECTED_C; }
+  float getTempCByIndex(uint8_t index) { return DEVICE_DISCONNECTED_C; }
+
+private:
+  OneWire *wire;
+  uint8_t resolution;
+  bool waitForConversion;
+};
+
+#endif
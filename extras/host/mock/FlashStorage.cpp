@@ -0,0 +1,23 @@
+#include "FlashStorage.h"
+
+void FlashClass::write(const volatile void *flashPtr, const void *data, uint32_t size)
+{
+  volatile uint8_t *dst = (volatile uint8_t *)flashPtr;
+  const uint8_t *src = (const uint8_t *)data;
+  for (uint32_t i = 0; i < size; i++)
+  {
+    dst[i] &= src[i];
+  }
+}
+
+void FlashClass::erase(const volatile void *flashPtr, uint32_t size)
+{
+  uintptr_t start = (uintptr_t)flashPtr & ~(uintptr_t)(WS_HOST_FLASH_ROW - 1);
+  uintptr_t end = ((uintptr_t)flashPtr + size + WS_HOST_FLASH_ROW - 1) & ~(uintptr_t)(WS_HOST_FLASH_ROW - 1);
+  memset((void *)start, 0xFF, end - start);
+}
+
+void FlashClass::read(const volatile void *flashPtr, void *data, uint32_t size)
+{
+  memcpy(data, (const void *)flashPtr, size);
+}
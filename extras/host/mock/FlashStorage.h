@@ -0,0 +1,67 @@
+#ifndef WIFISENSORS_HOST_FLASHSTORAGE_H
+#define WIFISENSORS_HOST_FLASHSTORAGE_H
+
+/*
+FlashStorage on RAM: region defined by Flash() is a zeroed array as after upload, erase sets rows (256 bytes) to 0xFF,
+write can only clear bits like programming NOR flash does, so code which writes without erase misbehaves as on the board.
+*/
+
+#include <Arduino.h>
+
+#define WS_HOST_FLASH_ROW 256
+
+class FlashClass
+{
+public:
+  FlashClass(const void *flashAddr = NULL, uint32_t size = 0) : flashAddress(flashAddr), flashSize(size) {}
+
+  void write(const void *data) { write(flashAddress, data, flashSize); }
+  void erase() { erase(flashAddress, flashSize); }
+  void read(void *data) { read(flashAddress, data, flashSize); }
+
+  void write(const volatile void *flashPtr, const void *data, uint32_t size);
+  void erase(const volatile void *flashPtr, uint32_t size);
+  void read(const volatile void *flashPtr, void *data, uint32_t size);
+
+private:
+  const void *flashAddress;
+  const uint32_t flashSize;
+};
+
+template <class T>
+class FlashStorageClass
+{
+public:
+  FlashStorageClass(const void *flashAddr) : flash(flashAddr, sizeof(T)) {}
+
+  void write(T data)
+  {
+    flash.erase();
+    flash.write(&data);
+  }
+
+  void read(T *data) { flash.read(data); }
+
+  T read()
+  {
+    T data;
+    read(&data);
+    return data;
+  }
+
+private:
+  FlashClass flash;
+};
+
+#define PPCAT_NX(A, B) A##B
+#define PPCAT(A, B) PPCAT_NX(A, B)
+
+#define Flash(name, size)                                                           \
+  __attribute__((__aligned__(256))) static uint8_t PPCAT(_data, name)[(size + 255) / 256 * 256] = {}; \
+  FlashClass name(PPCAT(_data, name), size);
+
+#define FlashStorage(name, T)                                                        \
+  __attribute__((__aligned__(256))) static uint8_t PPCAT(_data, name)[(sizeof(T) + 255) / 256 * 256] = {}; \
+  FlashStorageClass<T> name(PPCAT(_data, name));
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef WIFISENSORS_HOST_ONEWIRE_H
+#define WIFISENSORS_HOST_ONEWIRE_H
+
+// bus without devices
+
+#include <Arduino.h>
+
+class OneWire
+{
+public:
+  OneWire() : pin(0) {}
+  OneWire(uint8_t pin) : pin(pin) {}
+  void begin(uint8_t pin) { this->pin = pin; }
+  uint8_t reset() { return 0; }
+  void reset_search() {}
+  bool search(uint8_t *newAddr, bool searchMode = true) { return false; }
+
+  static uint8_t crc8(const uint8_t *addr, uint8_t len)
+  {
+    uint8_t crc = 0;
+    while (len--)
+    {
+      uint8_t inbyte = *addr++;
+      for (uint8_t i = 8; i; i--)
+      {
+        uint8_t mix = (crc ^ inbyte) & 0x01;
+        crc >>= 1;
+        if (mix)
+        {
+          crc ^= 0x8C;
+        }
+        inbyte >>= 1;
+      }
+    }
+    return crc;
+  }
+
+private:
+  uint8_t pin;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef WIFISENSORS_HOST_SPI_H
+#define WIFISENSORS_HOST_SPI_H
+
+// WiFiNINA talks to the module over SPI, host WiFiNINA does not need it
+
+#endif
@@ -0,0 +1,465 @@
+#include "WiFiNINA.h"
+
+#include "../WifiSensorsHost.h"
+
+#define HOST_SOCKET_CLOSED 0
+#define HOST_SOCKET_ESTABLISHED 4
+
+typedef struct
+{
+  bool used;
+  bool inbound;
+  bool boardOpen;
+  bool peerOpen;
+  uint16_t port;
+  size_t rxStart;
+  size_t rxEnd;
+  size_t txLen;
+  uint8_t rx[WS_HOST_RX];
+  uint8_t tx[WS_HOST_TX];
+} HostSocket;
+
+WiFiClass WiFi;
+
+static HostSocket sockets[WS_HOST_SOCKETS];
+static byte serverNext = 0;
+static bool acceptOutbound = false;
+static int lastOutbound = -1;
+static unsigned long outboundCount = 0;
+
+static bool moduleAvailable = true;
+static uint8_t wifiStatus = WL_IDLE_STATUS;
+static char wifiSsid[33];
+static uint32_t staticIp = 0;
+
+static HostSocket *hostSocket(uint8_t sock)
+{
+  return sock < WS_HOST_SOCKETS && sockets[sock].used ? &sockets[sock] : NULL;
+}
+
+static int hostSocketOpen(bool inbound, uint16_t port)
+{
+  for (int i = 0; i < WS_HOST_SOCKETS; i++)
+  {
+    if (!sockets[i].used)
+    {
+      HostSocket &s = sockets[i];
+      s.used = true;
+      s.inbound = inbound;
+      s.boardOpen = true;
+      s.peerOpen = true;
+      s.port = port;
+      s.rxStart = 0;
+      s.rxEnd = 0;
+      s.txLen = 0;
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void hostSocketRelease(HostSocket &s)
+{
+  if (!s.boardOpen && !s.peerOpen)
+  {
+    s.used = false;
+  }
+}
+
+static size_t hostSocketWrite(HostSocket *s, const uint8_t *buf, size_t size)
+{
+  if (s == NULL || !s->boardOpen || !s->peerOpen)
+  {
+    return 0;
+  }
+  size_t n = WS_HOST_TX - s->txLen < size ? WS_HOST_TX - s->txLen : size;
+  memcpy(s->tx + s->txLen, buf, n);
+  s->txLen += n;
+  return n;
+}
+
+// harness side
+
+int hostConnect(uint16_t port)
+{
+  return hostSocketOpen(true, port);
+}
+
+size_t hostSend(int sock, const char *data, size_t len)
+{
+  HostSocket *s = hostSocket(sock);
+  if (s == NULL || !s->peerOpen)
+  {
+    return 0;
+  }
+  if (s->rxStart == s->rxEnd)
+  {
+    s->rxStart = 0;
+    s->rxEnd = 0;
+  }
+  size_t n = WS_HOST_RX - s->rxEnd < len ? WS_HOST_RX - s->rxEnd : len;
+  memcpy(s->rx + s->rxEnd, data, n);
+  s->rxEnd += n;
+  return n;
+}
+
+size_t hostSend(int sock, const char *data)
+{
+  return hostSend(sock, data, strlen(data));
+}
+
+size_t hostReceive(int sock, char *out, size_t size)
+{
+  HostSocket *s = hostSocket(sock);
+  if (s == NULL)
+  {
+    return 0;
+  }
+  size_t n = s->txLen < size ? s->txLen : size;
+  memcpy(out, s->tx, n);
+  memmove(s->tx, s->tx + n, s->txLen - n);
+  s->txLen -= n;
+  return n;
+}
+
+bool hostClosed(int sock)
+{
+  HostSocket *s = hostSocket(sock);
+  return s == NULL || !s->boardOpen;
+}
+
+void hostClose(int sock)
+{
+  HostSocket *s = hostSocket(sock);
+  if (s != NULL)
+  {
+    s->peerOpen = false;
+    hostSocketRelease(*s);
+  }
+}
+
+void hostAcceptOutbound(bool accept)
+{
+  acceptOutbound = accept;
+}
+
+int hostLastOutbound()
+{
+  return lastOutbound;
+}
+
+unsigned long hostOutboundCount()
+{
+  return outboundCount;
+}
+
+void hostCloseOutbound()
+{
+  for (int i = 0; i < WS_HOST_SOCKETS; i++)
+  {
+    if (sockets[i].used && !sockets[i].inbound)
+    {
+      hostClose(i);
+    }
+  }
+}
+
+void hostWiFiAvailable(bool available)
+{
+  moduleAvailable = available;
+}
+
+void hostWiFiDrop()
+{
+  if (wifiStatus == WL_CONNECTED)
+  {
+    wifiStatus = WL_CONNECTION_LOST;
+  }
+}
+
+// WiFiClient
+
+uint8_t WiFiClient::status()
+{
+  return connected() ? HOST_SOCKET_ESTABLISHED : HOST_SOCKET_CLOSED;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+  if (!acceptOutbound || wifiStatus != WL_CONNECTED)
+  {
+    return 0;
+  }
+  int s = hostSocketOpen(false, port);
+  if (s < 0)
+  {
+    return 0;
+  }
+  sock = s;
+  lastOutbound = s;
+  outboundCount++;
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  return connect(IPAddress(192, 168, 1, 2), port);
+}
+
+size_t WiFiClient::write(uint8_t b)
+{
+  return write(&b, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+  size_t n = hostSocketWrite(hostSocket(sock), buf, size);
+  if (n < size)
+  {
+    setWriteError();
+  }
+  return n;
+}
+
+int WiFiClient::available()
+{
+  HostSocket *s = hostSocket(sock);
+  return s == NULL || !s->boardOpen ? 0 : (int)(s->rxEnd - s->rxStart);
+}
+
+int WiFiClient::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+  HostSocket *s = hostSocket(sock);
+  if (s == NULL || !s->boardOpen || s->rxStart == s->rxEnd)
+  {
+    return -1;
+  }
+  size_t n = s->rxEnd - s->rxStart < size ? s->rxEnd - s->rxStart : size;
+  memcpy(buf, s->rx + s->rxStart, n);
+  s->rxStart += n;
+  return n;
+}
+
+int WiFiClient::peek()
+{
+  HostSocket *s = hostSocket(sock);
+  if (s == NULL || !s->boardOpen || s->rxStart == s->rxEnd)
+  {
+    return -1;
+  }
+  return s->rx[s->rxStart];
+}
+
+void WiFiClient::stop()
+{
+  HostSocket *s = hostSocket(sock);
+  if (s != NULL)
+  {
+    s->boardOpen = false;
+    hostSocketRelease(*s);
+  }
+  sock = NO_SOCKET_AVAIL;
+}
+
+uint8_t WiFiClient::connected()
+{
+  HostSocket *s = hostSocket(sock);
+  return s != NULL && s->boardOpen && (s->peerOpen || s->rxStart != s->rxEnd);
+}
+
+IPAddress WiFiClient::remoteIP()
+{
+  return IPAddress(192, 168, 1, 10);
+}
+
+uint16_t WiFiClient::remotePort()
+{
+  return 40000 + sock;
+}
+
+// WiFiServer
+
+void WiFiServer::begin()
+{
+  listening = true;
+}
+
+uint8_t WiFiServer::status()
+{
+  return listening ? 1 : 0;
+}
+
+WiFiClient WiFiServer::available(uint8_t *status)
+{
+  if (!listening)
+  {
+    return WiFiClient();
+  }
+  for (byte n = 0; n < WS_HOST_SOCKETS; n++)
+  {
+    byte i = (serverNext + n) % WS_HOST_SOCKETS;
+    HostSocket &s = sockets[i];
+    if (s.used && s.inbound && s.port == port && s.boardOpen && s.rxStart != s.rxEnd)
+    {
+      serverNext = (i + 1) % WS_HOST_SOCKETS;
+      return WiFiClient(i);
+    }
+  }
+  return WiFiClient();
+}
+
+size_t WiFiServer::write(uint8_t b)
+{
+  return write(&b, 1);
+}
+
+size_t WiFiServer::write(const uint8_t *buf, size_t size)
+{
+  size_t n = 0;
+  for (byte i = 0; i < WS_HOST_SOCKETS; i++)
+  {
+    if (sockets[i].used && sockets[i].inbound && sockets[i].port == port)
+    {
+      n = hostSocketWrite(&sockets[i], buf, size);
+    }
+  }
+  return n;
+}
+
+// WiFiClass
+
+const char *WiFiClass::firmwareVersion()
+{
+  return WIFI_FIRMWARE_LATEST_VERSION;
+}
+
+int WiFiClass::begin(const char *ssid)
+{
+  return begin(ssid, "");
+}
+
+int WiFiClass::begin(const char *ssid, const char *passphrase)
+{
+  strncpy(wifiSsid, ssid, sizeof(wifiSsid) - 1);
+  wifiStatus = moduleAvailable ? WL_CONNECTED : WL_CONNECT_FAILED;
+  return wifiStatus;
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid)
+{
+  return beginAP(ssid, 1);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, uint8_t channel)
+{
+  strncpy(wifiSsid, ssid, sizeof(wifiSsid) - 1);
+  wifiStatus = moduleAvailable ? WL_AP_LISTENING : WL_AP_FAILED;
+  return wifiStatus;
+}
+
+void WiFiClass::config(IPAddress localIp)
+{
+  staticIp = (uint32_t)localIp;
+}
+
+void WiFiClass::config(IPAddress localIp, IPAddress dnsServer)
+{
+  config(localIp);
+}
+
+void WiFiClass::config(IPAddress localIp, IPAddress dnsServer, IPAddress gateway)
+{
+  config(localIp);
+}
+
+void WiFiClass::config(IPAddress localIp, IPAddress dnsServer, IPAddress gateway, IPAddress subnet)
+{
+  config(localIp);
+}
+
+void WiFiClass::setDNS(IPAddress dnsServer)
+{
+}
+
+void WiFiClass::setTimeout(unsigned long timeout)
+{
+}
+
+void WiFiClass::disconnect()
+{
+  wifiStatus = WL_DISCONNECTED;
+}
+
+void WiFiClass::end()
+{
+  wifiStatus = WL_IDLE_STATUS;
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac)
+{
+  const uint8_t address[6] = {0x01, 0x02, 0x03, 0xA4, 0xAE, 0x30};
+  memcpy(mac, address, sizeof(address));
+  return mac;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  if (wifiStatus != WL_CONNECTED && wifiStatus != WL_AP_LISTENING && wifiStatus != WL_AP_CONNECTED)
+  {
+    return IPAddress();
+  }
+  return staticIp != 0 ? IPAddress(staticIp) : IPAddress(192, 168, 1, 50);
+}
+
+IPAddress WiFiClass::subnetMask()
+{
+  return IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::gatewayIP()
+{
+  return IPAddress(192, 168, 1, 1);
+}
+
+const char *WiFiClass::SSID()
+{
+  return wifiSsid;
+}
+
+uint8_t *WiFiClass::BSSID(uint8_t *bssid)
+{
+  const uint8_t address[6] = {0x66, 0x55, 0x44, 0x33, 0x22, 0x11};
+  memcpy(bssid, address, sizeof(address));
+  return bssid;
+}
+
+int32_t WiFiClass::RSSI()
+{
+  return wifiStatus == WL_CONNECTED ? -55 : 0;
+}
+
+uint8_t WiFiClass::encryptionType()
+{
+  return 4;
+}
+
+uint8_t WiFiClass::status()
+{
+  return wifiStatus;
+}
+
+unsigned long WiFiClass::getTime()
+{
+  return wifiStatus == WL_CONNECTED ? 1700000000UL + millis() / 1000 : 0;
+}
+
+int WiFiClass::ping(const char *hostname, uint8_t ttl)
+{
+  return wifiStatus == WL_CONNECTED ? 1 : -1;
+}
@@ -0,0 +1,109 @@
+#ifndef WIFISENSORS_HOST_WIFININA_H
+#define WIFISENSORS_HOST_WIFININA_H
+
+/*
+Host WiFiNINA: module associates at once (unless made unavailable by harness), sockets are in memory buffers
+shared with the harness (WifiSensorsHost.h). WiFiClient is a copyable socket index as in the library,
+WiFiServer::available returns an accepted socket with data waiting, like NINA firmware does.
+*/
+
+#include <Arduino.h>
+
+enum wl_status_t
+{
+  WL_NO_SHIELD = 255,
+  WL_NO_MODULE = WL_NO_SHIELD,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED,
+  WL_AP_LISTENING,
+  WL_AP_CONNECTED,
+  WL_AP_FAILED
+};
+
+#define WIFI_FIRMWARE_LATEST_VERSION "1.5.0"
+#define NO_SOCKET_AVAIL 255
+
+class WiFiClient : public Stream
+{
+public:
+  WiFiClient() : sock(NO_SOCKET_AVAIL) {}
+  WiFiClient(uint8_t sock) : sock(sock) {}
+
+  uint8_t status();
+  int connect(IPAddress ip, uint16_t port);
+  int connect(const char *host, uint16_t port);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t size);
+  using Print::write;
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  operator bool() { return sock != NO_SOCKET_AVAIL; }
+  bool operator==(const WiFiClient &other) const { return sock == other.sock; }
+  bool operator!=(const WiFiClient &other) const { return sock != other.sock; }
+  IPAddress remoteIP();
+  uint16_t remotePort();
+
+private:
+  uint8_t sock;
+};
+
+class WiFiServer : public Print
+{
+public:
+  WiFiServer(uint16_t port) : port(port), listening(false) {}
+  WiFiClient available(uint8_t *status = NULL);
+  void begin();
+  uint8_t status();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t size);
+  using Print::write;
+
+private:
+  uint16_t port;
+  bool listening;
+};
+
+class WiFiClass
+{
+public:
+  static const char *firmwareVersion();
+  int begin(const char *ssid);
+  int begin(const char *ssid, const char *passphrase);
+  uint8_t beginAP(const char *ssid);
+  uint8_t beginAP(const char *ssid, uint8_t channel);
+  void config(IPAddress localIp);
+  void config(IPAddress localIp, IPAddress dnsServer);
+  void config(IPAddress localIp, IPAddress dnsServer, IPAddress gateway);
+  void config(IPAddress localIp, IPAddress dnsServer, IPAddress gateway, IPAddress subnet);
+  void setDNS(IPAddress dnsServer);
+  void setTimeout(unsigned long timeout);
+  void disconnect();
+  void end();
+  uint8_t *macAddress(uint8_t *mac);
+  IPAddress localIP();
+  IPAddress subnetMask();
+  IPAddress gatewayIP();
+  const char *SSID();
+  uint8_t *BSSID(uint8_t *bssid);
+  int32_t RSSI();
+  uint8_t encryptionType();
+  uint8_t status();
+  unsigned long getTime();
+  void lowPowerMode() {}
+  void noLowPowerMode() {}
+  int ping(const char *hostname, uint8_t ttl = 128);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef WIFISENSORS_HOST_WIRE_H
+#define WIFISENSORS_HOST_WIRE_H
+
+class TwoWire
+{
+public:
+  void begin() {}
+};
+
+extern TwoWire Wire;
+
+#endif
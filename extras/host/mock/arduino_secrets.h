@@ -0,0 +1,4 @@
+// host board joins this network at boot, requests need no authorization
+#define SECRET_SSID "host"
+#define SECRET_PASS "host"
+#define SECRET_SERVER_AUTH ""
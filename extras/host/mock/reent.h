@@ -0,0 +1,9 @@
+#ifndef WIFISENSORS_HOST_REENT_H
+#define WIFISENSORS_HOST_REENT_H
+
+// newlib reentrancy structure, host heap hooks ignore it
+
+struct _reent;
+#define _REENT ((struct _reent *)0)
+
+#endif
@@ -0,0 +1,605 @@
+#ifndef WIFISENSORS_BACKUP_H
+#define WIFISENSORS_BACKUP_H
+
+/*
+Binary backup of server config, pinout and devices.
+File starts with header: magic "WSB1", version (major in high byte), sections count.
+Section: tag, reserved byte, body length, CRC32 of body, then body made of fields: tag, length, value.
+Integers are little endian. Unknown sections and fields are skipped and missing fields are left zeroed,
+so backups of other versions with the same major can be read. Secrets use the same obfuscation as JSON backup.
+Restore reads the stream in one pass, each section is buffered and its CRC checked before fields are applied.
+*/
+
+#include "WifiSensorsDrivers.h"
+#include "WifiSensorsLink.h"
+#include "WifiSensorsPersist.h"
+#include "WifiSensorsTypes.h"
+
+#define WS_BACKUP_MAGIC "WSB1"
+#define WS_BACKUP_VERSION 0x0100
+#define WS_BACKUP_HEADER 8
+#define WS_BACKUP_SECTION_HEADER 8
+// largest section body, server config with all fields is about 420 bytes
+#define WS_BACKUP_SECTION_SIZE 512
+
+enum BackupSectionTag
+{
+  BACKUP_SECTION_SERVER = 1,
+  BACKUP_SECTION_PINOUT = 2,
+  BACKUP_SECTION_DEVICE = 3,
+};
+
+enum BackupServerField
+{
+  BACKUP_SERVER_SSID = 1,
+  BACKUP_SERVER_PASS,
+  BACKUP_SERVER_AUTH,
+  BACKUP_SERVER_CALLBACK_SET,
+  BACKUP_SERVER_CALLBACK_HOST,
+  BACKUP_SERVER_CALLBACK_PORT,
+  BACKUP_SERVER_CALLBACK_PATH,
+  BACKUP_SERVER_CALLBACK_AUTH,
+  BACKUP_SERVER_STATIC_IP,
+  BACKUP_SERVER_STATIC_GATEWAY,
+  BACKUP_SERVER_STATIC_SUBNET,
+  BACKUP_SERVER_STATIC_DNS,
+};
+
+enum BackupPinoutField
+{
+  BACKUP_PINOUT_ANALOG = 1,
+  BACKUP_PINOUT_DIGITAL,
+};
+
+enum BackupDeviceField
+{
+  BACKUP_DEVICE_ID = 1,
+  BACKUP_DEVICE_ACTIVE,
+  BACKUP_DEVICE_TYPE,
+  BACKUP_DEVICE_POLL,
+  // repeated for every pin, in pin order: type, pin, mode
+  BACKUP_DEVICE_PIN,
+  BACKUP_DEVICE_CALLBACK_SET,
+  BACKUP_DEVICE_CALLBACK_HOST,
+  BACKUP_DEVICE_CALLBACK_PORT,
+  BACKUP_DEVICE_CALLBACK_PATH,
+  BACKUP_DEVICE_CALLBACK_AUTH,
+  BACKUP_DEVICE_CONFIG_BYTES,
+  BACKUP_DEVICE_CONFIG_INTS,
+  BACKUP_DEVICE_CONFIG_LONGS,
+  BACKUP_DEVICE_CONFIG_FLOATS,
+  BACKUP_DEVICE_CONFIG_ROM,
+};
+
+typedef struct
+{
+  byte data[WS_BACKUP_SECTION_SIZE];
+  uint16_t len;
+  bool overflow;
+} BackupSection;
+
+inline void backupPutU16(byte *out, uint16_t v)
+{
+  out[0] = v & 0xFF;
+  out[1] = v >> 8;
+}
+
+inline void backupPutU32(byte *out, uint32_t v)
+{
+  for (byte i = 0; i < 4; i++)
+  {
+    out[i] = (v >> (8 * i)) & 0xFF;
+  }
+}
+
+inline uint16_t backupGetU16(const byte *in)
+{
+  return in[0] | (in[1] << 8);
+}
+
+inline uint32_t backupGetU32(const byte *in)
+{
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// writing
+
+inline byte *backupField(BackupSection &section, byte tag, size_t len)
+{
+  if (len > 0xFF || section.len + 2 + len > sizeof(section.data))
+  {
+    section.overflow = true;
+    return NULL;
+  }
+  byte *field = section.data + section.len;
+  field[0] = tag;
+  field[1] = len;
+  section.len += 2 + len;
+  return field + 2;
+}
+
+inline void backupFieldBytes(BackupSection &section, byte tag, const void *data, size_t len)
+{
+  byte *value = backupField(section, tag, len);
+  if (value != NULL)
+  {
+    memcpy(value, data, len);
+  }
+}
+
+inline void backupFieldU8(BackupSection &section, byte tag, byte v)
+{
+  backupFieldBytes(section, tag, &v, 1);
+}
+
+inline void backupFieldU32(BackupSection &section, byte tag, uint32_t v)
+{
+  byte *value = backupField(section, tag, 4);
+  if (value != NULL)
+  {
+    backupPutU32(value, v);
+  }
+}
+
+inline void backupFieldStr(BackupSection &section, byte tag, const char *str, size_t size)
+{
+  backupFieldBytes(section, tag, str, strnlen(str, size));
+}
+
+inline void backupFieldSecret(BackupSection &section, byte tag, const char *str, size_t size)
+{
+  size_t len = strnlen(str, size);
+  byte *value = backupField(section, tag, len);
+  for (size_t i = 0; value != NULL && i < len; i++)
+  {
+    value[i] = str[i] + 3;
+  }
+}
+
+template <typename T>
+void backupFieldArray(BackupSection &section, byte tag, const T *values, byte count)
+{
+  byte *value = backupField(section, tag, count * 4);
+  for (byte i = 0; value != NULL && i < count; i++)
+  {
+    uint32_t raw;
+    memcpy(&raw, &values[i], 4);
+    backupPutU32(value + i * 4, raw);
+  }
+}
+
+inline void backupFieldCallback(BackupSection &section, byte tag, Callback &callback)
+{
+  // set, host, port, path and auth tags follow each other
+  backupFieldU8(section, tag, callback.set);
+  if (callback.set)
+  {
+    backupFieldStr(section, tag + 1, callback.host, sizeof(callback.host));
+    backupFieldU32(section, tag + 2, callback.port);
+    backupFieldStr(section, tag + 3, callback.path, sizeof(callback.path));
+    backupFieldSecret(section, tag + 4, callback.auth, sizeof(callback.auth));
+  }
+}
+
+inline bool backupWriteSection(Print &out, byte tag, BackupSection &section)
+{
+  if (section.overflow)
+  {
+    return false;
+  }
+  byte header[WS_BACKUP_SECTION_HEADER];
+  header[0] = tag;
+  header[1] = 0;
+  backupPutU16(header + 2, section.len);
+  backupPutU32(header + 4, persistCrc(section.data, section.len));
+  out.write(header, sizeof(header));
+  out.write(section.data, section.len);
+  return true;
+}
+
+inline void backupServer(BackupSection &section, ServerConfig &config)
+{
+  backupFieldStr(section, BACKUP_SERVER_SSID, config.ssid, sizeof(config.ssid));
+  backupFieldSecret(section, BACKUP_SERVER_PASS, config.pass, sizeof(config.pass));
+  backupFieldSecret(section, BACKUP_SERVER_AUTH, config.serverauth, sizeof(config.serverauth));
+  backupFieldCallback(section, BACKUP_SERVER_CALLBACK_SET, config.callback);
+  if (linkStaticIp(config))
+  {
+    backupFieldU32(section, BACKUP_SERVER_STATIC_IP, config.staticIp);
+    backupFieldU32(section, BACKUP_SERVER_STATIC_GATEWAY, config.staticGateway);
+    backupFieldU32(section, BACKUP_SERVER_STATIC_SUBNET, config.staticSubnet);
+    backupFieldU32(section, BACKUP_SERVER_STATIC_DNS, config.staticDns);
+  }
+}
+
+inline void backupPinout(BackupSection &section, Pinout &pinout)
+{
+  byte *value = backupField(section, BACKUP_PINOUT_ANALOG, WS_ANALOG_PINS);
+  for (byte i = 0; value != NULL && i < WS_ANALOG_PINS; i++)
+  {
+    value[i] = pinout.analog[i];
+  }
+  value = backupField(section, BACKUP_PINOUT_DIGITAL, WS_DIGITAL_PINS);
+  for (byte i = 0; value != NULL && i < WS_DIGITAL_PINS; i++)
+  {
+    value[i] = pinout.digital[i];
+  }
+}
+
+inline void backupDevice(BackupSection &section, Device &dev)
+{
+  backupFieldU8(section, BACKUP_DEVICE_ID, dev.deviceId);
+  backupFieldU8(section, BACKUP_DEVICE_ACTIVE, dev.active);
+  const char *type = deviceTypetoStr(dev.type);
+  backupFieldStr(section, BACKUP_DEVICE_TYPE, type, strlen(type));
+  backupFieldU32(section, BACKUP_DEVICE_POLL, dev.pollInterval);
+  for (byte i = 0; i < WS_MAX_DEVICE_PINS; i++)
+  {
+    byte *value = backupField(section, BACKUP_DEVICE_PIN, 3);
+    if (value != NULL)
+    {
+      value[0] = dev.pins[i].type;
+      value[1] = dev.pins[i].pin;
+      value[2] = dev.pins[i].mode;
+    }
+  }
+  backupFieldCallback(section, BACKUP_DEVICE_CALLBACK_SET, dev.pushCallback);
+  backupFieldBytes(section, BACKUP_DEVICE_CONFIG_BYTES, dev.config.bytes, sizeof(dev.config.bytes));
+  backupFieldArray(section, BACKUP_DEVICE_CONFIG_INTS, dev.config.ints, WS_DEVICE_CONFIG_INTS);
+  backupFieldArray(section, BACKUP_DEVICE_CONFIG_LONGS, dev.config.ulongs, WS_DEVICE_CONFIG_LONGS);
+  backupFieldArray(section, BACKUP_DEVICE_CONFIG_FLOATS, dev.config.floats, WS_DEVICE_CONFIG_FLOATS);
+  backupFieldBytes(section, BACKUP_DEVICE_CONFIG_ROM, dev.config.rom, sizeof(dev.config.rom));
+}
+
+// returns false when some section did not fit WS_BACKUP_SECTION_SIZE, output is incomplete then
+inline bool backupWrite(Print &out, ServerConfig &config, Pinout &pinout, Devices &devices)
+{
+  byte header[WS_BACKUP_HEADER];
+  memcpy(header, WS_BACKUP_MAGIC, 4);
+  backupPutU16(header + 4, WS_BACKUP_VERSION);
+  backupPutU16(header + 6, 2 + devices.count);
+  out.write(header, sizeof(header));
+
+  BackupSection section;
+  section.len = 0;
+  section.overflow = false;
+  backupServer(section, config);
+  if (!backupWriteSection(out, BACKUP_SECTION_SERVER, section))
+  {
+    return false;
+  }
+
+  section.len = 0;
+  backupPinout(section, pinout);
+  if (!backupWriteSection(out, BACKUP_SECTION_PINOUT, section))
+  {
+    return false;
+  }
+
+  for (byte i = 0; i < devices.count; i++)
+  {
+    section.len = 0;
+    backupDevice(section, devices.devices[i]);
+    if (!backupWriteSection(out, BACKUP_SECTION_DEVICE, section))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// reading
+
+inline bool backupReadBytes(Stream &in, byte *data, size_t len)
+{
+  return in.readBytes((char *)data, len) == len;
+}
+
+inline void backupGetStr(char *out, size_t size, const byte *value, byte len)
+{
+  memset(out, 0, size);
+  memcpy(out, value, len < size ? len : size - 1);
+}
+
+inline void backupGetSecret(char *out, size_t size, const byte *value, byte len)
+{
+  backupGetStr(out, size, value, len);
+  for (size_t i = 0; out[i] != '\0'; i++)
+  {
+    out[i] -= 3;
+  }
+}
+
+template <typename T>
+void backupGetArray(T *values, byte count, const byte *value, byte len)
+{
+  // older backup may have less elements, newer one more
+  for (byte i = 0; i < count && (i + 1) * 4 <= len; i++)
+  {
+    uint32_t raw = backupGetU32(value + i * 4);
+    memcpy(&values[i], &raw, 4);
+  }
+}
+
+inline uint32_t backupGetUint(const byte *value, byte len)
+{
+  return len >= 4 ? backupGetU32(value) : len >= 2 ? backupGetU16(value) : len == 1 ? value[0] : 0;
+}
+
+inline bool backupGetCallback(Callback &callback, byte field, const byte *value, byte len)
+{
+  switch (field)
+  {
+  case 0:
+    callback.set = value[0] != 0;
+    return true;
+  case 1:
+    backupGetStr(callback.host, sizeof(callback.host), value, len);
+    return true;
+  case 2:
+    callback.port = backupGetUint(value, len);
+    return true;
+  case 3:
+    backupGetStr(callback.path, sizeof(callback.path), value, len);
+    return true;
+  case 4:
+    backupGetSecret(callback.auth, sizeof(callback.auth), value, len);
+    return true;
+  }
+  return false;
+}
+
+inline void backupReadServer(ServerConfig &config, byte tag, const byte *value, byte len)
+{
+  switch (tag)
+  {
+  case BACKUP_SERVER_SSID:
+    backupGetStr(config.ssid, sizeof(config.ssid), value, len);
+    break;
+  case BACKUP_SERVER_PASS:
+    backupGetSecret(config.pass, sizeof(config.pass), value, len);
+    break;
+  case BACKUP_SERVER_AUTH:
+    backupGetSecret(config.serverauth, sizeof(config.serverauth), value, len);
+    break;
+  case BACKUP_SERVER_STATIC_IP:
+    config.staticIp = backupGetUint(value, len);
+    break;
+  case BACKUP_SERVER_STATIC_GATEWAY:
+    config.staticGateway = backupGetUint(value, len);
+    break;
+  case BACKUP_SERVER_STATIC_SUBNET:
+    config.staticSubnet = backupGetUint(value, len);
+    break;
+  case BACKUP_SERVER_STATIC_DNS:
+    config.staticDns = backupGetUint(value, len);
+    break;
+  default:
+    if (tag >= BACKUP_SERVER_CALLBACK_SET)
+    {
+      backupGetCallback(config.callback, tag - BACKUP_SERVER_CALLBACK_SET, value, len);
+    }
+  }
+}
+
+inline void backupReadPinout(Pinout &pinout, byte tag, const byte *value, byte len)
+{
+  if (tag == BACKUP_PINOUT_ANALOG)
+  {
+    for (byte i = 0; i < WS_ANALOG_PINS && i < len; i++)
+    {
+      pinout.analog[i] = value[i];
+    }
+  }
+  else if (tag == BACKUP_PINOUT_DIGITAL)
+  {
+    for (byte i = 0; i < WS_DIGITAL_PINS && i < len; i++)
+    {
+      pinout.digital[i] = value[i];
+    }
+  }
+}
+
+inline DeviceType backupDeviceType(const byte *value, byte len)
+{
+  for (byte i = 0; i < DEVICE_UNKNOWN; i++)
+  {
+    const char *name = deviceTypetoStr(static_cast<DeviceType>(i));
+    if (strlen(name) == len && memcmp(name, value, len) == 0)
+    {
+      return static_cast<DeviceType>(i);
+    }
+  }
+  return DEVICE_UNKNOWN;
+}
+
+inline void backupReadDevice(Device &dev, byte &pins, byte tag, const byte *value, byte len)
+{
+  switch (tag)
+  {
+  case BACKUP_DEVICE_ID:
+    dev.deviceId = value[0];
+    break;
+  case BACKUP_DEVICE_ACTIVE:
+    dev.active = value[0] != 0;
+    break;
+  case BACKUP_DEVICE_TYPE:
+    dev.type = backupDeviceType(value, len);
+    break;
+  case BACKUP_DEVICE_POLL:
+    dev.pollInterval = (int32_t)backupGetUint(value, len);
+    break;
+  case BACKUP_DEVICE_PIN:
+    if (pins < WS_MAX_DEVICE_PINS && len >= 3)
+    {
+      dev.pins[pins].type = value[0];
+      dev.pins[pins].pin = value[1];
+      dev.pins[pins].mode = value[2];
+      pins++;
+    }
+    break;
+  case BACKUP_DEVICE_CONFIG_BYTES:
+    memcpy(dev.config.bytes, value, len < sizeof(dev.config.bytes) ? len : sizeof(dev.config.bytes));
+    break;
+  case BACKUP_DEVICE_CONFIG_INTS:
+    backupGetArray(dev.config.ints, WS_DEVICE_CONFIG_INTS, value, len);
+    break;
+  case BACKUP_DEVICE_CONFIG_LONGS:
+    backupGetArray(dev.config.ulongs, WS_DEVICE_CONFIG_LONGS, value, len);
+    break;
+  case BACKUP_DEVICE_CONFIG_FLOATS:
+    backupGetArray(dev.config.floats, WS_DEVICE_CONFIG_FLOATS, value, len);
+    break;
+  case BACKUP_DEVICE_CONFIG_ROM:
+    memcpy(dev.config.rom, value, len < sizeof(dev.config.rom) ? len : sizeof(dev.config.rom));
+    break;
+  default:
+    if (tag >= BACKUP_DEVICE_CALLBACK_SET)
+    {
+      backupGetCallback(dev.pushCallback, tag - BACKUP_DEVICE_CALLBACK_SET, value, len);
+    }
+  }
+}
+
+// next field of buffered section, returns false at the end, invalid is set when field overruns the section
+inline bool backupNextField(BackupSection &section, uint16_t &pos, byte &tag, const byte *&value, byte &len, bool &invalid)
+{
+  while (pos < section.len)
+  {
+    if (pos + 2 > section.len || pos + 2 + section.data[pos + 1] > section.len)
+    {
+      invalid = true;
+      return false;
+    }
+    tag = section.data[pos];
+    len = section.data[pos + 1];
+    value = section.data + pos + 2;
+    pos += 2 + len;
+    // zero length values are never written, field readers may read first byte
+    if (len > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// restores config, pinout and devices from stream, error is set when it returns false
+// values are applied section by section, caller has to reload previous state when restore fails
+inline bool backupRead(Stream &in, ServerConfig &config, Pinout &pinout, Devices &devices, const char *&error)
+{
+  byte header[WS_BACKUP_HEADER];
+  if (!backupReadBytes(in, header, sizeof(header)) || memcmp(header, WS_BACKUP_MAGIC, 4) != 0)
+  {
+    error = "not a backup";
+    return false;
+  }
+  if ((backupGetU16(header + 4) >> 8) != (WS_BACKUP_VERSION >> 8))
+  {
+    error = "unsupported backup version";
+    return false;
+  }
+  uint16_t sections = backupGetU16(header + 6);
+
+  BackupSection section;
+  bool serverRead = false;
+  devices.count = 0;
+  for (uint16_t i = 0; i < sections; i++)
+  {
+    byte sectionHeader[WS_BACKUP_SECTION_HEADER];
+    if (!backupReadBytes(in, sectionHeader, sizeof(sectionHeader)))
+    {
+      error = "backup truncated";
+      return false;
+    }
+    section.len = backupGetU16(sectionHeader + 2);
+    if (section.len > sizeof(section.data))
+    {
+      error = "backup section too large";
+      return false;
+    }
+    if (!backupReadBytes(in, section.data, section.len))
+    {
+      error = "backup truncated";
+      return false;
+    }
+    if (persistCrc(section.data, section.len) != backupGetU32(sectionHeader + 4))
+    {
+      error = "backup CRC mismatch";
+      return false;
+    }
+
+    uint16_t pos = 0;
+    byte tag, len;
+    const byte *value;
+    bool invalid = false;
+    switch (sectionHeader[0])
+    {
+    case BACKUP_SECTION_SERVER:
+    {
+      ServerConfig read;
+      memset(&read, 0, sizeof(read));
+      while (backupNextField(section, pos, tag, value, len, invalid))
+      {
+        backupReadServer(read, tag, value, len);
+      }
+      if (!invalid && read.ssid[0] != '\0')
+      {
+        read.set = true;
+        config = read;
+        serverRead = true;
+      }
+      break;
+    }
+    case BACKUP_SECTION_PINOUT:
+      while (backupNextField(section, pos, tag, value, len, invalid))
+      {
+        backupReadPinout(pinout, tag, value, len);
+      }
+      pinout.set = true;
+      break;
+    case BACKUP_SECTION_DEVICE:
+    {
+      if (devices.count >= WS_MAX_DEVICES)
+      {
+        error = "too many devices in backup";
+        return false;
+      }
+      Device &dev = devices.devices[devices.count];
+      memset(&dev, 0, sizeof(dev));
+      dev.type = DEVICE_UNKNOWN;
+      byte pins = 0;
+      while (backupNextField(section, pos, tag, value, len, invalid))
+      {
+        backupReadDevice(dev, pins, tag, value, len);
+      }
+      // devices are kept dense, id is the position
+      if (!invalid && (dev.deviceId != devices.count || dev.type == DEVICE_UNKNOWN))
+      {
+        error = "invalid device in backup";
+        return false;
+      }
+      devices.count++;
+      break;
+    }
+    default:
+      // section of newer version
+      break;
+    }
+    if (invalid)
+    {
+      error = "backup field invalid";
+      return false;
+    }
+  }
+
+  if (!serverRead)
+  {
+    error = "backup without server config";
+    return false;
+  }
+  devices.set = true;
+  return true;
+}
+
+#endif
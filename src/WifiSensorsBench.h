@@ -0,0 +1,188 @@
+#ifndef WIFISENSORS_BENCH_H
+#define WIFISENSORS_BENCH_H
+
+/*
+Parser and JSON serializer microbenchmark cases, run on host by extras/host ws_bench (not built into the sketch).
+Payloads are built once before measuring: json backup of WS_BENCH_DEVICES devices, long callback url and url-encoded config form.
+Output goes to a counting sink, so serializers are measured without network. Results are compared with a baseline,
+ns/op may grow by WS_BENCH_TOLERANCE %, allocations and allocated bytes per op must not grow.
+*/
+
+#include "WifiSensorsForm.h"
+#include "WifiSensorsTypes.h"
+#include "WifiSensorsUtils.h"
+#include "parsers.h"
+
+#ifndef WS_BENCH_DEVICES
+#define WS_BENCH_DEVICES 10
+#endif
+// percent of baseline ns/op tolerated before case is flagged as regression
+#ifndef WS_BENCH_TOLERANCE
+#define WS_BENCH_TOLERANCE 10
+#endif
+
+enum BenchCase
+{
+  BENCH_ENCODE,
+  BENCH_DECODE,
+  BENCH_CRYPT,
+  BENCH_DECRYPT,
+  BENCH_FIND_IN_JSON,
+  BENCH_FORM_PARSE,
+  BENCH_CONFIG_TO_STRING,
+  BENCH_SERVER_CONFIG_TO_STRING,
+  BENCH_STATUS_STR,
+  BENCH_CASES
+};
+
+// per op values, allocations are counted only with WS_HEAP_STATS
+typedef struct
+{
+  uint32_t ns;
+  uint32_t allocs;
+  uint32_t bytes;
+} BenchResult;
+
+typedef struct
+{
+  bool set;
+  BenchResult results[BENCH_CASES];
+} BenchBaseline;
+
+const char *const benchCaseNames[BENCH_CASES] = {"encode", "decode", "crypt", "decrypt", "find_in_json", "form_parse", "config_to_string", "server_config_to_string", "status_str"};
+
+const char benchCallbackUrl[] = "192.168.100.200:8080/api/v1/sensors/living-room/<temp>?humid=<humid>&token=0123456789abcdef0123456789abcdef&node=wifi-sensors-01";
+const char benchForm[] = "type=DHT22&active=true&interval=5000&callback=http%3A%2F%2F192.168.100.200%3A8080%2Fapi%2Fv1%2Fsensors%2Fliving-room%2F%3Ctemp%3E%3Fhumid%3D%3Chumid%3E"
+                         "&auth_header=Basic+dXNlcjpwYXNzd29yZDEyMzQ1Njc4&temp_adj=-0.50&humid_adj=1.20&pin0=D2&pin0type=INPUT";
+const char benchSecret[] = "Basic dXNlcjpwYXNzd29yZDEyMzQ1Njc4";
+
+class BenchSink : public Print
+{
+public:
+  size_t count = 0;
+
+  using Print::write;
+
+  size_t write(uint8_t)
+  {
+    count++;
+    return 1;
+  }
+
+  size_t write(const uint8_t *, size_t size)
+  {
+    count += size;
+    return size;
+  }
+};
+
+typedef struct
+{
+  String backup;
+  String form;
+  String secret;
+  String crypted;
+  char formBuf[sizeof(benchForm)];
+  char encoded[3 * sizeof(benchCallbackUrl)];
+} BenchPayloads;
+
+// same layout as GET /backup?format=json
+inline void benchBackupJson(String &json)
+{
+  json.reserve(WS_BENCH_DEVICES * 400 + 200);
+  json = "{\"server\":{\"ssid\":\"WifiSensorsNetwork\",\"pass\":\"";
+  json += crypt("password12345678");
+  json += "\",\"serverauth\":\"";
+  json += crypt(benchSecret);
+  json += "\",\"callback\":\"192.168.100.200:8080/api/v1/warnings\",\"callbackauth\":\"";
+  json += crypt(benchSecret);
+  json += "\"},\"devices\":[";
+  for (byte i = 0; i < WS_BENCH_DEVICES; i++)
+  {
+    json += i > 0 ? ",{\"id\":\"" : "{\"id\":\"";
+    json += i;
+    json += "\",\"active\":true,\"type\":\"DHT22\",\"poll\":5000,\"callback\":\"";
+    json += benchCallbackUrl;
+    json += "\",\"callbackauth\":\"";
+    json += crypt(benchSecret);
+    json += "\",\"config\":{\"temp_adj\":-0.50,\"humid_adj\":1.20},\"pins\":{\"pin0\":{\"pin\":\"D";
+    json += i + 2;
+    json += "\",\"mode\":\"INPUT\"}},\"values\":{\"temp\":23.50,\"humid\":45.20}}";
+  }
+  json += "]}";
+}
+
+inline void benchPrepare(BenchPayloads &payloads)
+{
+  benchBackupJson(payloads.backup);
+  payloads.form = benchForm;
+  payloads.secret = benchSecret;
+  payloads.crypted = crypt(payloads.secret);
+}
+
+inline void benchOp(BenchCase benchCase, BenchPayloads &payloads, BenchSink &sink, ServerConfig &serverConfig, Devices &devices, ServerStats &stats, unsigned int op)
+{
+  switch (benchCase)
+  {
+  case BENCH_ENCODE:
+    sink.count += encode(benchCallbackUrl, payloads.encoded, sizeof(payloads.encoded));
+    break;
+  case BENCH_DECODE:
+    sink.count += decode(payloads.form).length();
+    break;
+  case BENCH_CRYPT:
+    sink.count += crypt(payloads.secret).length();
+    break;
+  case BENCH_DECRYPT:
+    sink.count += decrypt(payloads.crypted).length();
+    break;
+  case BENCH_FIND_IN_JSON:
+  {
+    // lookups done by json restore, each one copies rest of the backup
+    String value;
+    int poll;
+    bool active;
+    findStrInJson(payloads.backup, "callbackauth", value);
+    findIntInJson(payloads.backup, "poll", poll);
+    findBoolInJson(payloads.backup, "active", active);
+    findJsonStrInJson(payloads.backup, "pins", 2, value);
+    sink.count += value.length();
+    break;
+  }
+  case BENCH_FORM_PARSE:
+  {
+    Form form;
+    memcpy(payloads.formBuf, benchForm, sizeof(benchForm));
+    formParse(form, payloads.formBuf);
+    sink.count += form.count;
+    break;
+  }
+  case BENCH_CONFIG_TO_STRING:
+    WifiSensorsUtils::configToString(devices.devices[op % devices.count], sink);
+    break;
+  case BENCH_SERVER_CONFIG_TO_STRING:
+  {
+    String str;
+    WifiSensorsUtils::serverConfigToString(serverConfig, str);
+    sink.count += str.length();
+    break;
+  }
+  case BENCH_STATUS_STR:
+  {
+    String str;
+    WifiSensorsUtils::getStatusStr(str, &stats);
+    sink.count += str.length();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+inline bool benchRegression(const BenchResult &result, const BenchResult &baseline)
+{
+  return (unsigned long long)result.ns * 100ULL > (unsigned long long)baseline.ns * (100ULL + WS_BENCH_TOLERANCE) ||
+         result.allocs > baseline.allocs || result.bytes > baseline.bytes;
+}
+
+#endif
@@ -0,0 +1,444 @@
+#ifndef WIFISENSORS_BINARY_H
+#define WIFISENSORS_BINARY_H
+
+/*
+CBOR (RFC 8949) and MessagePack encoding of GET / values and GET /devices, chosen by Accept header, JSON stays the default.
+Documents have the same layout as JSON, but device ids and numbers are native: state values are booleans,
+binary values and numbers without decimals are integers, other numbers are float64 made from fixed point value, so decoded
+number prints as the same decimal as JSON string. Maps and arrays have definite length, so counts are computed before items are written.
+Strings built by drivers (callback, config) are printed twice: into a counter for their length, then straight to output,
+so they are never cut. Device config stays JSON text, in CBOR tagged as embedded JSON (262).
+Output goes through WS_BINARY_CHUNK bytes buffer on stack.
+*/
+
+#include "WifiSensorsTypes.h"
+#include "WifiSensorsUtils.h"
+
+#ifndef WS_BINARY_CHUNK
+#define WS_BINARY_CHUNK 256
+#endif
+
+enum BinaryFormat
+{
+  BINARY_NONE,
+  BINARY_CBOR,
+  BINARY_MSGPACK,
+};
+
+const char *const binaryContentTypes[] = {"application/json", "application/cbor", "application/msgpack"};
+
+// CBOR major types
+#define CBOR_UINT 0x00
+#define CBOR_NINT 0x20
+#define CBOR_TEXT 0x60
+#define CBOR_ARRAY 0x80
+#define CBOR_MAP 0xA0
+#define CBOR_TAG 0xC0
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_FLOAT64 0xFB
+#define CBOR_TAG_JSON 262
+
+class BinaryWriter : public Print
+{
+public:
+  BinaryWriter(Print &out, BinaryFormat format) : format(format), out(out), len(0) {}
+
+  ~BinaryWriter()
+  {
+    flush();
+  }
+
+  using Print::write;
+
+  size_t write(uint8_t c)
+  {
+    if (len == WS_BINARY_CHUNK)
+    {
+      flush();
+    }
+    buf[len++] = c;
+    return 1;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      write(buffer[i]);
+    }
+    return size;
+  }
+
+  void flush()
+  {
+    if (len > 0)
+    {
+      out.write(buf, len);
+      len = 0;
+    }
+  }
+
+  const BinaryFormat format;
+
+private:
+  Print &out;
+  size_t len;
+  uint8_t buf[WS_BINARY_CHUNK];
+};
+
+// length of printed text, counted before it is streamed
+class BinaryCounter : public Print
+{
+public:
+  size_t count = 0;
+
+  using Print::write;
+
+  size_t write(uint8_t)
+  {
+    count++;
+    return 1;
+  }
+
+  size_t write(const uint8_t *, size_t size)
+  {
+    count += size;
+    return size;
+  }
+};
+
+// first binary type listed in Accept, BINARY_NONE for JSON
+inline BinaryFormat binaryFormat(const char *accept)
+{
+  const char *cbor = strstr(accept, "application/cbor");
+  const char *msgpack = strstr(accept, "application/msgpack");
+  if (msgpack == NULL)
+  {
+    msgpack = strstr(accept, "application/x-msgpack");
+  }
+  if (cbor != NULL && (msgpack == NULL || cbor < msgpack))
+  {
+    return BINARY_CBOR;
+  }
+  return msgpack != NULL ? BINARY_MSGPACK : BINARY_NONE;
+}
+
+inline void binaryBigEndian(BinaryWriter &out, uint64_t value, byte size)
+{
+  for (byte i = size; i > 0; i--)
+  {
+    out.write((uint8_t)(value >> (8 * (i - 1))));
+  }
+}
+
+// CBOR head, argument in shortest form
+inline void binaryCborHead(BinaryWriter &out, byte major, uint32_t value)
+{
+  if (value < 24)
+  {
+    out.write((uint8_t)(major | value));
+  }
+  else if (value <= 0xFF)
+  {
+    out.write((uint8_t)(major | 24));
+    out.write((uint8_t)value);
+  }
+  else if (value <= 0xFFFF)
+  {
+    out.write((uint8_t)(major | 25));
+    binaryBigEndian(out, value, 2);
+  }
+  else
+  {
+    out.write((uint8_t)(major | 26));
+    binaryBigEndian(out, value, 4);
+  }
+}
+
+// MessagePack head for strings, arrays and maps, fix is fixstr/fixarray/fixmap prefix, first16 is 16 bit variant, 32 bit one follows it
+inline void binaryMsgpackHead(BinaryWriter &out, byte fix, uint32_t fixMax, byte first16, uint32_t value)
+{
+  if (value <= fixMax)
+  {
+    out.write((uint8_t)(fix | value));
+  }
+  else if (value <= 0xFFFF)
+  {
+    out.write(first16);
+    binaryBigEndian(out, value, 2);
+  }
+  else
+  {
+    out.write((uint8_t)(first16 + 1));
+    binaryBigEndian(out, value, 4);
+  }
+}
+
+inline void binaryMap(BinaryWriter &out, uint32_t count)
+{
+  if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_MAP, count);
+  }
+  else
+  {
+    binaryMsgpackHead(out, 0x80, 15, 0xDE, count);
+  }
+}
+
+inline void binaryArray(BinaryWriter &out, uint32_t count)
+{
+  if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_ARRAY, count);
+  }
+  else
+  {
+    binaryMsgpackHead(out, 0x90, 15, 0xDC, count);
+  }
+}
+
+inline void binaryStrHead(BinaryWriter &out, size_t len)
+{
+  if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_TEXT, len);
+  }
+  else if (len > 31 && len <= 0xFF)
+  {
+    out.write(0xD9);
+    out.write((uint8_t)len);
+  }
+  else
+  {
+    binaryMsgpackHead(out, 0xA0, 31, 0xDA, len);
+  }
+}
+
+inline void binaryStr(BinaryWriter &out, const char *str, size_t len)
+{
+  binaryStrHead(out, len);
+  out.write((const uint8_t *)str, len);
+}
+
+inline void binaryStr(BinaryWriter &out, const char *str)
+{
+  binaryStr(out, str, strlen(str));
+}
+
+inline void binaryUint(BinaryWriter &out, uint32_t value)
+{
+  if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_UINT, value);
+  }
+  else if (value < 0x80)
+  {
+    out.write((uint8_t)value);
+  }
+  else if (value <= 0xFF)
+  {
+    out.write(0xCC);
+    out.write((uint8_t)value);
+  }
+  else if (value <= 0xFFFF)
+  {
+    out.write(0xCD);
+    binaryBigEndian(out, value, 2);
+  }
+  else
+  {
+    out.write(0xCE);
+    binaryBigEndian(out, value, 4);
+  }
+}
+
+inline void binaryInt(BinaryWriter &out, int32_t value)
+{
+  if (value >= 0)
+  {
+    binaryUint(out, value);
+  }
+  else if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_NINT, (uint32_t)(-1 - value));
+  }
+  else if (value >= -32)
+  {
+    out.write((uint8_t)value);
+  }
+  else if (value >= -128)
+  {
+    out.write(0xD0);
+    out.write((uint8_t)value);
+  }
+  else if (value >= -32768)
+  {
+    out.write(0xD1);
+    binaryBigEndian(out, (uint16_t)value, 2);
+  }
+  else
+  {
+    out.write(0xD2);
+    binaryBigEndian(out, (uint32_t)value, 4);
+  }
+}
+
+inline void binaryDouble(BinaryWriter &out, double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  out.write(out.format == BINARY_CBOR ? CBOR_FLOAT64 : 0xCB);
+  binaryBigEndian(out, bits, 8);
+}
+
+inline void binaryBool(BinaryWriter &out, bool value)
+{
+  if (out.format == BINARY_CBOR)
+  {
+    out.write(value ? CBOR_TRUE : CBOR_FALSE);
+  }
+  else
+  {
+    out.write(value ? 0xC3 : 0xC2);
+  }
+}
+
+inline void binaryValue(BinaryWriter &out, const DeviceValue &value)
+{
+  if (value.kind == VALUE_STATE)
+  {
+    binaryBool(out, value.raw != 0);
+  }
+  else if (value.kind == VALUE_BINARY || value.decimals == 0)
+  {
+    binaryInt(out, value.raw);
+  }
+  else
+  {
+    binaryDouble(out, (double)value.raw / valueScale[value.decimals]);
+  }
+}
+
+// values changed after since, all when since is 0
+inline byte binaryChangedValues(DevicesValues &values, byte count, uint32_t since)
+{
+  byte changed = 0;
+  for (byte j = 0; j < count; j++)
+  {
+    changed += valueChanged(values.values[j], since) ? 1 : 0;
+  }
+  return changed;
+}
+
+// same document as GET / JSON: {"values":{id:{name:value}},"seq":seq}
+inline void binaryDevicesValues(BinaryWriter &out, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, uint32_t since, uint32_t seq)
+{
+  byte changedDevices = 0;
+  for (byte i = 0; i < devices.count; i++)
+  {
+    DevicesValues &values = devicesValues[devices.devices[i].deviceId];
+    changedDevices += binaryChangedValues(values, devices.devices[i].valuesCount, since) > 0 ? 1 : 0;
+  }
+
+  binaryMap(out, 2);
+  binaryStr(out, "values");
+  binaryMap(out, changedDevices);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    DevicesValues &values = devicesValues[devices.devices[i].deviceId];
+    byte changed = binaryChangedValues(values, devices.devices[i].valuesCount, since);
+    if (changed == 0)
+    {
+      continue;
+    }
+    binaryUint(out, devices.devices[i].deviceId);
+    binaryMap(out, changed);
+    for (byte j = 0; j < devices.devices[i].valuesCount; j++)
+    {
+      if (valueChanged(values.values[j], since))
+      {
+        binaryStr(out, values.names[j]);
+        binaryValue(out, values.values[j]);
+      }
+    }
+  }
+  char cursor[WS_VALUE_CURSOR_LEN];
+  valueCursor(seq, cursor);
+  binaryStr(out, "seq");
+  binaryStr(out, cursor);
+}
+
+// same document as GET /devices JSON device, without callbackauth
+inline void binaryDevice(BinaryWriter &out, Device &dev, DevicesValues &values)
+{
+  BinaryCounter counter;
+  binaryMap(out, 9);
+  binaryStr(out, "id");
+  binaryUint(out, dev.deviceId);
+  binaryStr(out, "active");
+  binaryBool(out, dev.active != 0);
+  binaryStr(out, "type");
+  binaryStr(out, deviceTypetoStr(dev.type));
+  binaryStr(out, "poll");
+  binaryInt(out, dev.pollInterval);
+  binaryStr(out, "callback");
+  WifiSensorsUtils::pushCallbackToString(dev.pushCallback, counter);
+  binaryStrHead(out, counter.count);
+  WifiSensorsUtils::pushCallbackToString(dev.pushCallback, out);
+
+  binaryStr(out, "config");
+  counter.count = 0;
+  WifiSensorsUtils::configToString(dev, counter);
+  if (out.format == BINARY_CBOR)
+  {
+    binaryCborHead(out, CBOR_TAG, CBOR_TAG_JSON);
+  }
+  binaryStrHead(out, counter.count);
+  WifiSensorsUtils::configToString(dev, out);
+
+  byte pins = WifiSensorsUtils::deviceRequirePins(dev.type);
+  binaryStr(out, "pins");
+  binaryMap(out, pins);
+  for (byte j = 0; j < pins; j++)
+  {
+    char name[8];
+    snprintf(name, sizeof(name), "pin%d", j + 1);
+    binaryStr(out, name);
+    binaryMap(out, 2);
+    binaryStr(out, "pin");
+    snprintf(name, sizeof(name), "%c%d", dev.pins[j].type, dev.pins[j].pin);
+    binaryStr(out, name);
+    binaryStr(out, "mode");
+    binaryStr(out, pinModeToStr(dev.pins[j].mode));
+  }
+
+  binaryStr(out, "values");
+  binaryMap(out, dev.valuesCount);
+  for (byte j = 0; j < dev.valuesCount; j++)
+  {
+    binaryStr(out, values.names[j]);
+    binaryValue(out, values.values[j]);
+  }
+  binaryStr(out, "units");
+  binaryMap(out, dev.valuesCount);
+  for (byte j = 0; j < dev.valuesCount; j++)
+  {
+    binaryStr(out, values.names[j]);
+    binaryStr(out, values.units[j]);
+  }
+}
+
+inline void binaryDevices(BinaryWriter &out, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues)
+{
+  binaryMap(out, 1);
+  binaryStr(out, "devices");
+  binaryArray(out, devices.count);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    binaryDevice(out, devices.devices[i], devicesValues[i]);
+  }
+}
+
+#endif
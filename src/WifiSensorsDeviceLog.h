@@ -0,0 +1,496 @@
+#ifndef WIFISENSORS_DEVICELOG_H
+#define WIFISENSORS_DEVICELOG_H
+
+/*
+Log-structured flash store of devices, one record per device (and one for devices count).
+Region of WS_DEVLOG_BLOCKS blocks of WS_DEVLOG_BLOCK_SIZE bytes is used as circular log. Every block starts with header page
+(magic, open sequence, erase count), records follow page aligned: header (magic, entry, seq, len, layout, CRC32 of header and payload) and payload.
+Records of other WS_DEVICE_LAYOUT are not loaded (counted as invalid), devices are restored from backup after layout change.
+Change of a device appends only its record. Boot replays all valid records, newest seq per entry wins.
+Background compaction copies live records out of the oldest block when fewer than WS_DEVLOG_MIN_FREE blocks are free,
+blocks are reused in circular order, so erases are spread over whole region.
+*/
+
+#include "WifiSensorsPersist.h"
+#include "WifiSensorsTypes.h"
+
+#include <FlashStorage.h>
+
+#define WS_DEVLOG_PAGE 64
+#define WS_DEVLOG_BLOCK_MAGIC 0x57534C42UL
+#define WS_DEVLOG_RECORD_MAGIC 0x5752
+#define WS_DEVLOG_META WS_MAX_DEVICES
+#define WS_DEVLOG_ENTRIES (WS_MAX_DEVICES + 1)
+#define WS_DEVLOG_NONE 0xFFFF
+#define WS_DEVLOG_NO_BLOCK 0xFF
+#define WS_DEVLOG_BLOCK_PAGES (WS_DEVLOG_BLOCK_SIZE / WS_DEVLOG_PAGE)
+#define WS_DEVLOG_RECORD_PAGES(len) ((sizeof(DeviceLogRecord) + (len) + WS_DEVLOG_PAGE - 1) / WS_DEVLOG_PAGE)
+#define WS_DEVLOG_SIZE (WS_DEVLOG_BLOCKS * WS_DEVLOG_BLOCK_SIZE)
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t erases;
+  uint32_t crc;
+} DeviceLogBlock;
+
+typedef struct
+{
+  uint16_t magic;
+  byte entry;
+  byte pages;
+  uint32_t seq;
+  uint16_t len;
+  // WS_DEVICE_LAYOUT of payload
+  uint16_t layout;
+  uint32_t crc;
+} DeviceLogRecord;
+
+typedef struct
+{
+  bool set;
+  byte count;
+} DeviceLogMeta;
+
+static_assert(WS_DEVLOG_BLOCK_SIZE % 256 == 0 && WS_DEVLOG_BLOCK_PAGES <= 255, "WS_DEVLOG_BLOCK_SIZE must be whole rows, at most 16kB");
+static_assert(WS_DEVLOG_RECORD_PAGES(sizeof(Device)) < WS_DEVLOG_BLOCK_PAGES, "device record does not fit in WS_DEVLOG_BLOCK_SIZE");
+static_assert(WS_DEVLOG_BLOCKS >= WS_DEVLOG_MIN_FREE + 1 + (WS_DEVLOG_ENTRIES * WS_DEVLOG_RECORD_PAGES(sizeof(Device))) / (WS_DEVLOG_BLOCK_PAGES - 1) + 1,
+              "WS_DEVLOG_BLOCKS too small for WS_MAX_DEVICES");
+
+struct DeviceLog
+{
+  FlashClass *flash;
+  const volatile byte *data;
+  Devices *devices;
+  uint32_t seq;
+  uint32_t blockSeq;
+  byte head;
+  byte headPage;
+  bool used[WS_DEVLOG_BLOCKS];
+  uint16_t where[WS_DEVLOG_ENTRIES];
+  uint32_t crc[WS_DEVLOG_ENTRIES];
+  bool dirty[WS_DEVLOG_ENTRIES];
+  PersistStats stats;
+};
+
+// defines flash region and log named name
+#define DeviceLogFlash(name)          \
+  Flash(name##_flash, WS_DEVLOG_SIZE) \
+  DeviceLog name = {&name##_flash, _data##name##_flash, NULL, 0, 0, 0, 0, {}, {}, {}, {}, {}};
+
+inline const volatile byte *devlogPage(DeviceLog &log, uint16_t page)
+{
+  return log.data + (uint32_t)page * WS_DEVLOG_PAGE;
+}
+
+inline uint16_t devlogBlockPage(byte block)
+{
+  return (uint16_t)block * WS_DEVLOG_BLOCK_PAGES;
+}
+
+inline uint32_t devlogBlockCrc(DeviceLogBlock &header)
+{
+  return persistCrc((const byte *)&header, offsetof(DeviceLogBlock, crc));
+}
+
+inline uint32_t devlogRecordCrc(DeviceLogRecord &header, const byte *payload)
+{
+  return persistCrc(payload, header.len, persistCrc((const byte *)&header, offsetof(DeviceLogRecord, crc)));
+}
+
+inline void devlogPayload(DeviceLog &log, byte entry, const byte *&payload, uint16_t &len, DeviceLogMeta &meta)
+{
+  if (entry == WS_DEVLOG_META)
+  {
+    meta.set = log.devices->set;
+    meta.count = log.devices->count;
+    payload = (const byte *)&meta;
+    len = sizeof(meta);
+  }
+  else
+  {
+    payload = (const byte *)&log.devices->devices[entry];
+    len = sizeof(Device);
+  }
+}
+
+inline void devlogInit(DeviceLog &log, const char *name, Devices &devices, ServerStats *stats)
+{
+  log.devices = &devices;
+  log.seq = 0;
+  log.blockSeq = 0;
+  log.head = WS_DEVLOG_NO_BLOCK;
+  log.headPage = 0;
+  for (byte b = 0; b < WS_DEVLOG_BLOCKS; b++)
+  {
+    log.used[b] = false;
+  }
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    log.where[i] = WS_DEVLOG_NONE;
+    log.crc[i] = 0;
+    log.dirty[i] = false;
+  }
+  memset(&log.stats, 0, sizeof(log.stats));
+  log.stats.name = name;
+  log.stats.slot = WS_DEVLOG_NO_BLOCK;
+  if (stats->storesCount < WS_MAX_STORES)
+  {
+    stats->stores[stats->storesCount++] = &log.stats;
+  }
+}
+
+inline byte devlogFreeBlocks(DeviceLog &log)
+{
+  byte free = 0;
+  for (byte b = 0; b < WS_DEVLOG_BLOCKS; b++)
+  {
+    free += log.used[b] ? 0 : 1;
+  }
+  return free;
+}
+
+inline bool devlogReadBlock(DeviceLog &log, byte block, DeviceLogBlock &header)
+{
+  log.flash->read(devlogPage(log, devlogBlockPage(block)), &header, sizeof(header));
+  return header.magic == WS_DEVLOG_BLOCK_MAGIC && header.crc == devlogBlockCrc(header);
+}
+
+// opens next free block after head, caller checks there is one
+inline void devlogOpenBlock(DeviceLog &log)
+{
+  byte block = log.head == WS_DEVLOG_NO_BLOCK ? 0 : (log.head + 1) % WS_DEVLOG_BLOCKS;
+  while (log.used[block])
+  {
+    block = (block + 1) % WS_DEVLOG_BLOCKS;
+  }
+  DeviceLogBlock header;
+  uint32_t erases = devlogReadBlock(log, block, header) ? header.erases : 0;
+
+  header.magic = WS_DEVLOG_BLOCK_MAGIC;
+  header.seq = ++log.blockSeq;
+  header.erases = erases + 1;
+  header.crc = devlogBlockCrc(header);
+  const volatile byte *ptr = devlogPage(log, devlogBlockPage(block));
+  log.flash->erase(ptr, WS_DEVLOG_BLOCK_SIZE);
+  log.flash->write(ptr, &header, sizeof(header));
+
+  log.used[block] = true;
+  log.head = block;
+  log.headPage = 1;
+  log.stats.slot = block;
+  log.stats.rowErases += WS_DEVLOG_BLOCK_SIZE / 256;
+  log.stats.bytesWritten += WS_DEVLOG_PAGE;
+  log.stats.maxErases = header.erases > log.stats.maxErases ? header.erases : log.stats.maxErases;
+}
+
+// writes record page by page, every flash write starts on page boundary
+inline bool devlogWriteRecord(DeviceLog &log, byte entry)
+{
+  const byte *payload;
+  uint16_t len;
+  DeviceLogMeta meta;
+  devlogPayload(log, entry, payload, len, meta);
+
+  byte pages = WS_DEVLOG_RECORD_PAGES(len);
+  if (log.head == WS_DEVLOG_NO_BLOCK || log.headPage + pages > WS_DEVLOG_BLOCK_PAGES)
+  {
+    if (devlogFreeBlocks(log) == 0)
+    {
+      return false;
+    }
+    devlogOpenBlock(log);
+  }
+
+  DeviceLogRecord header;
+  header.magic = WS_DEVLOG_RECORD_MAGIC;
+  header.entry = entry;
+  header.pages = pages;
+  header.seq = log.seq + 1;
+  header.len = len;
+  header.layout = WS_DEVICE_LAYOUT;
+  header.crc = devlogRecordCrc(header, payload);
+
+  uint16_t page = devlogBlockPage(log.head) + log.headPage;
+  byte buf[WS_DEVLOG_PAGE];
+  size_t total = sizeof(header) + len;
+  for (size_t offset = 0; offset < total; offset += WS_DEVLOG_PAGE)
+  {
+    memset(buf, 0xFF, sizeof(buf));
+    for (size_t i = 0; i < WS_DEVLOG_PAGE && offset + i < total; i++)
+    {
+      size_t pos = offset + i;
+      buf[i] = pos < sizeof(header) ? ((const byte *)&header)[pos] : payload[pos - sizeof(header)];
+    }
+    log.flash->write(devlogPage(log, page + offset / WS_DEVLOG_PAGE), buf, WS_DEVLOG_PAGE);
+  }
+  log.headPage += pages;
+  log.stats.bytesWritten += pages * WS_DEVLOG_PAGE;
+
+  DeviceLogRecord written;
+  log.flash->read(devlogPage(log, page), &written, sizeof(written));
+  if (written.crc != header.crc || written.crc != devlogRecordCrc(written, (const byte *)devlogPage(log, page) + sizeof(written)))
+  {
+    log.stats.failed++;
+    return false;
+  }
+
+  log.seq = header.seq;
+  log.stats.seq = log.seq;
+  log.where[entry] = page;
+  log.crc[entry] = header.crc;
+  log.dirty[entry] = false;
+  return true;
+}
+
+// oldest used block other than head
+inline byte devlogTail(DeviceLog &log)
+{
+  for (byte i = 1; i < WS_DEVLOG_BLOCKS; i++)
+  {
+    byte block = (log.head + i) % WS_DEVLOG_BLOCKS;
+    if (log.used[block])
+    {
+      return block;
+    }
+  }
+  return WS_DEVLOG_NO_BLOCK;
+}
+
+// moves live records out of oldest block and frees it
+inline bool devlogCompactStep(DeviceLog &log)
+{
+  byte tail = log.head == WS_DEVLOG_NO_BLOCK ? WS_DEVLOG_NO_BLOCK : devlogTail(log);
+  if (tail == WS_DEVLOG_NO_BLOCK)
+  {
+    return false;
+  }
+
+  uint16_t first = devlogBlockPage(tail);
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    if (log.where[i] != WS_DEVLOG_NONE && log.where[i] >= first && log.where[i] < first + WS_DEVLOG_BLOCK_PAGES)
+    {
+      // current value is written, so pending change of this entry is committed too
+      if (!devlogWriteRecord(log, i))
+      {
+        return false;
+      }
+      log.stats.relocated++;
+    }
+  }
+  log.used[tail] = false;
+  return true;
+}
+
+inline bool devlogReserve(DeviceLog &log, byte pages)
+{
+  if (log.head != WS_DEVLOG_NO_BLOCK && log.headPage + pages <= WS_DEVLOG_BLOCK_PAGES)
+  {
+    return true;
+  }
+  // keep one free block for compaction
+  for (byte i = 0; i < WS_DEVLOG_BLOCKS && devlogFreeBlocks(log) < 2; i++)
+  {
+    if (!devlogCompactStep(log))
+    {
+      break;
+    }
+  }
+  return devlogFreeBlocks(log) >= 2;
+}
+
+inline void devlogChanged(DeviceLog &log, byte entry)
+{
+  log.dirty[entry] = true;
+  persistMarkDirty(log.stats);
+}
+
+inline void devlogChangedAll(DeviceLog &log)
+{
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    log.dirty[i] = true;
+  }
+  persistMarkDirty(log.stats);
+}
+
+inline bool devlogCommit(DeviceLog &log)
+{
+  if (!log.stats.dirty)
+  {
+    return true;
+  }
+
+  bool ok = true;
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    if (!log.dirty[i])
+    {
+      continue;
+    }
+
+    const byte *payload;
+    uint16_t len;
+    DeviceLogMeta meta;
+    devlogPayload(log, i, payload, len, meta);
+    DeviceLogRecord header;
+    header.magic = WS_DEVLOG_RECORD_MAGIC;
+    header.entry = i;
+    header.pages = WS_DEVLOG_RECORD_PAGES(len);
+    header.seq = log.seq + 1;
+    header.len = len;
+    header.layout = WS_DEVICE_LAYOUT;
+    if (log.where[i] != WS_DEVLOG_NONE)
+    {
+      // same payload as latest record, only seq differs
+      DeviceLogRecord latest;
+      log.flash->read(devlogPage(log, log.where[i]), &latest, sizeof(latest));
+      header.seq = latest.seq;
+      if (devlogRecordCrc(header, payload) == log.crc[i])
+      {
+        log.dirty[i] = false;
+        log.stats.skipped++;
+        continue;
+      }
+    }
+
+    if (!devlogReserve(log, header.pages) || !devlogWriteRecord(log, i))
+    {
+      ok = false;
+      continue;
+    }
+    log.stats.commits++;
+  }
+
+  log.stats.dirty = !ok;
+  if (!ok)
+  {
+    log.stats.dirtySince = millis();
+  }
+  return ok;
+}
+
+// background compaction, one block per call
+inline void devlogMaintain(DeviceLog &log)
+{
+  if (log.head != WS_DEVLOG_NO_BLOCK && devlogFreeBlocks(log) < WS_DEVLOG_MIN_FREE)
+  {
+    devlogCompactStep(log);
+  }
+}
+
+// replays log into devices, devices are zeroed when log is empty
+inline bool devlogLoad(DeviceLog &log)
+{
+  memset(log.devices, 0, sizeof(Devices));
+  uint32_t best[WS_DEVLOG_ENTRIES];
+  byte ends[WS_DEVLOG_BLOCKS];
+  bool found = false;
+  log.seq = 0;
+  log.stats.invalid = 0;
+  log.head = WS_DEVLOG_NO_BLOCK;
+  log.headPage = 0;
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    log.where[i] = WS_DEVLOG_NONE;
+  }
+
+  for (byte b = 0; b < WS_DEVLOG_BLOCKS; b++)
+  {
+    DeviceLogBlock block;
+    log.used[b] = devlogReadBlock(log, b, block);
+    if (!log.used[b])
+    {
+      continue;
+    }
+    log.stats.maxErases = block.erases > log.stats.maxErases ? block.erases : log.stats.maxErases;
+    if (log.head == WS_DEVLOG_NO_BLOCK || (int32_t)(block.seq - log.blockSeq) > 0)
+    {
+      log.head = b;
+      log.blockSeq = block.seq;
+    }
+
+    byte page = 1;
+    while (page < WS_DEVLOG_BLOCK_PAGES)
+    {
+      uint16_t at = devlogBlockPage(b) + page;
+      DeviceLogRecord record;
+      log.flash->read(devlogPage(log, at), &record, sizeof(record));
+      if (record.magic != WS_DEVLOG_RECORD_MAGIC || record.pages == 0 || page + record.pages > WS_DEVLOG_BLOCK_PAGES)
+      {
+        // erased or torn header, rest of block is unused
+        break;
+      }
+      page += record.pages;
+      if (record.entry >= WS_DEVLOG_ENTRIES || record.pages != WS_DEVLOG_RECORD_PAGES(record.len) ||
+          record.layout != WS_DEVICE_LAYOUT || record.len != (record.entry == WS_DEVLOG_META ? sizeof(DeviceLogMeta) : sizeof(Device)) ||
+          record.crc != devlogRecordCrc(record, (const byte *)devlogPage(log, at) + sizeof(record)))
+      {
+        log.stats.invalid++;
+        continue;
+      }
+      if (!found || (int32_t)(record.seq - log.seq) > 0)
+      {
+        log.seq = record.seq;
+      }
+      found = true;
+      if (log.where[record.entry] == WS_DEVLOG_NONE || (int32_t)(record.seq - best[record.entry]) > 0)
+      {
+        log.where[record.entry] = at;
+        log.crc[record.entry] = record.crc;
+        best[record.entry] = record.seq;
+      }
+    }
+    ends[b] = page;
+  }
+  if (log.head != WS_DEVLOG_NO_BLOCK)
+  {
+    log.headPage = ends[log.head];
+  }
+
+  // blocks without live records were compacted before, they are free
+  for (byte b = 0; b < WS_DEVLOG_BLOCKS; b++)
+  {
+    if (!log.used[b] || b == log.head)
+    {
+      continue;
+    }
+    uint16_t first = devlogBlockPage(b);
+    bool live = false;
+    for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+    {
+      live = live || (log.where[i] != WS_DEVLOG_NONE && log.where[i] >= first && log.where[i] < first + WS_DEVLOG_BLOCK_PAGES);
+    }
+    log.used[b] = live;
+  }
+
+  for (byte i = 0; i < WS_DEVLOG_ENTRIES; i++)
+  {
+    log.dirty[i] = false;
+    if (log.where[i] == WS_DEVLOG_NONE)
+    {
+      continue;
+    }
+    const volatile byte *payload = devlogPage(log, log.where[i]) + sizeof(DeviceLogRecord);
+    if (i == WS_DEVLOG_META)
+    {
+      DeviceLogMeta meta;
+      log.flash->read(payload, &meta, sizeof(meta));
+      log.devices->set = meta.set;
+      log.devices->count = meta.count;
+    }
+    else
+    {
+      log.flash->read(payload, &log.devices->devices[i], sizeof(Device));
+    }
+  }
+
+  log.stats.dirty = false;
+  log.stats.seq = log.seq;
+  log.stats.slot = log.head;
+  return log.where[WS_DEVLOG_META] != WS_DEVLOG_NONE;
+}
+
+#endif
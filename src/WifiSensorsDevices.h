@@ -8,27 +8,178 @@
 * GENERIC_ANALOG - min[float] default:0.0, max[float] default:1023, readcnt[byte] default:1, readdelay[int] default:0, removeminmax[true|false] default:false
 * MOTION - bounce=[int] default:5
 * RELAY - trigger=[HIGH|LOW] default:HIGH
-* DEVICE_TEMP_DALLAS - temp_adj[float] default:0.0
+* DEVICE_TEMP_DALLAS - temp_adj[float] default:0.0, rom=[hex ROM id see /onewire] required when bus has more sensors, resolution=[9-12] default:12 (shared by bus)
+
+New device: add DeviceType value in WifiSensorsTypes.h, driver section below and driver in Drivers list at the end of this file.
 */
 
+#include "WifiSensorsDrivers.h"
+#include "WifiSensorsPool.h"
+#include "WifiSensorsScheduler.h"
 #include "WifiSensorsTypes.h"
 #include "WifiSensorsUtils.h"
 
+#if WS_DRIVER_BUTTON || WS_DRIVER_MOTION || WS_DRIVER_SWITCH
 #include <Bounce2.h>
-#include <DallasTemperature.h>
+#endif
+#if WS_DRIVER_DHT22
 #include <DHT_U.h>
+#endif
+#if WS_DRIVER_TEMP_DALLAS
+#include <DallasTemperature.h>
 #include <OneWire.h>
+#endif
 
 extern unsigned long timeNow(ServerStats &stats);
 
 extern WiFiClient wifiClient;
 extern Array<DevicesValues, WS_MAX_DEVICES> devicesValues;
-extern Bounce *debouncers[WS_MAX_DEVICES];
-extern DHT_Unified *dht22s[WS_MAX_DEVICES];
-extern DallasTemperature *dallasTemp[WS_MAX_DEVICES];
-extern DeviceAddress dallasDeviceAddress[WS_MAX_DEVICES];
-extern uint16_t dallasConversionTime[WS_MAX_DEVICES];
-extern unsigned long dallasLastTempMeasurement[WS_MAX_DEVICES];
+extern ValueHistory devicesHistory[WS_MAX_DEVICES][WS_MAX_DEVICE_VALUES];
+extern PollScheduler pollScheduler;
+
+void deviceRecordValue(Device *dev, ServerStats *stats, byte valueId, float value)
+{
+  statsAdd(devicesValues[dev->deviceId].stats[valueId], value, millis());
+  historyAdd(devicesHistory[dev->deviceId][valueId], value, timeNow(*stats));
+}
+
+byte deviceValue(byte deviceId, byte valueId, const char *name, const char *unit, DeviceValueKind kind, byte decimals)
+{
+  devicesValues[deviceId].names[valueId] = name;
+  devicesValues[deviceId].units[valueId] = unit;
+  valueInit(devicesValues[deviceId].values[valueId], kind, decimals);
+  return valueId + 1;
+}
+
+byte devicePush(Device *dev)
+{
+  CallbackPath path;
+  WifiSensorsUtils::prepareCallbackPath(dev->pushCallback.path, devicesValues[dev->deviceId], dev->valuesCount, path);
+  return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path.c_str());
+}
+
+bool deviceIsOutput(DeviceType type)
+{
+  const DeviceDriver *driver = deviceDriver(type);
+  return driver != NULL && driver->output;
+}
+
+bool deviceSharedPin(Devices &devices, DeviceType type, char pinType, int pin)
+{
+  const DeviceDriver *driver = deviceDriver(type);
+  if (driver == NULL || !driver->sharedPins)
+  {
+    return false;
+  }
+  for (byte i = 0; i < devices.count; i++)
+  {
+    Device *dev = &(devices.devices[i]);
+    if (dev->active && dev->type == type && dev->pins[0].type == pinType && dev->pins[0].pin == pin)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool deviceConfigUpdated(Form *config, Device *dev)
+{
+  dev->pollInterval = formInt(*config, FORM_KEY("interval"), dev->pollInterval);
+
+  const DeviceDriver *driver = deviceDriver(dev->type);
+  if (driver != NULL)
+  {
+    return driver->configure(config, dev);
+  }
+  return true;
+}
+
+void devicePoolRegister(ServerStats *stats, PoolStats *pool)
+{
+  for (byte i = 0; i < stats->poolsCount; i++)
+  {
+    if (stats->pools[i] == pool)
+    {
+      return;
+    }
+  }
+  if (stats->poolsCount < WS_MAX_POOLS)
+  {
+    stats->pools[stats->poolsCount++] = pool;
+  }
+}
+
+void devicesInit(ServerStats *stats)
+{
+  for (byte i = 0; i < DEVICE_UNKNOWN; i++)
+  {
+    const DeviceDriver *driver = deviceDriver(static_cast<DeviceType>(i));
+    if (driver != NULL)
+    {
+      driver->init(stats);
+    }
+  }
+}
+
+void deviceRelease(byte deviceId)
+{
+  for (byte i = 0; i < DEVICE_UNKNOWN; i++)
+  {
+    const DeviceDriver *driver = deviceDriver(static_cast<DeviceType>(i));
+    if (driver != NULL)
+    {
+      driver->release(deviceId);
+    }
+  }
+}
+
+byte deviceValuesNames(DeviceType type, byte deviceId)
+{
+  const DeviceDriver *driver = deviceDriver(type);
+  if (driver != NULL)
+  {
+    return driver->values(deviceId);
+  }
+  return 0;
+}
+
+void configBounceToString(Device &dev, Print &out)
+{
+  out.print("\"bounce\":");
+  out.print(dev.config.ints[DEVICE_CONFIG_INTS_DEBOUNCE]);
+}
+
+#if WS_DRIVER_BUTTON || WS_DRIVER_MOTION || WS_DRIVER_RELAY || WS_DRIVER_SWITCH
+byte valuesState(byte deviceId)
+{
+  return deviceValue(deviceId, 0, "state", "on/off", VALUE_STATE, 0);
+}
+#endif
+
+// BUTTON, MOTION, SWITCH
+#if WS_DRIVER_BUTTON || WS_DRIVER_MOTION || WS_DRIVER_SWITCH
+Pool<Bounce, WS_POOL_DEBOUNCERS> debouncersPool;
+Bounce *debouncers[WS_MAX_DEVICES];
+
+void releaseDebouncer(byte deviceId)
+{
+  poolDelete(debouncersPool, debouncers[deviceId]);
+  debouncers[deviceId] = NULL;
+}
+
+// init runs again when devices are set up again (failed restore), objects of previous setup go back to the pool
+void initDebouncers(ServerStats *stats)
+{
+  if (debouncersPool.stats.name == NULL)
+  {
+    poolInit(debouncersPool, "debouncers");
+  }
+  for (byte i = 0; i < WS_MAX_DEVICES; i++)
+  {
+    releaseDebouncer(i);
+  }
+  devicePoolRegister(stats, &debouncersPool.stats);
+}
 
 void deviceButtonAttachAnalogPin(Bounce *button, int pin)
 {
@@ -61,231 +212,406 @@ void deviceButtonAttachAnalogPin(Bounce *button, int pin)
   }
 }
 
-bool deviceIsOutput(DeviceType type)
+bool configureButton(Form *config, Device *dev)
 {
-  return (type == DEVICE_RELAY);
+  dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = formInt(*config, FORM_KEY("bounce"), 20);
+  dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = 0x1;
+  return true;
 }
 
-bool configureButton(Hashtable<String, String> *config, Device *dev)
+bool configureMotion(Form *config, Device *dev)
 {
-  dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = 20;
-  dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = 0x1;
+  dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = formInt(*config, FORM_KEY("bounce"), 5);
+  return true;
+}
 
-  if (config->containsKey("bounce"))
+byte readButton(Device *dev, ServerStats *, bool &push)
+{
+  Bounce *b = debouncers[dev->deviceId];
+  if (b != NULL && b->update() && b->read() == LOW)
   {
-    String bounce = *config->get("bounce");
-    dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = bounce.toInt();
+    DeviceValue &value = devicesValues[dev->deviceId].values[0];
+    valueSetState(value, !value.raw);
+    push = true;
   }
-  return true;
+  return 0;
 }
 
-bool configureDHT22(Hashtable<String, String> *config, Device *dev)
+byte readMotion(Device *dev, ServerStats *, bool &push)
 {
-  dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ] = 0.0;
-  dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ] = 0.0;
+  Bounce *b = debouncers[dev->deviceId];
+  if (b != NULL && b->update())
+  {
+    DeviceValue &value = devicesValues[dev->deviceId].values[0];
+    push = valueSetState(value, b->read() == HIGH);
+  }
+  return 0;
+}
+
+byte readSwitch(Device *dev, ServerStats *, bool &push)
+{
+  Bounce *b = debouncers[dev->deviceId];
+  if (b != NULL && b->update())
+  {
+    DeviceValue &value = devicesValues[dev->deviceId].values[0];
+    valueSetState(value, b->read() == LOW);
+    push = true;
+  }
+  return 0;
+}
 
-  if (config->containsKey("temp_adj"))
+void setupButton(Device *dev)
+{
+  Bounce *button = poolNew(debouncersPool);
+  if (button == NULL)
   {
-    String adj = *config->get("temp_adj");
-    dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ] = adj.toFloat();
+    Serial.println(F("WARN: No free debouncer!"));
+    return;
   }
-  if (config->containsKey("humid_adj"))
+  if (dev->pins[0].type == 'D')
   {
-    String adj = *config->get("humid_adj");
-    dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ] = adj.toFloat();
+    button->attach(dev->pins[0].pin);
+  }
+  else
+  {
+    deviceButtonAttachAnalogPin(button, dev->pins[0].pin);
   }
 
-  return true;
+  button->interval(dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE]);
+  debouncers[dev->deviceId] = button;
+
+  valueSetState(devicesValues[dev->deviceId].values[0], false);
 }
+#endif
 
-bool configureGenericAnalog(Hashtable<String, String> *config, Device *dev)
+#if WS_DRIVER_BUTTON
+struct ButtonDriver : DeviceDriverBase
 {
-  if (config->containsKey("min"))
+  static const DeviceType type = DEVICE_BUTTON;
+  static constexpr const char *name = "BUTTON";
+
+  static byte values(byte deviceId)
   {
-    String adj = *config->get("min");
-    dev->config.floats[DEVICE_CONFIG_FLOAT_MIN] = adj.toFloat();
+    return valuesState(deviceId);
   }
-  else
+
+  static bool configure(Form *config, Device *dev)
   {
-    dev->config.floats[DEVICE_CONFIG_FLOAT_MIN] = 0.0f;
+    return configureButton(config, dev);
   }
-  if (config->containsKey("max"))
+
+  static void setup(Device *dev)
   {
-    String adj = *config->get("max");
-    dev->config.floats[DEVICE_CONFIG_FLOAT_MAX] = adj.toFloat();
+    setupButton(dev);
   }
-  else
+
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
+  {
+    return readButton(dev, stats, push);
+  }
+
+  static void configToString(Device &dev, Print &out)
   {
-    dev->config.floats[DEVICE_CONFIG_FLOAT_MAX] = 1023.0f;
+    configBounceToString(dev, out);
   }
-  if (config->containsKey("readcnt"))
+
+  static void init(ServerStats *stats)
   {
-    String readcnt = *config->get("readcnt");
-    dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT] = (byte)readcnt.toInt();
+    initDebouncers(stats);
   }
-  else
+
+  static void release(byte deviceId)
   {
-    dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT] = 1;
+    releaseDebouncer(deviceId);
   }
-  if (config->containsKey("readdelay"))
+};
+#endif
+
+#if WS_DRIVER_MOTION
+struct MotionDriver : DeviceDriverBase
+{
+  static const DeviceType type = DEVICE_MOTION;
+  static constexpr const char *name = "MOTION";
+
+  static byte values(byte deviceId)
   {
-    String readdelay = *config->get("readdelay");
-    dev->config.ints[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY] = readdelay.toInt();
+    return valuesState(deviceId);
   }
-  else
+
+  static bool configure(Form *config, Device *dev)
   {
-    dev->config.ints[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY] = 0;
+    return configureMotion(config, dev);
   }
-  if (config->containsKey("removeminmax"))
+
+  static void setup(Device *dev)
   {
-    String removeminmax = *config->get("removeminmax");
-    if (removeminmax == "true")
-    {
-      dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] = 0x1;
-    }
-    else
-    {
-      dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] = 0x0;
-    }
+    setupButton(dev);
   }
-  else
+
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
   {
-    dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] = 0x0;
+    return readMotion(dev, stats, push);
   }
 
-  return true;
-}
+  static void configToString(Device &dev, Print &out)
+  {
+    configBounceToString(dev, out);
+  }
 
-bool configureGenericDigital(Hashtable<String, String> *config, Device *dev)
-{
-  return true;
-}
+  static void init(ServerStats *stats)
+  {
+    initDebouncers(stats);
+  }
+
+  static void release(byte deviceId)
+  {
+    releaseDebouncer(deviceId);
+  }
+};
+#endif
 
-bool configureMotion(Hashtable<String, String> *config, Device *dev)
+#if WS_DRIVER_SWITCH
+struct SwitchDriver : DeviceDriverBase
 {
-  dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = 5;
-  if (config->containsKey("bounce"))
+  static const DeviceType type = DEVICE_SWITCH;
+  static constexpr const char *name = "SWITCH";
+
+  static byte values(byte deviceId)
+  {
+    return valuesState(deviceId);
+  }
+
+  static bool configure(Form *config, Device *dev)
+  {
+    return configureButton(config, dev);
+  }
+
+  static void setup(Device *dev)
+  {
+    setupButton(dev);
+  }
+
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
+  {
+    return readSwitch(dev, stats, push);
+  }
+
+  static void configToString(Device &dev, Print &out)
+  {
+    configBounceToString(dev, out);
+  }
+
+  static void init(ServerStats *stats)
+  {
+    initDebouncers(stats);
+  }
+
+  static void release(byte deviceId)
   {
-    String bounce = *config->get("bounce");
-    dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE] = bounce.toInt();
+    releaseDebouncer(deviceId);
   }
+};
+#endif
+
+// DHT22
+#if WS_DRIVER_DHT22
+Pool<DHT_Unified, WS_POOL_DHT22> dht22sPool;
+DHT_Unified *dht22s[WS_MAX_DEVICES];
+bool dht22sProbed[WS_MAX_DEVICES];
 
+bool configureDHT22(Form *config, Device *dev)
+{
+  dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ] = formFloat(*config, FORM_KEY("humid_adj"), 0.0f);
+  dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ] = formFloat(*config, FORM_KEY("temp_adj"), 0.0f);
   return true;
 }
 
-bool configureRelay(Hashtable<String, String> *config, Device *dev)
+// sensor details are only reported, printed on first read so boot does not wait for Serial
+void probeDHT22(DHT_Unified *dht)
 {
-  dev->pollInterval == -1L;
-  dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = 0x1;
+  sensor_t sensor;
+  dht->temperature().getSensor(&sensor);
+  Serial.print(F("DHT22 TEMP: "));
+  Serial.print(sensor.name);
+  Serial.print(F(" "));
+  Serial.println(sensor.version);
+  dht->humidity().getSensor(&sensor);
+  Serial.print(F("DHT22 HUMID: "));
+  Serial.print(sensor.name);
+  Serial.print(F(" "));
+  Serial.println(sensor.version);
+  Serial.print(F("DHT22 DELAY: "));
+  Serial.println(sensor.min_delay / 1000);
+  Serial.print(F("DHT22 RESOLUTION: "));
+  Serial.println(sensor.resolution);
+}
+
+byte readDHT22(Device *dev, ServerStats *stats, bool &push)
+{
+  sensors_event_t event;
+  byte warnCnt = 0;
+  bool tempRead = false;
+  bool humidRead = false;
 
-  if (config->containsKey("trigger"))
+  DHT_Unified *dht = dht22s[dev->deviceId];
+  if (dht == NULL)
   {
-    String trigger = *config->get("trigger");
-    if (trigger == "LOW")
-    {
-      dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = 0x0;
-    }
-    else
-    {
-      dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = 0x1;
-    }
+    return 0;
+  }
+  if (!dht22sProbed[dev->deviceId])
+  {
+    probeDHT22(dht);
+    dht22sProbed[dev->deviceId] = true;
+  }
+  dht->temperature().getEvent(&event);
+  if (isnan(event.temperature))
+  {
+    warnCnt++;
+    WifiSensorsUtils::setWarning(*stats, F("Reading DHT22 TEMP failed!"), "");
+    Serial.println(F("Reading DHT22 TEMP failed!"));
+  }
+  else
+  {
+    float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
+    float temp = WifiSensorsUtils::adjustPercent(event.temperature, adj);
+    valueSetNumber(devicesValues[dev->deviceId].values[0], temp);
+    deviceRecordValue(dev, stats, 0, valueToFloat(devicesValues[dev->deviceId].values[0]));
+    tempRead = true;
+  }
+  dht->humidity().getEvent(&event);
+  if (isnan(event.relative_humidity))
+  {
+    warnCnt++;
+    WifiSensorsUtils::setWarning(*stats, F("Reading DTH22 HUMID failed!"), "");
+    Serial.println(F("Reading DTH22 HUMID failed!"));
+  }
+  else
+  {
+    float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ];
+    float humid = WifiSensorsUtils::adjustPercent(event.relative_humidity, adj);
+    valueSetNumber(devicesValues[dev->deviceId].values[1], humid);
+    deviceRecordValue(dev, stats, 1, valueToFloat(devicesValues[dev->deviceId].values[1]));
+    humidRead = true;
   }
 
-  return true;
+  push = tempRead && humidRead;
+  return warnCnt;
 }
 
-bool configureTempDallas(Hashtable<String, String> *config, Device *dev)
+void setupDHT22(Device *dev)
 {
-  dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ] = 0.0;
-  if (config->containsKey("temp_adj"))
+  DHT_Unified *dht = poolNew(dht22sPool, dev->pins[0].pin, DHT22);
+  if (dht == NULL)
   {
-    String adj = *config->get("temp_adj");
-    dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ] = adj.toFloat();
+    Serial.println(F("WARN: No free DHT22 slot!"));
+    return;
+  }
+  dht22s[dev->deviceId] = dht;
+  dht22sProbed[dev->deviceId] = false;
+  dht->begin();
+
+  sensor_t sensor;
+  dht->humidity().getSensor(&sensor);
+  int32_t readDealay = (sensor.min_delay / 1000);
+
+  valueSetNumber(devicesValues[dev->deviceId].values[0], 0.0f);
+  valueSetNumber(devicesValues[dev->deviceId].values[1], 0.0f);
+
+  if (readDealay > dev->pollInterval)
+  {
+    dev->pollInterval = readDealay;
   }
-  return true;
 }
 
-bool deviceConfigUpdated(Hashtable<String, String> *config, Device *dev)
+struct DHT22Driver : DeviceDriverBase
 {
-  if (config->containsKey("interval"))
+  static const DeviceType type = DEVICE_DHT22;
+  static constexpr const char *name = "DHT22";
+
+  static byte values(byte deviceId)
   {
-    String interval = *config->get("interval");
-    dev->pollInterval = interval.toInt();
+    deviceValue(deviceId, 0, "temp", "C", VALUE_NUMBER, 1);
+    return deviceValue(deviceId, 1, "humid", "%", VALUE_NUMBER, 1);
   }
 
-  switch (dev->type)
+  static bool configure(Form *config, Device *dev)
   {
-  case DEVICE_BUTTON:
-    return configureButton(config, dev);
-  case DEVICE_DHT22:
     return configureDHT22(config, dev);
-  case DEVICE_GENERIC_ANALOG_INPUT:
-    return configureGenericAnalog(config, dev);
-  case DEVICE_GENERIC_DIGITAL_INPUT:
-    return configureGenericDigital(config, dev);
-  case DEVICE_MOTION:
-    return configureMotion(config, dev);
-  case DEVICE_RELAY:
-    return configureRelay(config, dev);
-  case DEVICE_SWITCH:
-    return configureButton(config, dev);
-  case DEVICE_TEMP_DALLAS:
-    return configureTempDallas(config, dev);
   }
 
-  return true;
-}
+  static void setup(Device *dev)
+  {
+    setupDHT22(dev);
+  }
 
-byte deviceValuesNames(DeviceType type, byte deviceId)
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
+  {
+    return readDHT22(dev, stats, push);
+  }
+
+  static void configToString(Device &dev, Print &out)
+  {
+    out.print("\"humid_adj\":");
+    out.print(dev.config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ]);
+    out.print(",\"temp_adj\":");
+    out.print(dev.config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ]);
+  }
+
+  static void init(ServerStats *stats)
+  {
+    if (dht22sPool.stats.name == NULL)
+    {
+      poolInit(dht22sPool, "dht22");
+    }
+    for (byte i = 0; i < WS_MAX_DEVICES; i++)
+    {
+      release(i);
+    }
+    devicePoolRegister(stats, &dht22sPool.stats);
+  }
+
+  static void release(byte deviceId)
+  {
+    poolDelete(dht22sPool, dht22s[deviceId]);
+    dht22s[deviceId] = NULL;
+  }
+};
+#endif
+
+// GENERIC_ANALOG, GENERIC_DIGITAL
+#if WS_DRIVER_GENERIC_ANALOG || WS_DRIVER_GENERIC_DIGITAL
+void setupGeneric(Device *dev)
 {
-  switch (type)
+  if (dev->type == DEVICE_GENERIC_DIGITAL_INPUT)
   {
-  case DEVICE_BUTTON:
-    devicesValues[deviceId].names[0] = "state";
-    devicesValues[deviceId].units[0] = "on/off";
-    return 1;
-  case DEVICE_DHT22:
-    devicesValues[deviceId].names[0] = "temp";
-    devicesValues[deviceId].units[0] = "C";
-    devicesValues[deviceId].names[1] = "humid";
-    devicesValues[deviceId].units[1] = "%";
-    return 2;
-  case DEVICE_GENERIC_ANALOG_INPUT:
-    devicesValues[deviceId].names[0] = "value";
-    devicesValues[deviceId].units[0] = "conf(min)-conf(max)";
-    return 1;
-  case DEVICE_GENERIC_DIGITAL_INPUT:
-    devicesValues[deviceId].names[0] = "value";
-    devicesValues[deviceId].units[0] = "0/1";
-    return 1;
-  case DEVICE_MOTION:
-    devicesValues[deviceId].names[0] = "state";
-    devicesValues[deviceId].units[0] = "on/off";
-    return 1;
-  case DEVICE_RELAY:
-    devicesValues[deviceId].names[0] = "state";
-    devicesValues[deviceId].units[0] = "on/off";
-    return 1;
-  case DEVICE_SWITCH:
-    devicesValues[deviceId].names[0] = "state";
-    devicesValues[deviceId].units[0] = "on/off";
-    return 1;
-  case DEVICE_TEMP_DALLAS:
-    devicesValues[deviceId].names[0] = "temp";
-    devicesValues[deviceId].units[0] = "C";
-    return 1;
+    valueSetState(devicesValues[dev->deviceId].values[0], false);
   }
-  return 0;
+  else
+  {
+    valueSetNumber(devicesValues[dev->deviceId].values[0], 0.0f);
+  }
+}
+#endif
+
+#if WS_DRIVER_GENERIC_ANALOG
+bool configureGenericAnalog(Form *config, Device *dev)
+{
+  dev->config.floats[DEVICE_CONFIG_FLOAT_MIN] = formFloat(*config, FORM_KEY("min"), 0.0f);
+  dev->config.floats[DEVICE_CONFIG_FLOAT_MAX] = formFloat(*config, FORM_KEY("max"), 1023.0f);
+  dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT] = (byte)formInt(*config, FORM_KEY("readcnt"), 1);
+  dev->config.ints[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY] = formInt(*config, FORM_KEY("readdelay"), 0);
+  dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] = formEquals(*config, FORM_KEY("removeminmax"), "true") ? 0x1 : 0x0;
+  return true;
 }
 
-byte readAnalog(Device *dev, ServerStats *stats, byte readCnt, int readDelay, bool removeMinMax)
+byte readAnalog(Device *dev, ServerStats *stats, bool &push, byte readCnt, int readDelay, bool removeMinMax)
 {
   if (readCnt < 1)
   {
     readCnt = 1;
   }
 
-  float tmpVal, value = 0.0f;
+  float tmpVal = 0.0f, value = 0.0f;
   int min = 123;
   int max = 0;
 
@@ -331,288 +657,566 @@ byte readAnalog(Device *dev, ServerStats *stats, byte readCnt, int readDelay, bo
   value /= (1.0 * readCnt);
 
   value = 1.0 * map(value, 0, 1023, dev->config.floats[DEVICE_CONFIG_FLOAT_MIN], dev->config.floats[DEVICE_CONFIG_FLOAT_MAX]);
-  devicesValues[dev->deviceId].values[0] = String(value, 2);
-
-  if (dev->pushCallback.set)
-  {
-    String path;
-    String strValue = String(value, 2);
-    WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, strValue, path, devicesValues[dev->deviceId].names[0]);
-    return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
-  }
+  valueSetNumber(devicesValues[dev->deviceId].values[0], value);
+  deviceRecordValue(dev, stats, 0, valueToFloat(devicesValues[dev->deviceId].values[0]));
+  push = true;
   return 0;
 }
 
-byte readAnalog(Device *dev, ServerStats *stats)
+byte readAnalog(Device *dev, ServerStats *stats, bool &push)
 {
   byte cnt = dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT];
   int readDelay = dev->config.bytes[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY];
   bool removeMinMax = dev->config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX];
-  return readAnalog(dev, stats, cnt, readDelay, removeMinMax);
+  return readAnalog(dev, stats, push, cnt, readDelay, removeMinMax);
 }
 
-byte readDigital(Device *dev, ServerStats *stats)
+struct GenericAnalogDriver : DeviceDriverBase
 {
-  String value;
-  if (digitalRead(dev->pins[0].pin) == HIGH)
+  static const DeviceType type = DEVICE_GENERIC_ANALOG_INPUT;
+  static constexpr const char *name = "GENERIC_ANALOG";
+
+  static byte values(byte deviceId)
   {
-    value = "1";
+    return deviceValue(deviceId, 0, "value", "conf(min)-conf(max)", VALUE_NUMBER, 2);
   }
-  else
+
+  static bool configure(Form *config, Device *dev)
+  {
+    return configureGenericAnalog(config, dev);
+  }
+
+  static void setup(Device *dev)
+  {
+    setupGeneric(dev);
+  }
+
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
   {
-    value = "0";
+    return readAnalog(dev, stats, push);
   }
-  devicesValues[dev->deviceId].values[0] = value;
 
-  if (dev->pushCallback.set)
+  static void configToString(Device &dev, Print &out)
   {
-    String path;
-    WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, value, path, devicesValues[dev->deviceId].names[0]);
-    return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
+    out.print("\"min\":");
+    out.print(dev.config.floats[DEVICE_CONFIG_FLOAT_MIN]);
+    out.print(",\"max\":");
+    out.print(dev.config.floats[DEVICE_CONFIG_FLOAT_MAX]);
+    out.print(",\"readcnt\":");
+    out.print(dev.config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT]);
+    out.print(",\"readdelay\":");
+    out.print(dev.config.ints[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY]);
+    out.print(",\"removeminmax\":");
+    out.print(dev.config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] == 0x0 ? "\"false\"" : "\"true\"");
   }
+};
+#endif
+
+#if WS_DRIVER_GENERIC_DIGITAL
+byte readDigital(Device *dev, ServerStats *stats, bool &push)
+{
+  DeviceValue &value = devicesValues[dev->deviceId].values[0];
+  valueSetState(value, digitalRead(dev->pins[0].pin) == HIGH);
+  deviceRecordValue(dev, stats, 0, valueToFloat(value));
+  push = true;
   return 0;
 }
 
-byte readButton(Device *dev, ServerStats *stats)
+struct GenericDigitalDriver : DeviceDriverBase
 {
-  Bounce *b = debouncers[dev->deviceId];
-  if (b->update() && b->read() == LOW)
+  static const DeviceType type = DEVICE_GENERIC_DIGITAL_INPUT;
+  static constexpr const char *name = "GENERIC_DIGITAL";
+
+  static byte values(byte deviceId)
   {
-    String value1 = devicesValues[dev->deviceId].values[0] == "on" ? "off" : "on";
-    devicesValues[dev->deviceId].values[0] = value1;
-    if (dev->pushCallback.set)
-    {
-      String path;
-      WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, value1, path, devicesValues[dev->deviceId].names[0]);
-      return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
-    }
+    return deviceValue(deviceId, 0, "value", "0/1", VALUE_BINARY, 0);
   }
-  return 0;
-}
 
-byte readDHT22(Device *dev, ServerStats *stats)
+  static void setup(Device *dev)
+  {
+    setupGeneric(dev);
+  }
+
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
+  {
+    return readDigital(dev, stats, push);
+  }
+};
+#endif
+
+// RELAY
+#if WS_DRIVER_RELAY
+bool configureRelay(Form *config, Device *dev)
 {
-  sensors_event_t event;
-  byte warnCnt = 0;
-  String valueTemp;
-  String valueHumid;
+  dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] = formEquals(*config, FORM_KEY("trigger"), "LOW") ? 0x0 : 0x1;
+  return true;
+}
 
-  DHT_Unified *dht = dht22s[dev->deviceId];
-  dht->temperature().getEvent(&event);
-  if (isnan(event.temperature))
+void setupRelay(Device *dev)
+{
+  valueSetState(devicesValues[dev->deviceId].values[0], false);
+  if (dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x1)
   {
-    warnCnt++;
-    stats->lastWarning = "Reading DHT22 TEMP failed!";
-    stats->lastWarning += " ";
-    stats->lastWarning += timeNow(*stats);
-    Serial.println(F("Reading DHT22 TEMP failed!"));
+    WifiSensorsUtils::setPinValue(dev->pins[0].type, dev->pins[0].pin, LOW);
   }
   else
   {
-    float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
-    valueTemp = String(WifiSensorsUtils::adjustPercent(event.temperature, adj), 1);
-    devicesValues[dev->deviceId].values[0] = valueTemp;
+    WifiSensorsUtils::setPinValue(dev->pins[0].type, dev->pins[0].pin, HIGH);
   }
-  dht->humidity().getEvent(&event);
-  if (isnan(event.relative_humidity))
+}
+
+struct RelayDriver : DeviceDriverBase
+{
+  static const DeviceType type = DEVICE_RELAY;
+  static constexpr const char *name = "RELAY";
+  static const bool output = true;
+
+  static byte values(byte deviceId)
   {
-    warnCnt++;
-    stats->lastWarning = "Reading DTH22 HUMID failed!";
-    stats->lastWarning += " ";
-    stats->lastWarning += timeNow(*stats);
-    Serial.println(F("Reading DTH22 HUMID failed!"));
+    return valuesState(deviceId);
   }
-  else
+
+  static bool configure(Form *config, Device *dev)
   {
-    float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ];
-    valueHumid = String(WifiSensorsUtils::adjustPercent(event.relative_humidity, adj), 1);
-    devicesValues[dev->deviceId].values[1] = valueHumid;
+    return configureRelay(config, dev);
   }
 
-  if (dev->pushCallback.set && valueTemp != "" && valueHumid != "")
+  static void setup(Device *dev)
   {
-    String path;
-    WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, valueTemp, valueHumid, path, devicesValues[dev->deviceId].names[0], devicesValues[dev->deviceId].names[1]);
-    return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
+    setupRelay(dev);
   }
-  return warnCnt;
-}
 
-byte readMotion(Device *dev, ServerStats *stats)
+  static void configToString(Device &dev, Print &out)
+  {
+    out.print("\"trigger\":");
+    out.print(dev.config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x0 ? "\"LOW\"" : "\"HIGH\"");
+  }
+};
+#endif
+
+// TEMP_DALLAS
+#if WS_DRIVER_TEMP_DALLAS
+typedef struct
 {
-  Bounce *b = debouncers[dev->deviceId];
-  if (b->update())
+  int pin;
+  OneWire *oneWire;
+  DallasTemperature *sensors;
+  byte count;
+  DeviceAddress roms[WS_MAX_DALLAS_SENSORS];
+  byte resolution;
+  bool probed;
+  bool converting;
+  uint16_t conversionTime;
+  unsigned long requestedAt;
+  unsigned long cycle;
+} DallasBus;
+
+Pool<OneWire, WS_MAX_DALLAS_BUSES> oneWirePool;
+Pool<DallasTemperature, WS_MAX_DALLAS_BUSES> dallasPool;
+DallasBus dallasBuses[WS_MAX_DALLAS_BUSES];
+byte dallasBusesCount = 0;
+byte dallasDeviceBus[WS_MAX_DEVICES];
+unsigned long dallasDeviceCycle[WS_MAX_DEVICES];
+
+DallasBus *dallasBusFind(int pin)
+{
+  for (byte i = 0; i < dallasBusesCount; i++)
   {
-    bool changed = false;
-    String value1 = devicesValues[dev->deviceId].values[0];
-    if (b->read() == HIGH && value1 == "off")
+    if (dallasBuses[i].pin == pin)
     {
-      value1 = "on";
-      changed = true;
+      return &dallasBuses[i];
     }
-    else if (b->read() == LOW && value1 == "on")
+  }
+  return NULL;
+}
+
+void dallasBusEnumerate(DallasBus *bus)
+{
+  bus->sensors->begin();
+  bus->probed = true;
+  bus->count = 0;
+  byte found = bus->sensors->getDeviceCount();
+  for (byte i = 0; i < found && bus->count < WS_MAX_DALLAS_SENSORS; i++)
+  {
+    if (bus->sensors->getAddress(bus->roms[bus->count], i))
     {
-      value1 = "off";
-      changed = true;
+      bus->count++;
     }
+  }
+}
 
-    if (changed)
-    {
-      devicesValues[dev->deviceId].values[0] = value1;
+void dallasBusSetResolution(DallasBus *bus, byte resolution)
+{
+  if (resolution < 9 || resolution > 12)
+  {
+    resolution = 12;
+  }
+  bus->resolution = resolution;
+  bus->conversionTime = bus->sensors->millisToWaitForConversion(resolution);
+  if (bus->probed)
+  {
+    bus->sensors->setResolution(resolution);
+  }
+}
 
-      if (dev->pushCallback.set)
-      {
-        String path;
-        WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, value1, path, devicesValues[dev->deviceId].names[0]);
-        return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
-      }
+// bus enumeration is deferred from setup to first poll, so boot does not wait for OneWire searches
+void dallasBusProbe(DallasBus *bus)
+{
+  dallasBusEnumerate(bus);
+  bus->sensors->setResolution(bus->resolution);
+}
+
+void dallasBusRequest(DallasBus *bus)
+{
+  // broadcast (skip ROM) conversion for every sensor on the bus
+  bus->sensors->requestTemperatures();
+  bus->requestedAt = millis();
+  bus->converting = true;
+}
+
+void dallasBusUpdate(DallasBus *bus)
+{
+  if (bus->converting && (millis() - bus->requestedAt) >= bus->conversionTime)
+  {
+    bus->converting = false;
+    bus->cycle++;
+  }
+}
+
+bool dallasRomSet(const byte *rom)
+{
+  for (byte i = 0; i < WS_DEVICE_CONFIG_ROM_BYTES; i++)
+  {
+    if (rom[i] != 0x0)
+    {
+      return true;
     }
   }
-  return 0;
+  return false;
 }
 
-byte readSwitch(Device *dev, ServerStats *stats)
+// bound sensor, unbound device falls back only to the single sensor of its bus
+const uint8_t *dallasDeviceRom(Device *dev, DallasBus *bus)
 {
-  Bounce *b = debouncers[dev->deviceId];
-  if (b->update())
+  if (dallasRomSet(dev->config.rom))
+  {
+    return dev->config.rom;
+  }
+  return bus->count == 1 ? bus->roms[0] : NULL;
+}
+
+bool configureTempDallas(Form *config, Device *dev)
+{
+  dev->config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ] = 0.0;
+  dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ] = formFloat(*config, FORM_KEY("temp_adj"), dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ]);
+
+  memset(dev->config.rom, 0, sizeof(dev->config.rom));
+  const char *rom = formGet(*config, FORM_KEY("rom"));
+  if (rom != NULL && rom[0] != '\0' && !romFromStr(rom, dev->config.rom, WS_DEVICE_CONFIG_ROM_BYTES))
+  {
+    return false;
+  }
+
+  dev->config.bytes[DEVICE_CONFIG_BYTES_RESOLUTION] = (byte)formInt(*config, FORM_KEY("resolution"), 12);
+
+  DallasBus *bus = dallasBusFind(dev->pins[0].pin);
+  if (bus != NULL && bus->probed && bus->count > 1 && !dallasRomSet(dev->config.rom))
+  {
+    // sensor order of enumeration is not stable, device must name its sensor
+    return false;
+  }
+  if (bus != NULL)
+  {
+    dallasBusSetResolution(bus, dev->config.bytes[DEVICE_CONFIG_BYTES_RESOLUTION]);
+  }
+  return true;
+}
+
+byte readTempDallas(Device *dev, ServerStats *stats, bool &push)
+{
+  if (dallasDeviceBus[dev->deviceId] >= dallasBusesCount)
+  {
+    return 1;
+  }
+  DallasBus *bus = &dallasBuses[dallasDeviceBus[dev->deviceId]];
+  if (!bus->probed)
   {
-    String value1 = b->read() == LOW ? "on" : "off";
-    devicesValues[dev->deviceId].values[0] = value1;
+    dallasBusProbe(bus);
+  }
 
-    if (dev->pushCallback.set)
+  dallasBusUpdate(bus);
+  if (dallasDeviceCycle[dev->deviceId] == bus->cycle)
+  {
+    // nothing new since last read, start conversion for whole bus and come back when it is ready
+    if (!bus->converting)
     {
-      String path;
-      WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, value1, path, devicesValues[dev->deviceId].names[0]);
-      return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
+      dallasBusRequest(bus);
     }
+    schedulerAdd(pollScheduler, dev->deviceId, bus->requestedAt + bus->conversionTime);
+    return 0;
+  }
+  dallasDeviceCycle[dev->deviceId] = bus->cycle;
+
+  const uint8_t *rom = dallasDeviceRom(dev, bus);
+  if (rom == NULL && bus->count > 1)
+  {
+    WifiSensorsUtils::setWarning(*stats, F("WARN: TEMP_DALLAS needs rom on shared bus, device: "), dev->deviceId);
+    return 1;
+  }
+  float tempC = rom != NULL ? bus->sensors->getTempC(rom) : DEVICE_DISCONNECTED_C;
+  if (tempC != DEVICE_DISCONNECTED_C && tempC != -127.00 && tempC != 85.00)
+  {
+    float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
+    DeviceValue &value = devicesValues[dev->deviceId].values[0];
+    valueSetNumber(value, WifiSensorsUtils::adjustPercent(tempC, adj));
+    deviceRecordValue(dev, stats, 0, valueToFloat(value));
+    push = true;
+  }
+  else
+  {
+    WifiSensorsUtils::setWarning(*stats, F("WARN: Could not read TEMP for device: "), dev->deviceId);
+    Serial.print(F("WARN: Could not read TEMP for device: "));
+    Serial.println(dev->deviceId);
+    return 1;
   }
   return 0;
 }
 
-byte readTempDallas(Device *dev, ServerStats *stats)
+void releaseTempDallas(byte deviceId)
 {
-  DallasTemperature *tempSensor = dallasTemp[dev->deviceId];
-
-  if (dallasConversionTime[dev->deviceId] == 0)
+  byte busId = dallasDeviceBus[deviceId];
+  dallasDeviceBus[deviceId] = WS_MAX_DALLAS_BUSES;
+  if (busId >= dallasBusesCount)
   {
-    tempSensor->requestTemperatures();
-    dallasConversionTime[dev->deviceId] = tempSensor->millisToWaitForConversion(tempSensor->getResolution());
+    return;
   }
-
-  if ((millis() - dallasLastTempMeasurement[dev->deviceId]) > dallasConversionTime[dev->deviceId])
+  for (byte i = 0; i < WS_MAX_DEVICES; i++)
   {
-    dallasConversionTime[dev->deviceId] = 0;
-    dallasLastTempMeasurement[dev->deviceId] = millis();
+    if (dallasDeviceBus[i] == busId)
+    {
+      // other sensors still on this bus
+      return;
+    }
+  }
+
+  DallasBus *bus = &dallasBuses[busId];
+  poolDelete(dallasPool, bus->sensors);
+  poolDelete(oneWirePool, bus->oneWire);
 
-    float tempC = tempSensor->getTempC(dallasDeviceAddress[dev->deviceId]);
-    if (tempC != DEVICE_DISCONNECTED_C && tempC != -127.00 && tempC != 85.00)
+  // keep buses dense, move last bus into freed place
+  dallasBusesCount--;
+  if (busId != dallasBusesCount)
+  {
+    dallasBuses[busId] = dallasBuses[dallasBusesCount];
+    for (byte i = 0; i < WS_MAX_DEVICES; i++)
     {
-      float adj = dev->config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
-      String temp = String(WifiSensorsUtils::adjustPercent(tempC, adj), 1);
-      devicesValues[dev->deviceId].values[0] = temp;
-      if (dev->pushCallback.set)
+      if (dallasDeviceBus[i] == dallasBusesCount)
       {
-        String path;
-        WifiSensorsUtils::prepareCallbackValues(dev->pushCallback.path, temp, path, devicesValues[dev->deviceId].names[0]);
-        return WifiSensorsUtils::sendHttpRequest(dev->pushCallback, path);
+        dallasDeviceBus[i] = busId;
       }
     }
-    else
-    {
-      stats->lastWarning = "WARN: Could not read TEMP for device: " + dev->deviceId;
-      stats->lastWarning += " ";
-      stats->lastWarning += timeNow(*stats);
-      Serial.print(F("WARN: Could not read TEMP for device: "));
-      Serial.println(dev->deviceId);
-      return 1;
-    }
   }
-  return 0;
 }
 
-void setupButton(Device *dev)
+void sendDallasBuses()
 {
-  Bounce *button = new Bounce();
-  if (dev->pins[0].type == 'D')
+  char romStr[WS_DEVICE_CONFIG_ROM_BYTES * 2 + 1];
+  wifiClient.print("{\"buses\":[");
+  for (byte i = 0; i < dallasBusesCount; i++)
   {
-    button->attach(dev->pins[0].pin);
+    DallasBus *bus = &dallasBuses[i];
+    if (!bus->probed)
+    {
+      dallasBusProbe(bus);
+    }
+    else if (!bus->converting)
+    {
+      dallasBusEnumerate(bus);
+    }
+
+    if (i > 0)
+    {
+      wifiClient.print(",");
+    }
+    wifiClient.print("{\"pin\":\"D");
+    wifiClient.print(bus->pin);
+    wifiClient.print("\",\"resolution\":");
+    wifiClient.print(bus->resolution);
+    wifiClient.print(",\"conversion\":");
+    wifiClient.print(bus->conversionTime);
+    wifiClient.print(",\"roms\":[");
+    for (byte j = 0; j < bus->count; j++)
+    {
+      if (j > 0)
+      {
+        wifiClient.print(",");
+      }
+      romToStr(bus->roms[j], WS_DEVICE_CONFIG_ROM_BYTES, romStr);
+      wifiClient.print("\"");
+      wifiClient.print(romStr);
+      wifiClient.print("\"");
+    }
+    wifiClient.print("]}");
   }
-  else
+  wifiClient.println("]}");
+}
+
+void setupTempDallas(Device *dev)
+{
+  DallasBus *bus = dallasBusFind(dev->pins[0].pin);
+  if (bus == NULL)
   {
-    deviceButtonAttachAnalogPin(button, dev->pins[0].pin);
+    if (dallasBusesCount == WS_MAX_DALLAS_BUSES)
+    {
+      Serial.println(F("WARN: No free OneWire bus!"));
+      dallasDeviceBus[dev->deviceId] = WS_MAX_DALLAS_BUSES;
+      return;
+    }
+    bus = &dallasBuses[dallasBusesCount];
+    bus->pin = dev->pins[0].pin;
+    bus->oneWire = poolNew(oneWirePool, bus->pin);
+    bus->sensors = poolNew(dallasPool, bus->oneWire);
+    bus->probed = false;
+    bus->converting = false;
+    bus->cycle = 0;
+    bus->count = 0;
+    bus->sensors->setWaitForConversion(false);
+    dallasBusesCount++;
   }
+  dallasBusSetResolution(bus, dev->config.bytes[DEVICE_CONFIG_BYTES_RESOLUTION]);
 
-  button->interval(dev->config.ints[DEVICE_CONFIG_INTS_DEBOUNCE]);
-  debouncers[dev->deviceId] = button;
+  dallasDeviceBus[dev->deviceId] = bus - dallasBuses;
+  dallasDeviceCycle[dev->deviceId] = bus->cycle;
 
-  devicesValues[dev->deviceId].values[0] = "off";
+  valueSetNumber(devicesValues[dev->deviceId].values[0], 0.0f);
 }
 
-void setupDHT22(Device *dev)
+struct TempDallasDriver : DeviceDriverBase
 {
-  DHT_Unified *dht = new DHT_Unified(dev->pins[0].pin, DHT22);
-  dht22s[dev->deviceId] = dht;
-  dht->begin();
+  static const DeviceType type = DEVICE_TEMP_DALLAS;
+  static constexpr const char *name = "TEMP_DALLAS";
+  static const bool sharedPins = true;
 
-  sensor_t sensor;
-  dht->temperature().getSensor(&sensor);
-  String msg = String("DHT22 TEMP: ") + String(sensor.name) + String(" ") + String(sensor.version);
-  Serial.println(msg);
-  dht->humidity().getSensor(&sensor);
-  msg = String("DHT22 HUMID: ") + String(sensor.name) + String(" ") + String(sensor.version);
-  Serial.println(msg);
-  int32_t readDealay = (sensor.min_delay / 1000);
-  msg = String("DHT22 DELAY: ") + String(readDealay);
-  Serial.println(msg);
-  msg = String("DHT22 RESOLUTION: ") + String(sensor.resolution);
-  Serial.println(msg);
+  static byte values(byte deviceId)
+  {
+    return deviceValue(deviceId, 0, "temp", "C", VALUE_NUMBER, 1);
+  }
 
-  devicesValues[dev->deviceId].values[0] = "0.0";
-  devicesValues[dev->deviceId].values[1] = "0.0";
+  static bool configure(Form *config, Device *dev)
+  {
+    return configureTempDallas(config, dev);
+  }
 
-  if (readDealay > dev->pollInterval)
+  static void setup(Device *dev)
   {
-    dev->pollInterval = readDealay;
+    setupTempDallas(dev);
   }
-}
 
-void setupGeneric(Device *dev)
-{
-  if (dev->type == DEVICE_GENERIC_DIGITAL_INPUT)
+  static byte poll(Device *dev, ServerStats *stats, bool &push)
   {
-    devicesValues[dev->deviceId].values[0] = "0";
+    return readTempDallas(dev, stats, push);
   }
-  else
+
+  static void configToString(Device &dev, Print &out)
   {
-    devicesValues[dev->deviceId].values[0] = "0.0";
+    char romStr[WS_DEVICE_CONFIG_ROM_BYTES * 2 + 1];
+    romToStr(dev.config.rom, WS_DEVICE_CONFIG_ROM_BYTES, romStr);
+    out.print("\"temp_adj\":");
+    out.print(dev.config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ]);
+    out.print(",\"resolution\":");
+    out.print(dev.config.bytes[DEVICE_CONFIG_BYTES_RESOLUTION]);
+    out.print(",\"rom\":\"");
+    out.print(romStr);
+    out.print("\"");
   }
-}
 
-void setupRelay(Device *dev)
-{
-  devicesValues[dev->deviceId].values[0] = "off";
-  if (dev->config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x1)
+  static void init(ServerStats *stats)
   {
-    WifiSensorsUtils::setPinValue(dev->pins[0].type, dev->pins[0].pin, LOW);
+    if (dallasPool.stats.name == NULL)
+    {
+      poolInit(oneWirePool, "onewire");
+      poolInit(dallasPool, "dallas");
+    }
+    // buses of previous setup, devices are set up again after init
+    for (byte i = 0; i < dallasBusesCount; i++)
+    {
+      poolDelete(dallasPool, dallasBuses[i].sensors);
+      poolDelete(oneWirePool, dallasBuses[i].oneWire);
+    }
+    dallasBusesCount = 0;
+    devicePoolRegister(stats, &oneWirePool.stats);
+    devicePoolRegister(stats, &dallasPool.stats);
+    for (byte i = 0; i < WS_MAX_DEVICES; i++)
+    {
+      dallasDeviceBus[i] = WS_MAX_DALLAS_BUSES;
+    }
   }
-  else
+
+  static void release(byte deviceId)
   {
-    WifiSensorsUtils::setPinValue(dev->pins[0].type, dev->pins[0].pin, HIGH);
+    releaseTempDallas(deviceId);
   }
-}
+};
+#endif
 
-void setupTempDallas(Device *dev)
-{
-  OneWire *oneWire = new OneWire(dev->pins[0].pin);
-  DallasTemperature *tempSensor = new DallasTemperature(oneWire);
-  dallasTemp[dev->deviceId] = tempSensor;
+typedef DriverList<
+#if WS_DRIVER_BUTTON
+    ButtonDriver,
+#endif
+#if WS_DRIVER_DHT22
+    DHT22Driver,
+#endif
+#if WS_DRIVER_GENERIC_ANALOG
+    GenericAnalogDriver,
+#endif
+#if WS_DRIVER_GENERIC_DIGITAL
+    GenericDigitalDriver,
+#endif
+#if WS_DRIVER_MOTION
+    MotionDriver,
+#endif
+#if WS_DRIVER_RELAY
+    RelayDriver,
+#endif
+#if WS_DRIVER_SWITCH
+    SwitchDriver,
+#endif
+#if WS_DRIVER_TEMP_DALLAS
+    TempDallasDriver,
+#endif
+    void>
+    Drivers;
 
-  tempSensor->begin();
+const DeviceDriver *deviceDriver(DeviceType type)
+{
+  if (type >= DEVICE_UNKNOWN)
+  {
+    return NULL;
+  }
+  return DriverTable<Drivers>::byType[type];
+}
 
-  tempSensor->setWaitForConversion(false);
-  tempSensor->getAddress(dallasDeviceAddress[dev->deviceId], 0);
+DeviceType deviceTypeFromStr(String &type)
+{
+  for (byte i = 0; i < DEVICE_UNKNOWN; i++)
+  {
+    const DeviceDriver *driver = DriverTable<Drivers>::byType[i];
+    if (driver != NULL && type == driver->name)
+    {
+      return driver->type;
+    }
+  }
+  return DEVICE_UNKNOWN;
+}
 
-  devicesValues[dev->deviceId].values[0] = "0.0";
+const char *deviceTypetoStr(DeviceType type)
+{
+  const DeviceDriver *driver = deviceDriver(type);
+  if (driver == NULL)
+  {
+    return "UNKNOWN";
+  }
+  return driver->name;
 }
 
 #endif
@@ -0,0 +1,150 @@
+#ifndef WIFISENSORS_DRIVERS_H
+#define WIFISENSORS_DRIVERS_H
+
+/*
+Device drivers registry.
+Driver is a struct with static members (see DeviceDriverBase for defaults):
+* type, name, pins, output, sharedPins
+* values(deviceId) - set values names, units and kinds, returns values count
+* configure(config, dev), setup(dev), poll(dev, stats, push) - read device, set push when values should be sent to callback, configToString(dev, out)
+* init(stats) - once at boot, release(deviceId) - return pooled state of device (called for every driver, must ignore foreign devices)
+Registry table is built at compile time from DriverList<...> (see WifiSensorsDevices.h) and indexed by DeviceType.
+Drivers can be left out of build with WS_DRIVER_[NAME] 0.
+*/
+
+#include "WifiSensorsForm.h"
+#include "WifiSensorsTypes.h"
+
+#ifndef WS_DRIVER_BUTTON
+#define WS_DRIVER_BUTTON 1
+#endif
+#ifndef WS_DRIVER_DHT22
+#define WS_DRIVER_DHT22 1
+#endif
+#ifndef WS_DRIVER_GENERIC_ANALOG
+#define WS_DRIVER_GENERIC_ANALOG 1
+#endif
+#ifndef WS_DRIVER_GENERIC_DIGITAL
+#define WS_DRIVER_GENERIC_DIGITAL 1
+#endif
+#ifndef WS_DRIVER_MOTION
+#define WS_DRIVER_MOTION 1
+#endif
+#ifndef WS_DRIVER_RELAY
+#define WS_DRIVER_RELAY 1
+#endif
+#ifndef WS_DRIVER_SWITCH
+#define WS_DRIVER_SWITCH 1
+#endif
+#ifndef WS_DRIVER_TEMP_DALLAS
+#define WS_DRIVER_TEMP_DALLAS 1
+#endif
+
+typedef struct
+{
+  DeviceType type;
+  const char *name;
+  byte pins;
+  bool output;
+  bool sharedPins;
+  byte (*values)(byte deviceId);
+  bool (*configure)(Form *config, Device *dev);
+  void (*setup)(Device *dev);
+  byte (*poll)(Device *dev, ServerStats *stats, bool &push);
+  void (*configToString)(Device &dev, Print &out);
+  void (*init)(ServerStats *stats);
+  void (*release)(byte deviceId);
+} DeviceDriver;
+
+struct DeviceDriverBase
+{
+  static const byte pins = 1;
+  static const bool output = false;
+  static const bool sharedPins = false;
+
+  static bool configure(Form *, Device *)
+  {
+    return true;
+  }
+
+  static byte poll(Device *, ServerStats *, bool &)
+  {
+    return 0;
+  }
+
+  static void configToString(Device &, Print &)
+  {
+  }
+
+  static void init(ServerStats *)
+  {
+  }
+
+  static void release(byte)
+  {
+  }
+};
+
+template <typename D>
+struct DriverEntry
+{
+  static const DeviceDriver driver;
+};
+
+template <typename D>
+const DeviceDriver DriverEntry<D>::driver = {D::type, D::name, D::pins, D::output, D::sharedPins, &D::values, &D::configure, &D::setup, &D::poll, &D::configToString, &D::init, &D::release};
+
+// list of drivers, last element must be void
+template <typename D, typename... Ds>
+struct DriverList
+{
+  static constexpr const DeviceDriver *find(DeviceType type)
+  {
+    return D::type == type ? &DriverEntry<D>::driver : DriverList<Ds...>::find(type);
+  }
+};
+
+template <>
+struct DriverList<void>
+{
+  static constexpr const DeviceDriver *find(DeviceType)
+  {
+    return NULL;
+  }
+};
+
+template <byte... I>
+struct DriverIndexes
+{
+};
+
+template <byte N, byte... I>
+struct DriverIndexesMake : DriverIndexesMake<N - 1, N - 1, I...>
+{
+};
+
+template <byte... I>
+struct DriverIndexesMake<0, I...>
+{
+  typedef DriverIndexes<I...> type;
+};
+
+template <typename List, typename Indexes = typename DriverIndexesMake<DEVICE_UNKNOWN>::type>
+struct DriverTable;
+
+template <typename List, byte... I>
+struct DriverTable<List, DriverIndexes<I...> >
+{
+  static const DeviceDriver *const byType[sizeof...(I)];
+};
+
+template <typename List, byte... I>
+const DeviceDriver *const DriverTable<List, DriverIndexes<I...> >::byType[sizeof...(I)] = {List::find(static_cast<DeviceType>(I))...};
+
+const DeviceDriver *deviceDriver(DeviceType type);
+
+DeviceType deviceTypeFromStr(String &type);
+
+const char *deviceTypetoStr(DeviceType type);
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef WIFISENSORS_EVENTS_H
+#define WIFISENSORS_EVENTS_H
+
+/*
+Server-Sent Events (GET /events), one "value" event per value change, event id is the value change cursor (epoch:seq).
+Subscriber keeps only cursor (last sent sequence), pending events are values changed after it sent in sequence order,
+so value changed again before it was sent is sent once with its latest state. Each loop at most WS_EVENT_BUFFER bytes of events
+are written to a subscriber in one write, rest waits for next loop. Resume with Last-Event-ID starts after that cursor.
+Subscriber which does not accept data or disconnects is dropped, idle stream gets comment every WS_EVENT_KEEPALIVE ms.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#include <WiFiNINA.h>
+
+#ifndef WS_EVENT_SUBSCRIBERS
+#define WS_EVENT_SUBSCRIBERS 2
+#endif
+#ifndef WS_EVENT_BUFFER
+#define WS_EVENT_BUFFER 512
+#endif
+#ifndef WS_EVENT_MAX_LEN
+#define WS_EVENT_MAX_LEN 192
+#endif
+#ifndef WS_EVENT_KEEPALIVE
+#define WS_EVENT_KEEPALIVE 15000UL
+#endif
+
+typedef struct
+{
+  bool active;
+  WiFiClient client;
+  // sequence of last sent change
+  uint32_t seq;
+  unsigned long lastWrite;
+} EventSubscriber;
+
+typedef struct
+{
+  byte subscribers;
+  unsigned long sent;
+  unsigned long dropped;
+  EventSubscriber subscriber[WS_EVENT_SUBSCRIBERS];
+} EventStream;
+
+// false when all subscriber slots are taken
+inline bool eventsSubscribe(EventStream &events, WiFiClient &client, uint32_t seq)
+{
+  for (byte i = 0; i < WS_EVENT_SUBSCRIBERS; i++)
+  {
+    EventSubscriber &subscriber = events.subscriber[i];
+    if (!subscriber.active)
+    {
+      subscriber.active = true;
+      subscriber.client = client;
+      subscriber.seq = seq;
+      subscriber.lastWrite = millis();
+      events.subscribers++;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void eventsDrop(EventStream &events, EventSubscriber &subscriber)
+{
+  subscriber.client.stop();
+  subscriber.active = false;
+  events.subscribers--;
+  events.dropped++;
+}
+
+// finds value with lowest change sequence after seq
+inline bool eventsNext(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, uint32_t seq, byte &device, byte &value)
+{
+  bool found = false;
+  uint32_t next = 0;
+  for (byte i = 0; i < devices.count; i++)
+  {
+    DevicesValues &values = devicesValues[devices.devices[i].deviceId];
+    for (byte j = 0; j < devices.devices[i].valuesCount; j++)
+    {
+      uint32_t valueSeq = values.values[j].seq;
+      if (valueChanged(values.values[j], seq) && (!found || valueSeqAfter(next, valueSeq)))
+      {
+        found = true;
+        next = valueSeq;
+        device = i;
+        value = j;
+      }
+    }
+  }
+  return found;
+}
+
+inline void eventsFormat(Print &out, Device &dev, DevicesValues &values, byte value, unsigned long time)
+{
+  char valueStr[WS_VALUE_STR_LEN];
+  char cursor[WS_VALUE_CURSOR_LEN];
+  valueToStr(values.values[value], valueStr);
+  valueCursor(values.values[value].seq, cursor);
+  out.print("id: ");
+  out.print(cursor);
+  out.print("\nevent: value\ndata: {\"id\":\"");
+  out.print(dev.deviceId);
+  out.print("\",\"name\":\"");
+  out.print(values.names[value]);
+  out.print("\",\"value\":\"");
+  out.print(valueStr);
+  out.print("\",\"time\":");
+  out.print(time);
+  out.print(",\"seq\":\"");
+  out.print(cursor);
+  out.print("\"}\n\n");
+}
+
+// writes pending events of every subscriber, time is unix time put in events
+inline void eventsPump(EventStream &events, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, unsigned long time)
+{
+  unsigned long now = millis();
+  for (byte i = 0; i < WS_EVENT_SUBSCRIBERS; i++)
+  {
+    EventSubscriber &subscriber = events.subscriber[i];
+    if (!subscriber.active)
+    {
+      continue;
+    }
+    if (!subscriber.client.connected())
+    {
+      eventsDrop(events, subscriber);
+      continue;
+    }
+
+    FixedString<WS_EVENT_BUFFER> buffer;
+    uint32_t seq = subscriber.seq;
+    unsigned long sent = 0;
+    byte device, value;
+    while (eventsNext(devices, devicesValues, seq, device, value))
+    {
+      FixedString<WS_EVENT_MAX_LEN> event;
+      DevicesValues &values = devicesValues[devices.devices[device].deviceId];
+      eventsFormat(event, devices.devices[device], values, value, time);
+      if (buffer.length() + event.length() > buffer.capacity())
+      {
+        break;
+      }
+      buffer.print(event.c_str());
+      seq = values.values[value].seq;
+      sent++;
+    }
+
+    if (buffer.length() == 0)
+    {
+      if (now - subscriber.lastWrite < WS_EVENT_KEEPALIVE)
+      {
+        continue;
+      }
+      buffer.print(":\n\n");
+    }
+
+    if (subscriber.client.write((const uint8_t *)buffer.c_str(), buffer.length()) != buffer.length())
+    {
+      eventsDrop(events, subscriber);
+      continue;
+    }
+    subscriber.seq = seq;
+    subscriber.lastWrite = now;
+    events.sent += sent;
+  }
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef WIFISENSORS_FORM_H
+#define WIFISENSORS_FORM_H
+
+/*
+Config form parser (application/x-www-form-urlencoded payload).
+formParse walks payload once, url-decodes keys and values in place and keeps (key hash, value) pairs,
+values point into payload buffer, so payload must outlive the form. Nothing is allocated.
+Keys are matched by 32-bit FNV-1a hash, FORM_KEY("name") is evaluated at compile time.
+*/
+
+#include "WifiSensorsTypes.h"
+#include "parsers.h"
+
+#ifndef WS_FORM_MAX_FIELDS
+#define WS_FORM_MAX_FIELDS 16
+#endif
+
+#define WS_FORM_FNV_OFFSET 2166136261UL
+#define WS_FORM_FNV_PRIME 16777619UL
+
+constexpr uint32_t formHash(const char *key, uint32_t hash = WS_FORM_FNV_OFFSET)
+{
+  return *key == '\0' ? hash : formHash(key + 1, (uint32_t)((hash ^ (byte)*key) * WS_FORM_FNV_PRIME));
+}
+
+template <uint32_t H>
+struct FormKey
+{
+  static const uint32_t value = H;
+};
+
+#define FORM_KEY(name) (FormKey<formHash(name)>::value)
+
+typedef struct
+{
+  uint32_t key;
+  const char *value;
+} FormField;
+
+typedef struct
+{
+  byte count;
+  FormField fields[WS_FORM_MAX_FIELDS];
+} Form;
+
+// same as formHash, without recursion for keys from requests
+inline uint32_t formHashStr(const char *key)
+{
+  uint32_t hash = WS_FORM_FNV_OFFSET;
+  for (; *key != '\0'; key++)
+  {
+    hash = (uint32_t)((hash ^ (byte)*key) * WS_FORM_FNV_PRIME);
+  }
+  return hash;
+}
+
+inline void formInit(Form &form)
+{
+  form.count = 0;
+}
+
+inline bool formAdd(Form &form, uint32_t key, const char *value)
+{
+  if (form.count == WS_FORM_MAX_FIELDS)
+  {
+    return false;
+  }
+  form.fields[form.count].key = key;
+  form.fields[form.count].value = value;
+  form.count++;
+  return true;
+}
+
+// returns NULL when key is missing, last value wins for repeated keys
+inline const char *formGet(const Form &form, uint32_t key)
+{
+  for (byte i = form.count; i > 0; i--)
+  {
+    if (form.fields[i - 1].key == key)
+    {
+      return form.fields[i - 1].value;
+    }
+  }
+  return NULL;
+}
+
+inline bool formHas(const Form &form, uint32_t key)
+{
+  return formGet(form, key) != NULL;
+}
+
+inline long formInt(const Form &form, uint32_t key, long def)
+{
+  const char *value = formGet(form, key);
+  return value != NULL ? atol(value) : def;
+}
+
+inline float formFloat(const Form &form, uint32_t key, float def)
+{
+  const char *value = formGet(form, key);
+  return value != NULL ? (float)atof(value) : def;
+}
+
+inline bool formEquals(const Form &form, uint32_t key, const char *expected)
+{
+  const char *value = formGet(form, key);
+  return value != NULL && strcmp(value, expected) == 0;
+}
+
+// url-decodes NUL terminated str in place, '+' is space
+inline char *formDecode(char *str)
+{
+  char *out = str;
+  for (char *in = str; *in != '\0'; in++, out++)
+  {
+    int c1, c0;
+    if (*in == '+')
+    {
+      *out = ' ';
+    }
+    else if (*in == '%' && (c1 = hex2dec(in[1])) >= 0 && (c0 = hex2dec(in[2])) >= 0)
+    {
+      *out = (char)(c1 * 16 + c0);
+      in += 2;
+    }
+    else
+    {
+      *out = *in;
+    }
+  }
+  *out = '\0';
+  return str;
+}
+
+// splits payload on '&' and '=' in place, fields without '=' are skipped
+inline void formParse(Form &form, char *payload)
+{
+  formInit(form);
+  char *field = payload;
+  while (field != NULL && *field != '\0')
+  {
+    char *next = strchr(field, '&');
+    if (next != NULL)
+    {
+      *next++ = '\0';
+    }
+    char *value = strchr(field, '=');
+    if (value != NULL)
+    {
+      *value++ = '\0';
+      if (!formAdd(form, formHashStr(formDecode(field)), formDecode(value)))
+      {
+        return;
+      }
+    }
+    field = next;
+  }
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef WIFISENSORS_HISTORY_H
+#define WIFISENSORS_HISTORY_H
+
+/*
+Per value history in fixed size rings (sizes WS_HISTORY_RAW, WS_HISTORY_1M, WS_HISTORY_15M).
+Raw ring keeps timestamped samples, every sample is also consolidated into 1 min and 15 min averages.
+Consolidated slots have implicit time (bucket start), empty buckets are stored as NAN.
+Bucket in progress is not in the ring yet, it is read as the newest entry of a tier and flagged as partial.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#define WS_HISTORY_RES_RAW 0
+#define WS_HISTORY_RES_1M 60
+#define WS_HISTORY_RES_15M 900
+
+template <byte N>
+inline void historyTierReset(HistoryTier<N> &tier)
+{
+  tier.start = 0;
+  tier.sum = 0.0f;
+  tier.count = 0;
+  tier.head = 0;
+  tier.size = 0;
+}
+
+template <byte N>
+inline void historyTierPush(HistoryTier<N> &tier, float value)
+{
+  tier.values[tier.head] = value;
+  tier.head = (tier.head + 1) % N;
+  if (tier.size < N)
+  {
+    tier.size++;
+  }
+}
+
+template <byte N>
+inline void historyTierAdd(HistoryTier<N> &tier, unsigned long step, float value, unsigned long time)
+{
+  unsigned long bucket = time - time % step;
+  if (tier.count == 0 && tier.size == 0)
+  {
+    tier.start = bucket;
+  }
+
+  if (bucket > tier.start)
+  {
+    historyTierPush(tier, tier.count > 0 ? tier.sum / tier.count : NAN);
+    // fill buckets without samples, no more than ring size
+    unsigned long missing = (bucket - tier.start) / step - 1;
+    for (unsigned long i = 0; i < missing && i < N; i++)
+    {
+      historyTierPush(tier, NAN);
+    }
+    tier.start = bucket;
+    tier.sum = 0.0f;
+    tier.count = 0;
+  }
+
+  tier.sum += value;
+  tier.count++;
+}
+
+template <byte N>
+inline float historyTierGet(HistoryTier<N> &tier, byte age, unsigned long step, unsigned long &time)
+{
+  // age 0 is the oldest slot
+  byte idx = (tier.head + N - tier.size + age) % N;
+  time = tier.start - (tier.size - age) * step;
+  return tier.values[idx];
+}
+
+inline void historyReset(ValueHistory &history)
+{
+  history.head = 0;
+  history.size = 0;
+  historyTierReset(history.minutes);
+  historyTierReset(history.quarters);
+}
+
+inline void historyAdd(ValueHistory &history, float value, unsigned long time)
+{
+  history.raw[history.head].time = time;
+  history.raw[history.head].value = value;
+  history.head = (history.head + 1) % WS_HISTORY_RAW;
+  if (history.size < WS_HISTORY_RAW)
+  {
+    history.size++;
+  }
+
+  historyTierAdd(history.minutes, WS_HISTORY_RES_1M, value, time);
+  historyTierAdd(history.quarters, WS_HISTORY_RES_15M, value, time);
+}
+
+inline HistorySample &historyRawGet(ValueHistory &history, byte age)
+{
+  return history.raw[(history.head + WS_HISTORY_RAW - history.size + age) % WS_HISTORY_RAW];
+}
+
+inline bool historyResValid(int res)
+{
+  return res == WS_HISTORY_RES_RAW || res == WS_HISTORY_RES_1M || res == WS_HISTORY_RES_15M;
+}
+
+template <byte N>
+inline bool historyTierEntry(HistoryTier<N> &tier, byte age, unsigned long step, unsigned long &time, float &value, bool &partial)
+{
+  partial = age == tier.size;
+  if (partial)
+  {
+    time = tier.start;
+    value = tier.sum / tier.count;
+    return tier.count > 0;
+  }
+  value = historyTierGet(tier, age, step, time);
+  return age < tier.size;
+}
+
+// entry of age (0 is the oldest) in res tier, false past the newest one
+inline bool historyEntry(ValueHistory &history, int res, byte age, unsigned long &time, float &value, bool &partial)
+{
+  if (res == WS_HISTORY_RES_15M)
+  {
+    return historyTierEntry(history.quarters, age, WS_HISTORY_RES_15M, time, value, partial);
+  }
+  if (res == WS_HISTORY_RES_1M)
+  {
+    return historyTierEntry(history.minutes, age, WS_HISTORY_RES_1M, time, value, partial);
+  }
+  partial = false;
+  if (age >= history.size)
+  {
+    return false;
+  }
+  HistorySample &sample = historyRawGet(history, age);
+  time = sample.time;
+  value = sample.value;
+  return true;
+}
+
+#endif
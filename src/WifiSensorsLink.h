@@ -0,0 +1,216 @@
+#ifndef WIFISENSORS_LINK_H
+#define WIFISENSORS_LINK_H
+
+/*
+WiFi link monitor, keeps NINA status, SSID, BSSID, IP and RSSI cached in LinkInfo.
+Status is sampled every WS_LINK_CHECK_INTERVAL ms and RSSI every WS_LINK_RSSI_INTERVAL ms, so loop does not pay SPI round trips on every pass.
+linkPoll returns state change events; link is reported down after lost status was seen for WS_LINK_LOST_TIMEOUT ms.
+
+Reconnect does not block: linkBegin starts association (WiFi timeout 0, WS_WIFI_TIMEOUT restored after, NINA has no getter)
+and linkReconnect re-issues it with exponential backoff (WS_LINK_RECONNECT_MIN .. WS_LINK_RECONNECT_MAX ms)
+while the down link is polled every WS_LINK_DOWN_CHECK_INTERVAL ms.
+First attempt reuses static IP from config or last DHCP lease of the same SSID (WS_LINK_REUSE_LEASE), so DHCP is skipped,
+later attempts fall back to DHCP. Reused lease is not renewed by anyone, so WS_LINK_LEASE_RENEW ms after link came up on it
+linkRenewLease re-associates with DHCP (a short planned outage) and address is never reused twice in a row.
+NINA cannot join a given BSSID/channel, BSSID of last association is only reported.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#include <WiFiNINA.h>
+
+inline bool linkStatusLost(byte status)
+{
+  return status == WL_CONNECT_FAILED || status == WL_CONNECTION_LOST || status == WL_DISCONNECTED;
+}
+
+inline bool linkStaticIp(ServerConfig &config)
+{
+  return config.staticIp != 0 && config.staticIp != 0xFFFFFFFF;
+}
+
+inline void linkRefreshRssi(LinkInfo &link, unsigned long now)
+{
+  link.rssi = WiFi.RSSI();
+  link.lastRssi = now;
+}
+
+inline void linkRefresh(LinkInfo &link, unsigned long now)
+{
+  strncpy(link.ssid, WiFi.SSID(), sizeof(link.ssid) - 1);
+  link.ssid[sizeof(link.ssid) - 1] = '\0';
+  WiFi.BSSID(link.bssid);
+  link.ip = (uint32_t)WiFi.localIP();
+  link.gateway = (uint32_t)WiFi.gatewayIP();
+  link.subnet = (uint32_t)WiFi.subnetMask();
+  linkRefreshRssi(link, now);
+}
+
+// call after connection (or AP start), samples everything once
+inline void linkInit(LinkInfo &link, byte status, unsigned long now)
+{
+  link.status = status;
+  link.down = false;
+  link.reconnecting = false;
+  link.lastCheck = now;
+  link.lostSince = 0;
+  linkRefresh(link, now);
+}
+
+inline void linkConfigure(LinkInfo &link, ServerConfig &config, bool reuseLease)
+{
+  if (linkStaticIp(config))
+  {
+    WiFi.config(IPAddress(config.staticIp), IPAddress(config.staticDns), IPAddress(config.staticGateway), IPAddress(config.staticSubnet));
+    link.ipConfigured = true;
+    link.leaseReused = false;
+  }
+  else if (WS_LINK_REUSE_LEASE && reuseLease && !link.leaseReused && link.ip != 0 && strncmp(link.ssid, config.ssid, sizeof(config.ssid)) == 0)
+  {
+    // NINA does not report DNS, gateway usually serves it
+    WiFi.config(IPAddress(link.ip), IPAddress(link.gateway), IPAddress(link.gateway), IPAddress(link.subnet));
+    link.ipConfigured = true;
+    link.leaseReused = true;
+  }
+  else if (link.ipConfigured)
+  {
+    // zero address switches NINA back to DHCP
+    WiFi.config(IPAddress((uint32_t)0));
+    link.ipConfigured = false;
+    link.leaseReused = false;
+  }
+}
+
+inline void linkReconnectStart(LinkInfo &link, unsigned long since)
+{
+  link.reconnecting = true;
+  link.reconnectAttempts = 0;
+  link.reconnectStart = since;
+  link.reconnectNext = since;
+  link.reconnectInterval = WS_LINK_RECONNECT_MIN;
+}
+
+inline void linkBegin(LinkInfo &link, ServerConfig &config, unsigned long now)
+{
+  linkConfigure(link, config, link.reconnectAttempts == 0);
+  WiFi.setTimeout(0);
+  WiFi.begin(config.ssid, config.pass);
+  // timeout is global, blocking callers (beginAP in AP fallback) need it back
+  WiFi.setTimeout(WS_WIFI_TIMEOUT);
+  link.reconnectAttempts++;
+  link.reconnectNext = now + link.reconnectInterval;
+  link.reconnectInterval = link.reconnectInterval * 2 > WS_LINK_RECONNECT_MAX ? WS_LINK_RECONNECT_MAX : link.reconnectInterval * 2;
+}
+
+// planned link down, re-associates with DHCP so address taken from reused lease is confirmed by DHCP server
+inline void linkRenewLease(LinkInfo &link, ServerConfig &config, unsigned long now)
+{
+  link.ip = 0;
+  link.down = true;
+  link.lostSince = now;
+  linkReconnectStart(link, now);
+  linkBegin(link, config, now);
+}
+
+// returns false when link did not come back within WS_LINK_RECONNECT_TIMEOUT
+inline bool linkReconnect(LinkInfo &link, ServerConfig &config, unsigned long now)
+{
+  if (!link.reconnecting)
+  {
+    if (link.leaseReused && !link.down && now - link.leaseSince >= WS_LINK_LEASE_RENEW)
+    {
+      linkRenewLease(link, config, now);
+    }
+    return true;
+  }
+  if (now - link.reconnectStart >= WS_LINK_RECONNECT_TIMEOUT)
+  {
+    link.reconnecting = false;
+    return false;
+  }
+  if ((long)(now - link.reconnectNext) >= 0)
+  {
+    linkBegin(link, config, now);
+  }
+  return true;
+}
+
+inline void linkConnected(LinkInfo &link, unsigned long now)
+{
+  if (link.reconnecting)
+  {
+    link.reconnecting = false;
+    link.connects++;
+    link.connectTime = now - link.reconnectStart;
+    link.leaseSince = now;
+  }
+}
+
+inline LinkEvent linkPoll(LinkInfo &link, bool apMode, unsigned long now)
+{
+  if (now - link.lastCheck < (link.down ? WS_LINK_DOWN_CHECK_INTERVAL : WS_LINK_CHECK_INTERVAL))
+  {
+    return LINK_EVENT_NONE;
+  }
+  link.lastCheck = now;
+  link.checks++;
+
+  byte status = WiFi.status();
+  byte previous = link.status;
+  link.status = status;
+  if (status != previous)
+  {
+    link.changes++;
+  }
+
+  if (apMode)
+  {
+    if (status == previous)
+    {
+      return LINK_EVENT_NONE;
+    }
+    if (status == WL_AP_CONNECTED)
+    {
+      return LINK_EVENT_AP_CLIENT_CONNECTED;
+    }
+    return previous == WL_AP_CONNECTED ? LINK_EVENT_AP_CLIENT_DISCONNECTED : LINK_EVENT_NONE;
+  }
+
+  if (status == WL_CONNECTED)
+  {
+    link.lostSince = 0;
+    if (previous != WL_CONNECTED || link.down)
+    {
+      linkRefresh(link, now);
+    }
+    else if (now - link.lastRssi >= WS_LINK_RSSI_INTERVAL)
+    {
+      linkRefreshRssi(link, now);
+    }
+    if (link.down)
+    {
+      link.down = false;
+      linkConnected(link, now);
+      return LINK_EVENT_UP;
+    }
+    return LINK_EVENT_NONE;
+  }
+
+  if (!linkStatusLost(status) || link.down)
+  {
+    return LINK_EVENT_NONE;
+  }
+  if (link.lostSince == 0)
+  {
+    link.lostSince = now;
+  }
+  if (now - link.lostSince >= WS_LINK_LOST_TIMEOUT)
+  {
+    link.down = true;
+    link.rssi = 0;
+    return LINK_EVENT_DOWN;
+  }
+  return LINK_EVENT_NONE;
+}
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef WIFISENSORS_METRICS_H
+#define WIFISENSORS_METRICS_H
+
+/*
+Prometheus text exposition format (0.0.4) for GET /metrics.
+Scalar metrics are registered once in setup as pointers to counters and gauges which already exist, scrape only prints them.
+Flash stores and devices families are streamed from stats, profiles and values with labels. Nothing is allocated per scrape,
+output goes through WS_METRICS_CHUNK bytes buffer on stack, so client gets few large writes instead of one per token.
+WiFi metrics are read from link monitor cache, scrape never talks to WiFi module.
+Durations are summaries (_sum in seconds, _count), sums are kept in 64 bit micros, so _sum does not wrap.
+*/
+
+#include "WifiSensorsDrivers.h"
+#include "WifiSensorsTypes.h"
+
+#ifndef WS_MAX_METRICS
+#define WS_MAX_METRICS 24
+#endif
+#ifndef WS_METRICS_CHUNK
+#define WS_METRICS_CHUNK 256
+#endif
+
+enum MetricType
+{
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_SUMMARY,
+};
+
+const char *const metricTypeNames[] = {"counter", "gauge", "summary"};
+
+enum MetricSource
+{
+  METRIC_SOURCE_ULONG,
+  METRIC_SOURCE_LONG,
+  METRIC_SOURCE_UINT,
+  METRIC_SOURCE_INT,
+  METRIC_SOURCE_BYTE,
+  METRIC_SOURCE_BOOL,
+  METRIC_SOURCE_HISTOGRAM,
+  // seconds since boot, value is not used
+  METRIC_SOURCE_UPTIME,
+};
+
+typedef struct
+{
+  const char *name;
+  const char *help;
+  byte type;
+  byte source;
+  const void *value;
+} Metric;
+
+typedef struct
+{
+  byte count;
+  Metric metrics[WS_MAX_METRICS];
+} Metrics;
+
+class MetricsWriter : public Print
+{
+public:
+  MetricsWriter(Print &out) : out(out), len(0) {}
+
+  ~MetricsWriter()
+  {
+    flush();
+  }
+
+  using Print::write;
+
+  size_t write(uint8_t c)
+  {
+    if (len == WS_METRICS_CHUNK)
+    {
+      flush();
+    }
+    buf[len++] = c;
+    return 1;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      write(buffer[i]);
+    }
+    return size;
+  }
+
+  void flush()
+  {
+    if (len > 0)
+    {
+      out.write(buf, len);
+      len = 0;
+    }
+  }
+
+private:
+  Print &out;
+  size_t len;
+  uint8_t buf[WS_METRICS_CHUNK];
+};
+
+inline void metricsInit(Metrics &metrics)
+{
+  metrics.count = 0;
+}
+
+inline bool metricsRegister(Metrics &metrics, const char *name, const char *help, MetricType type, MetricSource source, const void *value)
+{
+  if (metrics.count == WS_MAX_METRICS)
+  {
+    return false;
+  }
+  Metric &metric = metrics.metrics[metrics.count++];
+  metric.name = name;
+  metric.help = help;
+  metric.type = type;
+  metric.source = source;
+  metric.value = value;
+  return true;
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const unsigned long &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_ULONG, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const long &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_LONG, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const unsigned int &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_UINT, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const int &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_INT, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const byte &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_BYTE, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, MetricType type, const bool &value)
+{
+  return metricsRegister(metrics, name, help, type, METRIC_SOURCE_BOOL, &value);
+}
+
+inline bool metricsAdd(Metrics &metrics, const char *name, const char *help, const LatencyHistogram &value)
+{
+  return metricsRegister(metrics, name, help, METRIC_SUMMARY, METRIC_SOURCE_HISTOGRAM, &value);
+}
+
+inline void metricsHeader(Print &out, const char *name, const char *help, byte type)
+{
+  out.print("# HELP ");
+  out.print(name);
+  out.print(' ');
+  out.print(help);
+  out.print("\n# TYPE ");
+  out.print(name);
+  out.print(' ');
+  out.print(metricTypeNames[type]);
+  out.print('\n');
+}
+
+// labels is printed as is, e.g. "store=\"config\"", NULL for none
+inline void metricsSampleName(Print &out, const char *name, const char *suffix, const char *labels)
+{
+  out.print(name);
+  out.print(suffix);
+  if (labels != NULL)
+  {
+    out.print('{');
+    out.print(labels);
+    out.print('}');
+  }
+  out.print(' ');
+}
+
+inline void metricsSummary(Print &out, const char *name, const char *labels, const LatencyHistogram &histogram)
+{
+  metricsSampleName(out, name, "_sum", labels);
+  out.print(histogram.total / 1000000.0, 6);
+  out.print('\n');
+  metricsSampleName(out, name, "_count", labels);
+  out.print(histogram.count);
+  out.print('\n');
+}
+
+inline void metricsSendMetric(Print &out, const Metric &metric)
+{
+  metricsHeader(out, metric.name, metric.help, metric.type);
+  if (metric.source == METRIC_SOURCE_HISTOGRAM)
+  {
+    metricsSummary(out, metric.name, NULL, *static_cast<const LatencyHistogram *>(metric.value));
+    return;
+  }
+
+  metricsSampleName(out, metric.name, "", NULL);
+  switch (metric.source)
+  {
+  case METRIC_SOURCE_ULONG:
+    out.print(*static_cast<const unsigned long *>(metric.value));
+    break;
+  case METRIC_SOURCE_LONG:
+    out.print(*static_cast<const long *>(metric.value));
+    break;
+  case METRIC_SOURCE_UINT:
+    out.print(*static_cast<const unsigned int *>(metric.value));
+    break;
+  case METRIC_SOURCE_INT:
+    out.print(*static_cast<const int *>(metric.value));
+    break;
+  case METRIC_SOURCE_BYTE:
+    out.print(*static_cast<const byte *>(metric.value));
+    break;
+  case METRIC_SOURCE_BOOL:
+    out.print(*static_cast<const bool *>(metric.value) ? 1 : 0);
+    break;
+  case METRIC_SOURCE_UPTIME:
+    out.print(millis() / 1000);
+    break;
+  default:
+    out.print(0);
+    break;
+  }
+  out.print('\n');
+}
+
+inline void metricsSendStores(Print &out, ServerStats &stats, const char *name, const char *help, unsigned long PersistStats::*field)
+{
+  metricsHeader(out, name, help, METRIC_COUNTER);
+  for (byte i = 0; i < stats.storesCount; i++)
+  {
+    out.print(name);
+    out.print("{store=\"");
+    out.print(stats.stores[i]->name);
+    out.print("\"} ");
+    out.print(stats.stores[i]->*field);
+    out.print('\n');
+  }
+}
+
+inline void metricsDeviceLabels(Print &out, const Device &dev)
+{
+  out.print("device=\"");
+  out.print(dev.deviceId);
+  out.print("\",type=\"");
+  out.print(deviceTypetoStr(dev.type));
+  out.print('"');
+}
+
+inline void metricsSendDevices(Print &out, Devices &devices, DeviceProfile *profiles, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues)
+{
+  const char *reads = "wifisensors_device_reads_total";
+  metricsHeader(out, reads, "Device polls.", METRIC_COUNTER);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    if (devices.devices[i].active)
+    {
+      out.print(reads);
+      out.print('{');
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print(",result=\"ok\"} ");
+      out.print(profiles[i].read.count - profiles[i].readFailures);
+      out.print('\n');
+      out.print(reads);
+      out.print('{');
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print(",result=\"failed\"} ");
+      out.print(profiles[i].readFailures);
+      out.print('\n');
+    }
+  }
+
+  const char *pushes = "wifisensors_device_pushes_total";
+  metricsHeader(out, pushes, "Device value pushes to callback.", METRIC_COUNTER);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    if (devices.devices[i].active && devices.devices[i].pushCallback.set)
+    {
+      out.print(pushes);
+      out.print('{');
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print(",result=\"ok\"} ");
+      out.print(profiles[i].push.count - profiles[i].pushFailures);
+      out.print('\n');
+      out.print(pushes);
+      out.print('{');
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print(",result=\"failed\"} ");
+      out.print(profiles[i].pushFailures);
+      out.print('\n');
+    }
+  }
+
+  const char *readTime = "wifisensors_device_read_duration_seconds";
+  metricsHeader(out, readTime, "Device poll time.", METRIC_SUMMARY);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    if (devices.devices[i].active)
+    {
+      out.print(readTime);
+      out.print("_sum{");
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print("} ");
+      out.print(profiles[i].read.total / 1000000.0, 6);
+      out.print('\n');
+      out.print(readTime);
+      out.print("_count{");
+      metricsDeviceLabels(out, devices.devices[i]);
+      out.print("} ");
+      out.print(profiles[i].read.count);
+      out.print('\n');
+    }
+  }
+
+  const char *value = "wifisensors_device_value";
+  metricsHeader(out, value, "Last device value, binary and state values are 0 or 1.", METRIC_GAUGE);
+  for (byte i = 0; i < devices.count; i++)
+  {
+    Device &dev = devices.devices[i];
+    if (!dev.active)
+    {
+      continue;
+    }
+    DevicesValues &values = devicesValues[i];
+    for (byte j = 0; j < dev.valuesCount; j++)
+    {
+      out.print(value);
+      out.print('{');
+      metricsDeviceLabels(out, dev);
+      out.print(",name=\"");
+      out.print(values.names[j]);
+      out.print("\",unit=\"");
+      out.print(values.units[j]);
+      out.print("\"} ");
+      out.print(valueToFloat(values.values[j]), values.values[j].decimals);
+      out.print('\n');
+    }
+  }
+}
+
+inline void metricsSend(Print &client, Metrics &metrics, ServerStats &stats, Devices &devices, DeviceProfile *profiles, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues)
+{
+  MetricsWriter out(client);
+  for (byte i = 0; i < metrics.count; i++)
+  {
+    metricsSendMetric(out, metrics.metrics[i]);
+  }
+  metricsSendStores(out, stats, "wifisensors_flash_commits_total", "Flash store commits.", &PersistStats::commits);
+  metricsSendStores(out, stats, "wifisensors_flash_commit_failures_total", "Flash store commits which did not verify.", &PersistStats::failed);
+  metricsSendStores(out, stats, "wifisensors_flash_written_bytes_total", "Bytes written to flash store.", &PersistStats::bytesWritten);
+  metricsSendStores(out, stats, "wifisensors_flash_row_erases_total", "Flash rows erased by store.", &PersistStats::rowErases);
+  metricsSendDevices(out, devices, profiles, devicesValues);
+  out.flush();
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef WIFISENSORS_PERSIST_H
+#define WIFISENSORS_PERSIST_H
+
+/*
+Deferred flash persistence with two slots (A/B) per store.
+Changes only mark store dirty, commit happens after WS_PERSIST_QUIET ms without changes (at most WS_PERSIST_MAX_DELAY ms after first one)
+or when forced. Commit programs the older slot: erase, data, then header (own flash page) with sequence number and CRC32 of data,
+so interrupted commit leaves previous slot valid. Load takes valid slot with highest sequence number.
+Commit of data equal to last committed one (same CRC) is skipped.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#include <FlashStorage.h>
+
+#define WS_PERSIST_MAGIC 0x57535031UL
+// header takes whole flash page, data starts on next one
+#define WS_PERSIST_HEADER 64
+#define WS_PERSIST_ROW 256
+#define WS_PERSIST_SLOT_SIZE(T) (WS_PERSIST_HEADER + sizeof(T))
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t size;
+  uint32_t crc;
+} PersistHeader;
+
+template <typename T>
+struct PersistStore
+{
+  FlashClass *flash[2];
+  const volatile byte *data[2];
+  T *value;
+  uint32_t crc;
+  PersistStats stats;
+};
+
+// defines two flash slots and store named name
+#define PersistFlash(name, T)                           \
+  Flash(name##_a, WS_PERSIST_SLOT_SIZE(T))              \
+  Flash(name##_b, WS_PERSIST_SLOT_SIZE(T))              \
+  PersistStore<T> name = {{&name##_a, &name##_b}, {_data##name##_a, _data##name##_b}, NULL, 0, {}};
+
+// CRC32, pass previous result as crc to continue over next chunk
+inline uint32_t persistCrc(const byte *data, size_t len, uint32_t crc = 0)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (byte b = 0; b < 8; b++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+template <typename T>
+void persistInit(PersistStore<T> &store, const char *name, T &value, ServerStats *stats)
+{
+  store.value = &value;
+  store.crc = 0;
+  memset(&store.stats, 0, sizeof(store.stats));
+  store.stats.name = name;
+  store.stats.slot = 1;
+  if (stats->storesCount < WS_MAX_STORES)
+  {
+    stats->stores[stats->storesCount++] = &store.stats;
+  }
+}
+
+template <typename T>
+bool persistSlotValid(PersistStore<T> &store, byte slot, PersistHeader &header)
+{
+  store.flash[slot]->read(store.data[slot], &header, sizeof(header));
+  return header.magic == WS_PERSIST_MAGIC && header.size == sizeof(T) &&
+         header.crc == persistCrc((const byte *)store.data[slot] + WS_PERSIST_HEADER, sizeof(T));
+}
+
+// loads newest valid slot, value is zeroed when there is none
+template <typename T>
+bool persistLoad(PersistStore<T> &store)
+{
+  PersistHeader headers[2];
+  bool valid[2];
+  store.stats.invalid = 0;
+  for (byte i = 0; i < 2; i++)
+  {
+    valid[i] = persistSlotValid(store, i, headers[i]);
+    if (!valid[i])
+    {
+      store.stats.invalid++;
+    }
+  }
+
+  store.stats.dirty = false;
+  if (!valid[0] && !valid[1])
+  {
+    memset(store.value, 0, sizeof(T));
+    store.crc = 0;
+    return false;
+  }
+
+  byte slot = !valid[0] ? 1 : !valid[1] ? 0 : (int32_t)(headers[1].seq - headers[0].seq) > 0 ? 1 : 0;
+  store.flash[slot]->read(store.data[slot] + WS_PERSIST_HEADER, store.value, sizeof(T));
+  store.stats.slot = slot;
+  store.stats.seq = headers[slot].seq;
+  store.crc = headers[slot].crc;
+  return true;
+}
+
+inline void persistMarkDirty(PersistStats &stats)
+{
+  unsigned long now = millis();
+  if (stats.dirty)
+  {
+    stats.coalesced++;
+  }
+  else
+  {
+    stats.dirty = true;
+    stats.dirtySince = now;
+  }
+  stats.changedAt = now;
+}
+
+inline bool persistDue(PersistStats &stats, unsigned long now)
+{
+  return stats.dirty && (now - stats.changedAt >= WS_PERSIST_QUIET || now - stats.dirtySince >= WS_PERSIST_MAX_DELAY);
+}
+
+template <typename T>
+void persistChanged(PersistStore<T> &store)
+{
+  persistMarkDirty(store.stats);
+}
+
+template <typename T>
+bool persistCommit(PersistStore<T> &store)
+{
+  if (!store.stats.dirty)
+  {
+    return true;
+  }
+
+  uint32_t crc = persistCrc((const byte *)store.value, sizeof(T));
+  // seq is 0 until something was loaded or committed
+  if (store.stats.seq > 0 && store.crc == crc)
+  {
+    store.stats.dirty = false;
+    store.stats.skipped++;
+    return true;
+  }
+
+  byte slot = store.stats.slot ^ 1;
+  PersistHeader header;
+  header.magic = WS_PERSIST_MAGIC;
+  header.seq = store.stats.seq + 1;
+  header.size = sizeof(T);
+  header.crc = crc;
+
+  store.flash[slot]->erase(store.data[slot], WS_PERSIST_SLOT_SIZE(T));
+  store.flash[slot]->write(store.data[slot] + WS_PERSIST_HEADER, store.value, sizeof(T));
+  store.flash[slot]->write(store.data[slot], &header, sizeof(header));
+  store.stats.rowErases += (WS_PERSIST_SLOT_SIZE(T) + WS_PERSIST_ROW - 1) / WS_PERSIST_ROW;
+  store.stats.bytesWritten += WS_PERSIST_SLOT_SIZE(T);
+
+  PersistHeader written;
+  if (!persistSlotValid(store, slot, written) || written.seq != header.seq)
+  {
+    // previous slot is still valid, retry on next due check
+    store.stats.failed++;
+    store.stats.dirtySince = millis();
+    return false;
+  }
+
+  store.stats.slot = slot;
+  store.stats.seq = header.seq;
+  store.stats.dirty = false;
+  store.stats.commits++;
+  store.crc = crc;
+  return true;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef WIFISENSORS_POOL_H
+#define WIFISENSORS_POOL_H
+
+/*
+Fixed size pool of objects constructed with placement new into static storage.
+Slots are returned with poolDelete, so setup/delete cycles do not touch the heap.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#include <new>
+#include <utility>
+
+template <typename T, byte N>
+struct Pool
+{
+  struct Slot
+  {
+    alignas(T) byte data[sizeof(T)];
+  };
+
+  Slot slots[N];
+  bool used[N];
+  PoolStats stats;
+};
+
+template <typename T, byte N>
+void poolInit(Pool<T, N> &pool, const char *name)
+{
+  for (byte i = 0; i < N; i++)
+  {
+    pool.used[i] = false;
+  }
+  pool.stats.name = name;
+  pool.stats.size = N;
+  pool.stats.used = 0;
+  pool.stats.peak = 0;
+  pool.stats.failed = 0;
+  pool.stats.objectSize = sizeof(T);
+}
+
+template <typename T, byte N, typename... Args>
+T *poolNew(Pool<T, N> &pool, Args &&... args)
+{
+  for (byte i = 0; i < N; i++)
+  {
+    if (!pool.used[i])
+    {
+      pool.used[i] = true;
+      pool.stats.used++;
+      if (pool.stats.used > pool.stats.peak)
+      {
+        pool.stats.peak = pool.stats.used;
+      }
+      return new (pool.slots[i].data) T(std::forward<Args>(args)...);
+    }
+  }
+  pool.stats.failed++;
+  return NULL;
+}
+
+template <typename T, byte N>
+void poolDelete(Pool<T, N> &pool, T *obj)
+{
+  if (obj == NULL)
+  {
+    return;
+  }
+  for (byte i = 0; i < N; i++)
+  {
+    if (pool.used[i] && reinterpret_cast<T *>(pool.slots[i].data) == obj)
+    {
+      obj->~T();
+      pool.used[i] = false;
+      pool.stats.used--;
+      return;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef WIFISENSORS_PROFILE_H
+#define WIFISENSORS_PROFILE_H
+
+/*
+Latency histograms in micros with log2 buckets: bucket i counts durations in [2^i, 2^(i+1)) us, last bucket takes the rest.
+Percentiles are reported as upper bound of the bucket (capped by max). When a bucket is full all buckets are halved,
+so they keep the shape of the distribution instead of saturating (percentiles come from buckets, count and total are exact).
+*/
+
+#include "WifiSensorsTypes.h"
+
+const char *const loopStageNames[LOOP_STAGES] = {"status", "wifi", "restart", "devices", "server", "memory", "persist", "loop"};
+
+inline void histogramReset(LatencyHistogram &histogram)
+{
+  histogram.count = 0;
+  histogram.total = 0;
+  histogram.max = 0;
+  for (byte i = 0; i < WS_HISTOGRAM_BUCKETS; i++)
+  {
+    histogram.buckets[i] = 0;
+  }
+}
+
+inline void histogramAdd(LatencyHistogram &histogram, unsigned long us)
+{
+  byte bucket = 0;
+  while (bucket < WS_HISTOGRAM_BUCKETS - 1 && (us >> (bucket + 1)) > 0)
+  {
+    bucket++;
+  }
+  if (histogram.buckets[bucket] == 0xFFFF)
+  {
+    for (byte i = 0; i < WS_HISTOGRAM_BUCKETS; i++)
+    {
+      histogram.buckets[i] >>= 1;
+    }
+  }
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  histogram.total += us;
+  histogram.max = us > histogram.max ? us : histogram.max;
+}
+
+inline unsigned long histogramPercentile(LatencyHistogram &histogram, byte percent)
+{
+  unsigned long total = 0;
+  for (byte i = 0; i < WS_HISTOGRAM_BUCKETS; i++)
+  {
+    total += histogram.buckets[i];
+  }
+  unsigned long rank = (total * percent + 99) / 100;
+  unsigned long seen = 0;
+  for (byte i = 0; i < WS_HISTOGRAM_BUCKETS; i++)
+  {
+    seen += histogram.buckets[i];
+    if (seen >= rank && seen > 0)
+    {
+      unsigned long upper = (1UL << (i + 1)) - 1;
+      return upper < histogram.max ? upper : histogram.max;
+    }
+  }
+  return histogram.max;
+}
+
+inline void profileReset(LoopProfile &profile)
+{
+  profile.since = millis();
+  profile.loops = 0;
+  for (byte i = 0; i < LOOP_STAGES; i++)
+  {
+    histogramReset(profile.stages[i]);
+  }
+}
+
+// records stage started at start, returns now as start of next stage
+inline unsigned long profileStage(LoopProfile &profile, LoopStage stage, unsigned long start)
+{
+  unsigned long now = micros();
+  histogramAdd(profile.stages[stage], now - start);
+  return now;
+}
+
+inline void profileLoop(LoopProfile &profile, unsigned long start)
+{
+  profile.loops++;
+  profileStage(profile, LOOP_STAGE_LOOP, start);
+}
+
+inline void deviceProfileReset(DeviceProfile &profile)
+{
+  histogramReset(profile.read);
+  histogramReset(profile.push);
+  profile.readFailures = 0;
+  profile.pushFailures = 0;
+}
+
+#endif
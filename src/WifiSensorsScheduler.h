@@ -0,0 +1,128 @@
+#ifndef WIFISENSORS_SCHEDULER_H
+#define WIFISENSORS_SCHEDULER_H
+
+/*
+Min-heap of devices ordered by next poll time (millis).
+Times are compared by signed difference so order stays correct across millis() rollover.
+*/
+
+#include "WifiSensorsTypes.h"
+
+#define WS_SCHEDULER_NONE 0xFF
+
+typedef struct
+{
+  byte size;
+  byte heap[WS_MAX_DEVICES];
+  byte pos[WS_MAX_DEVICES];
+  unsigned long due[WS_MAX_DEVICES];
+} PollScheduler;
+
+inline bool schedulerBefore(unsigned long a, unsigned long b)
+{
+  return (long)(a - b) < 0;
+}
+
+inline void schedulerSwap(PollScheduler &scheduler, byte i, byte j)
+{
+  byte tmp = scheduler.heap[i];
+  scheduler.heap[i] = scheduler.heap[j];
+  scheduler.heap[j] = tmp;
+  scheduler.pos[scheduler.heap[i]] = i;
+  scheduler.pos[scheduler.heap[j]] = j;
+}
+
+inline void schedulerUp(PollScheduler &scheduler, byte i)
+{
+  while (i > 0)
+  {
+    byte parent = (i - 1) / 2;
+    if (!schedulerBefore(scheduler.due[scheduler.heap[i]], scheduler.due[scheduler.heap[parent]]))
+    {
+      break;
+    }
+    schedulerSwap(scheduler, i, parent);
+    i = parent;
+  }
+}
+
+inline void schedulerDown(PollScheduler &scheduler, byte i)
+{
+  while (true)
+  {
+    byte first = i;
+    byte left = 2 * i + 1;
+    byte right = left + 1;
+    if (left < scheduler.size && schedulerBefore(scheduler.due[scheduler.heap[left]], scheduler.due[scheduler.heap[first]]))
+    {
+      first = left;
+    }
+    if (right < scheduler.size && schedulerBefore(scheduler.due[scheduler.heap[right]], scheduler.due[scheduler.heap[first]]))
+    {
+      first = right;
+    }
+    if (first == i)
+    {
+      break;
+    }
+    schedulerSwap(scheduler, i, first);
+    i = first;
+  }
+}
+
+inline void schedulerClear(PollScheduler &scheduler)
+{
+  scheduler.size = 0;
+  for (byte i = 0; i < WS_MAX_DEVICES; i++)
+  {
+    scheduler.pos[i] = WS_SCHEDULER_NONE;
+  }
+}
+
+// add device or move it to new due time
+inline void schedulerAdd(PollScheduler &scheduler, byte deviceId, unsigned long due)
+{
+  if (scheduler.pos[deviceId] == WS_SCHEDULER_NONE)
+  {
+    scheduler.heap[scheduler.size] = deviceId;
+    scheduler.pos[deviceId] = scheduler.size;
+    scheduler.size++;
+  }
+  scheduler.due[deviceId] = due;
+  schedulerUp(scheduler, scheduler.pos[deviceId]);
+  schedulerDown(scheduler, scheduler.pos[deviceId]);
+}
+
+inline void schedulerRemove(PollScheduler &scheduler, byte deviceId)
+{
+  byte i = scheduler.pos[deviceId];
+  if (i == WS_SCHEDULER_NONE)
+  {
+    return;
+  }
+
+  scheduler.size--;
+  if (i != scheduler.size)
+  {
+    schedulerSwap(scheduler, i, scheduler.size);
+  }
+  scheduler.pos[deviceId] = WS_SCHEDULER_NONE;
+  if (i < scheduler.size)
+  {
+    schedulerUp(scheduler, i);
+    schedulerDown(scheduler, i);
+  }
+}
+
+// device with earliest due time if it is due at given time
+inline bool schedulerNext(PollScheduler &scheduler, unsigned long now, byte &deviceId)
+{
+  if (scheduler.size == 0)
+  {
+    return false;
+  }
+  deviceId = scheduler.heap[0];
+  return !schedulerBefore(now, scheduler.due[deviceId]);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef WIFISENSORS_STATS_H
+#define WIFISENSORS_STATS_H
+
+/*
+Per value aggregates over rolling windows (see WS_STATS_WINDOWS_MS).
+Each window is a ring of WS_STATS_SLOTS slots of window/WS_STATS_SLOTS ms, samples go to the current slot and the oldest
+slot is cleared when a new one starts, so window covers last (WS_STATS_SLOTS - 1) slots and the running one.
+Mean and variance are updated incrementally (Welford) and slots are merged (Chan) on read, so memory and update cost are constant.
+*/
+
+#include "WifiSensorsTypes.h"
+
+const unsigned long statsWindowsMs[WS_STATS_WINDOWS] = WS_STATS_WINDOWS_MS;
+
+inline void statsAggregateReset(ValueAggregate &agg)
+{
+  agg.count = 0;
+  agg.min = 0.0f;
+  agg.max = 0.0f;
+  agg.mean = 0.0f;
+  agg.m2 = 0.0f;
+}
+
+inline void statsAggregateAdd(ValueAggregate &agg, float value)
+{
+  agg.count++;
+  if (agg.count == 1)
+  {
+    agg.min = value;
+    agg.max = value;
+  }
+  else
+  {
+    agg.min = value < agg.min ? value : agg.min;
+    agg.max = value > agg.max ? value : agg.max;
+  }
+  float delta = value - agg.mean;
+  agg.mean += delta / agg.count;
+  agg.m2 += delta * (value - agg.mean);
+}
+
+inline void statsAggregateMerge(ValueAggregate &agg, const ValueAggregate &other)
+{
+  if (other.count == 0)
+  {
+    return;
+  }
+  if (agg.count == 0)
+  {
+    agg = other;
+    return;
+  }
+  unsigned long count = agg.count + other.count;
+  float delta = other.mean - agg.mean;
+  agg.mean += delta * other.count / count;
+  agg.m2 += other.m2 + delta * delta * ((float)agg.count * other.count / count);
+  agg.min = other.min < agg.min ? other.min : agg.min;
+  agg.max = other.max > agg.max ? other.max : agg.max;
+  agg.count = count;
+}
+
+inline float statsAggregateVariance(const ValueAggregate &agg)
+{
+  return agg.count > 1 ? agg.m2 / (agg.count - 1) : 0.0f;
+}
+
+inline unsigned long statsSlotMs(byte window)
+{
+  return statsWindowsMs[window] / WS_STATS_SLOTS;
+}
+
+inline void statsReset(ValueStats &stats, unsigned long now)
+{
+  for (byte i = 0; i < WS_STATS_WINDOWS; i++)
+  {
+    stats.windows[i].start = now;
+    stats.windows[i].slot = 0;
+    for (byte k = 0; k < WS_STATS_SLOTS; k++)
+    {
+      statsAggregateReset(stats.windows[i].slots[k]);
+    }
+  }
+}
+
+// advances slots to now, slots older than the window are cleared
+inline void statsRoll(ValueStats &stats, unsigned long now)
+{
+  for (byte i = 0; i < WS_STATS_WINDOWS; i++)
+  {
+    ValueWindow &window = stats.windows[i];
+    unsigned long slotMs = statsSlotMs(i);
+    unsigned long steps = (now - window.start) / slotMs;
+    if (steps == 0)
+    {
+      continue;
+    }
+
+    for (unsigned long k = 0; k < steps && k < WS_STATS_SLOTS; k++)
+    {
+      window.slot = (window.slot + 1) % WS_STATS_SLOTS;
+      statsAggregateReset(window.slots[window.slot]);
+    }
+    window.start += steps * slotMs;
+  }
+}
+
+inline void statsAdd(ValueStats &stats, float value, unsigned long now)
+{
+  statsRoll(stats, now);
+  for (byte i = 0; i < WS_STATS_WINDOWS; i++)
+  {
+    statsAggregateAdd(stats.windows[i].slots[stats.windows[i].slot], value);
+  }
+}
+
+// aggregate of whole rolling window, call statsRoll before
+inline void statsWindow(const ValueStats &stats, byte window, ValueAggregate &agg)
+{
+  statsAggregateReset(agg);
+  for (byte k = 0; k < WS_STATS_SLOTS; k++)
+  {
+    statsAggregateMerge(agg, stats.windows[window].slots[k]);
+  }
+}
+
+// ms covered by window, shorter than window length by the not yet elapsed part of current slot
+inline unsigned long statsWindowSpan(const ValueStats &stats, byte window, unsigned long now)
+{
+  return (WS_STATS_SLOTS - 1) * statsSlotMs(window) + (now - stats.windows[window].start);
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef WIFISENSORS_STRING_H
+#define WIFISENSORS_STRING_H
+
+/*
+Fixed capacity string, never touches the heap.
+It is a Print, so values are appended with print()/println(); text past capacity is dropped and truncated() is set.
+*/
+
+#include <Arduino.h>
+
+template <size_t N>
+class FixedString : public Print
+{
+public:
+  FixedString()
+  {
+    clear();
+  }
+
+  FixedString(const char *str)
+  {
+    clear();
+    print(str);
+  }
+
+  using Print::write;
+
+  size_t write(uint8_t c)
+  {
+    if (len >= N)
+    {
+      overflow = true;
+      return 0;
+    }
+    buf[len++] = c;
+    buf[len] = '\0';
+    return 1;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = size;
+    if (len + n > N)
+    {
+      n = N - len;
+      overflow = true;
+    }
+    memcpy(buf + len, buffer, n);
+    len += n;
+    buf[len] = '\0';
+    return n;
+  }
+
+  FixedString &operator=(const char *str)
+  {
+    clear();
+    print(str);
+    return *this;
+  }
+
+  char operator[](size_t i) const
+  {
+    return i < len ? buf[i] : '\0';
+  }
+
+  void clear()
+  {
+    len = 0;
+    buf[0] = '\0';
+    overflow = false;
+  }
+
+  const char *c_str() const
+  {
+    return buf;
+  }
+
+  size_t length() const
+  {
+    return len;
+  }
+
+  size_t capacity() const
+  {
+    return N;
+  }
+
+  bool truncated() const
+  {
+    return overflow;
+  }
+
+  int indexOf(char c, size_t from = 0) const
+  {
+    const char *p = from < len ? strchr(buf + from, c) : NULL;
+    return p == NULL ? -1 : p - buf;
+  }
+
+  int indexOf(const char *str, size_t from = 0) const
+  {
+    const char *p = from < len ? strstr(buf + from, str) : NULL;
+    return p == NULL ? -1 : p - buf;
+  }
+
+  bool startsWith(const char *str) const
+  {
+    return strncmp(buf, str, strlen(str)) == 0;
+  }
+
+  // replace every occurrence in place, returns number of replacements
+  byte replace(const char *from, const char *to)
+  {
+    size_t fromLen = strlen(from);
+    size_t toLen = strlen(to);
+    if (fromLen == 0)
+    {
+      return 0;
+    }
+
+    byte cnt = 0;
+    int pos = indexOf(from);
+    while (pos >= 0)
+    {
+      if (len - fromLen + toLen > N)
+      {
+        overflow = true;
+        break;
+      }
+      memmove(buf + pos + toLen, buf + pos + fromLen, len - pos - fromLen + 1);
+      memcpy(buf + pos, to, toLen);
+      len = len - fromLen + toLen;
+      cnt++;
+      pos = indexOf(from, pos + toLen);
+    }
+    return cnt;
+  }
+
+private:
+  char buf[N + 1];
+  size_t len;
+  bool overflow;
+};
+
+#endif
@@ -10,10 +10,10 @@
 #define WS_DIGITAL_PINS 13
 #endif
 #ifndef WS_MAX_REQUEST_PARAMS
-#define WS_MAX_REQUEST_PARAMS 4
+#define WS_MAX_REQUEST_PARAMS 8
 #endif
 #ifndef WS_MAX_REQUEST_HEADERS
-#define WS_MAX_REQUEST_HEADERS 1
+#define WS_MAX_REQUEST_HEADERS 6
 #endif
 #ifndef WS_MAX_DEVICE_PINS
 #define WS_MAX_DEVICE_PINS 2
@@ -25,7 +25,7 @@
 #define WS_MAX_DEVICES 10
 #endif
 #ifndef WS_DEVICE_CONFIG_BYTES
-#define WS_DEVICE_CONFIG_BYTES 3
+#define WS_DEVICE_CONFIG_BYTES 4
 #endif
 #ifndef WS_DEVICE_CONFIG_INTS
 #define WS_DEVICE_CONFIG_INTS 2
@@ -36,6 +36,131 @@
 #ifndef WS_DEVICE_CONFIG_LONGS
 #define WS_DEVICE_CONFIG_LONGS 1
 #endif
+#ifndef WS_DEVICE_CONFIG_ROM_BYTES
+#define WS_DEVICE_CONFIG_ROM_BYTES 8
+#endif
+#ifndef WS_VALUE_STR_LEN
+#define WS_VALUE_STR_LEN 16
+#endif
+#ifndef WS_STATS_WINDOWS
+#define WS_STATS_WINDOWS 2
+#define WS_STATS_WINDOWS_MS {60000UL, 3600000UL}
+#endif
+#ifndef WS_STATS_SLOTS
+#define WS_STATS_SLOTS 4
+#endif
+#ifndef WS_HISTORY_RAW
+#define WS_HISTORY_RAW 8
+#endif
+#ifndef WS_HISTORY_1M
+#define WS_HISTORY_1M 15
+#endif
+#ifndef WS_HISTORY_15M
+#define WS_HISTORY_15M 8
+#endif
+#ifndef WS_MAX_DALLAS_BUSES
+#define WS_MAX_DALLAS_BUSES 2
+#endif
+#ifndef WS_MAX_DALLAS_SENSORS
+#define WS_MAX_DALLAS_SENSORS 8
+#endif
+#ifndef WS_POOL_DEBOUNCERS
+#define WS_POOL_DEBOUNCERS WS_MAX_DEVICES
+#endif
+#ifndef WS_POOL_DHT22
+#define WS_POOL_DHT22 4
+#endif
+#ifndef WS_MAX_POOLS
+#define WS_MAX_POOLS 4
+#endif
+#ifndef WS_WARNING_LEN
+#define WS_WARNING_LEN 64
+#endif
+#ifndef WS_CALLBACK_PATH_LEN
+#define WS_CALLBACK_PATH_LEN 192
+#endif
+#ifndef WS_CALLBACK_PLACEHOLDER_LEN
+#define WS_CALLBACK_PLACEHOLDER_LEN 24
+#endif
+#ifndef WS_HISTOGRAM_BUCKETS
+#define WS_HISTOGRAM_BUCKETS 20
+#endif
+#ifndef WS_HEAP_STATS
+#define WS_HEAP_STATS 1
+#endif
+#ifndef WS_ALLOC_CHECK
+#define WS_ALLOC_CHECK 0
+#endif
+#ifndef WS_ALLOC_CHECK_WARMUP
+#define WS_ALLOC_CHECK_WARMUP 10000UL
+#endif
+#ifndef WS_LONGPOLL_CLIENTS
+#define WS_LONGPOLL_CLIENTS 2
+#endif
+#ifndef WS_LONGPOLL_MAX_WAIT
+#define WS_LONGPOLL_MAX_WAIT 30000UL
+#endif
+// "epoch:seq" value change cursor, two uint32 and colon
+#define WS_VALUE_CURSOR_LEN 22
+#ifndef WS_LINK_CHECK_INTERVAL
+#define WS_LINK_CHECK_INTERVAL 1000UL
+#endif
+#ifndef WS_LINK_RSSI_INTERVAL
+#define WS_LINK_RSSI_INTERVAL 10000UL
+#endif
+#ifndef WS_LINK_LOST_TIMEOUT
+#define WS_LINK_LOST_TIMEOUT 1000UL
+#endif
+#ifndef WS_LINK_DOWN_CHECK_INTERVAL
+#define WS_LINK_DOWN_CHECK_INTERVAL 100UL
+#endif
+#ifndef WS_LINK_RECONNECT_MIN
+#define WS_LINK_RECONNECT_MIN 2000UL
+#endif
+#ifndef WS_LINK_RECONNECT_MAX
+#define WS_LINK_RECONNECT_MAX 16000UL
+#endif
+#ifndef WS_LINK_RECONNECT_TIMEOUT
+#define WS_LINK_RECONNECT_TIMEOUT 300000UL
+#endif
+#ifndef WS_LINK_CONNECT_TIMEOUT
+#define WS_LINK_CONNECT_TIMEOUT 60000UL
+#endif
+#ifndef WS_LINK_REUSE_LEASE
+#define WS_LINK_REUSE_LEASE 1
+#endif
+// reused lease is given back to DHCP this many ms after link came up on it
+#ifndef WS_LINK_LEASE_RENEW
+#define WS_LINK_LEASE_RENEW 60000UL
+#endif
+// WiFiNINA default, WiFi.begin/beginAP block up to this many ms
+#ifndef WS_WIFI_TIMEOUT
+#define WS_WIFI_TIMEOUT 50000UL
+#endif
+// ms to wait for first byte of request body which did not come with headers
+#ifndef WS_BODY_TIMEOUT
+#define WS_BODY_TIMEOUT 1000UL
+#endif
+#ifndef WS_PERSIST_QUIET
+#define WS_PERSIST_QUIET 2000UL
+#endif
+#ifndef WS_PERSIST_MAX_DELAY
+#define WS_PERSIST_MAX_DELAY 10000UL
+#endif
+#ifndef WS_MAX_STORES
+#define WS_MAX_STORES 4
+#endif
+#ifndef WS_DEVLOG_BLOCK_SIZE
+#define WS_DEVLOG_BLOCK_SIZE 2048
+#endif
+#ifndef WS_DEVLOG_BLOCKS
+#define WS_DEVLOG_BLOCKS 12
+#endif
+#ifndef WS_DEVLOG_MIN_FREE
+#define WS_DEVLOG_MIN_FREE 2
+#endif
+
+#include "WifiSensorsString.h"
 
 #include <Arduino.h>
 #include <Array.h>
@@ -81,6 +206,10 @@ typedef struct
   char pass[64];
   char serverauth[64];
   Callback callback;
+  uint32_t staticIp;
+  uint32_t staticGateway;
+  uint32_t staticSubnet;
+  uint32_t staticDns;
 } ServerConfig;
 
 typedef struct
@@ -104,19 +233,132 @@ typedef struct
   int ints[WS_DEVICE_CONFIG_INTS];
   unsigned long ulongs[WS_DEVICE_CONFIG_LONGS];
   float floats[WS_DEVICE_CONFIG_FLOATS];
+  byte rom[WS_DEVICE_CONFIG_ROM_BYTES];
 } DeviceConfig;
 
+// version of stored Device layout (device log records), bump when Device or DeviceConfig changes
+#define WS_DEVICE_LAYOUT 2
+
+typedef struct
+{
+  const char *name;
+  byte size;
+  byte used;
+  byte peak;
+  unsigned int failed;
+  unsigned int objectSize;
+} PoolStats;
+
+typedef struct
+{
+  const char *name;
+  uint32_t seq;
+  byte slot;
+  bool dirty;
+  unsigned long dirtySince;
+  unsigned long changedAt;
+  unsigned long coalesced;
+  unsigned long commits;
+  unsigned long skipped;
+  unsigned long failed;
+  unsigned long rowErases;
+  unsigned long bytesWritten;
+  unsigned long relocated;
+  uint32_t maxErases;
+  unsigned int invalid;
+} PersistStats;
+
+typedef struct
+{
+  unsigned long allocs;
+  unsigned long frees;
+  unsigned long failed;
+  unsigned long used;
+  unsigned long peak;
+  // bytes handed out by all allocations so far, never decreases
+  unsigned long allocated;
+  unsigned int free;
+  unsigned int largestFree;
+  byte fragmentation;
+  unsigned int stackGap;
+  unsigned int stackLowWater;
+} HeapStats;
+
+enum LinkEvent
+{
+  LINK_EVENT_NONE,
+  LINK_EVENT_UP,
+  LINK_EVENT_DOWN,
+  LINK_EVENT_AP_CLIENT_CONNECTED,
+  LINK_EVENT_AP_CLIENT_DISCONNECTED
+};
+
+typedef struct
+{
+  byte status;
+  char ssid[33];
+  byte bssid[6];
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  long rssi;
+  bool down;
+  bool ipConfigured;
+  bool leaseReused;
+  unsigned long leaseSince;
+  unsigned long lastCheck;
+  unsigned long lastRssi;
+  unsigned long lostSince;
+  unsigned long checks;
+  unsigned long changes;
+  bool reconnecting;
+  byte reconnectAttempts;
+  unsigned long reconnectStart;
+  unsigned long reconnectNext;
+  unsigned long reconnectInterval;
+  unsigned long connects;
+  unsigned long connectTime;
+} LinkInfo;
+
+enum BootPhase
+{
+  BOOT_PHASE_RESET_CHECK,
+  BOOT_PHASE_WIFI_START,
+  BOOT_PHASE_PINS,
+  BOOT_PHASE_DEVICES,
+  BOOT_PHASE_WIFI_CONNECTED,
+  BOOT_PHASE_SERVER,
+  BOOT_PHASE_FIRST_REQUEST,
+  BOOT_PHASES
+};
+
+const char *const bootPhaseNames[BOOT_PHASES] = {"reset_check", "wifi_start", "pins", "devices", "wifi_connected", "server", "first_request"};
+
 typedef struct
 {
   byte devices;
   char macStr[18];
+  LinkInfo link;
+  // millis() at end of each boot phase, 0 when phase was not reached yet
+  unsigned long boot[BOOT_PHASES];
   int freeMem;
+  HeapStats heap;
+  unsigned int historyMemory;
+  PoolStats *pools[WS_MAX_POOLS];
+  byte poolsCount = 0;
+  PersistStats *stores[WS_MAX_STORES];
+  byte storesCount = 0;
   unsigned long devicesProcessingThresold = 0UL;
   unsigned long processingWarnings = 0UL;
   unsigned long wifiConnectionTime = 0UL;
-  String lastWarning;
+  unsigned long allocLoops = 0UL;
+  unsigned long allocFailures = 0UL;
+  unsigned int allocLastOps = 0;
+  FixedString<WS_WARNING_LEN> lastWarning;
 } ServerStats;
 
+typedef FixedString<WS_CALLBACK_PATH_LEN> CallbackPath;
+
 enum DeviceType
 {
   DEVICE_BUTTON,
@@ -135,6 +377,7 @@ enum DeviceConfigBytes
   DEVICE_CONFIG_BYTES_TRIGGER,
   DEVICE_CONFIG_BYTES_ANALOG_READ_CNT,
   DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX,
+  DEVICE_CONFIG_BYTES_RESOLUTION,
 };
 
 enum DeviceConfigFloats
@@ -151,12 +394,115 @@ enum DeviceConfigInts
   DEVICE_CONFIG_INTS_ANALOG_READ_DELAY
 };
 
+enum DeviceValueKind
+{
+  VALUE_NUMBER,
+  VALUE_BINARY,
+  VALUE_STATE,
+};
+
+// fixed point value, number is raw / 10^decimals, binary and state are 0/1
+// seq is global change sequence at last change of the value
+typedef struct
+{
+  int32_t raw;
+  byte kind;
+  byte decimals;
+  uint32_t seq;
+} DeviceValue;
+
+typedef struct
+{
+  unsigned long count;
+  float min;
+  float max;
+  float mean;
+  float m2;
+} ValueAggregate;
+
+typedef struct
+{
+  // start of current slot
+  unsigned long start;
+  byte slot;
+  ValueAggregate slots[WS_STATS_SLOTS];
+} ValueWindow;
+
+typedef struct
+{
+  ValueWindow windows[WS_STATS_WINDOWS];
+} ValueStats;
+
+typedef struct
+{
+  unsigned long time;
+  float value;
+} HistorySample;
+
+template <byte N>
+struct HistoryTier
+{
+  unsigned long start;
+  float sum;
+  unsigned int count;
+  byte head;
+  byte size;
+  float values[N];
+};
+
+typedef struct
+{
+  byte head;
+  byte size;
+  HistorySample raw[WS_HISTORY_RAW];
+  HistoryTier<WS_HISTORY_1M> minutes;
+  HistoryTier<WS_HISTORY_15M> quarters;
+} ValueHistory;
+
+typedef struct
+{
+  unsigned long count;
+  // sum of micros, 64 bit so mean and metrics _sum do not wrap
+  uint64_t total;
+  unsigned long max;
+  uint16_t buckets[WS_HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+enum LoopStage
+{
+  LOOP_STAGE_STATUS,
+  LOOP_STAGE_WIFI,
+  LOOP_STAGE_RESTART,
+  LOOP_STAGE_DEVICES,
+  LOOP_STAGE_SERVER,
+  LOOP_STAGE_MEMORY,
+  LOOP_STAGE_PERSIST,
+  LOOP_STAGE_LOOP,
+  LOOP_STAGES
+};
+
+typedef struct
+{
+  unsigned long since;
+  unsigned long loops;
+  LatencyHistogram stages[LOOP_STAGES];
+} LoopProfile;
+
+typedef struct
+{
+  LatencyHistogram read;
+  LatencyHistogram push;
+  unsigned long readFailures;
+  unsigned long pushFailures;
+} DeviceProfile;
+
 typedef struct
 {
   unsigned long lastPoll;
-  Array<String, WS_MAX_DEVICE_VALUES> names;
-  Array<String, WS_MAX_DEVICE_VALUES> units;
-  Array<String, WS_MAX_DEVICE_VALUES> values;
+  Array<const char *, WS_MAX_DEVICE_VALUES> names;
+  Array<const char *, WS_MAX_DEVICE_VALUES> units;
+  Array<DeviceValue, WS_MAX_DEVICE_VALUES> values;
+  ValueStats stats[WS_MAX_DEVICE_VALUES];
 } DevicesValues;
 
 typedef struct
@@ -178,99 +524,170 @@ typedef struct
   Device devices[WS_MAX_DEVICES];
 } Devices;
 
-inline DeviceType deviceTypeFromStr(String &type)
+inline int pinModeFromStr(String &pinMode)
 {
-  if (type == "BUTTON")
+  Serial.println(pinMode);  //TODO
+
+  if (pinMode == "INPUT")
   {
-    return DEVICE_BUTTON;
+    return 0;
   }
-  else if (type == "GENERIC_ANALOG")
+  else if (pinMode == "OUTPUT")
   {
-    return DEVICE_GENERIC_ANALOG_INPUT;
+    return 1;
   }
-  else if (type == "GENERIC_DIGITAL")
+  else if (pinMode == "INPUT_PULLUP")
   {
-    return DEVICE_GENERIC_DIGITAL_INPUT;
+    return 2;
   }
-  else if (type == "DHT22")
+  return 0;
+}
+
+inline const char *pinModeToStr(int mode)
+{
+  switch (mode)
   {
-    return DEVICE_DHT22;
+  case 0:
+    return "INPUT";
+  case 1:
+    return "OUTPUT";
+  case 2:
+    return "INPUT_PULLUP";
+  default:
+    return "INPUT";
   }
-  else if (type == "MOTION")
+}
+
+const int32_t valueScale[] = {1L, 10L, 100L, 1000L, 10000L};
+
+// last change sequence of any value in this boot, 0 before first change
+inline uint32_t &valueSeq()
+{
+  static uint32_t seq = 0;
+  return seq;
+}
+
+// boot epoch, cursors of other boots do not match it
+inline uint32_t &valueEpoch()
+{
+  static uint32_t epoch = 0;
+  return epoch;
+}
+
+inline void valueSeqBoot(uint32_t epoch)
+{
+  valueEpoch() = epoch;
+  valueSeq() = 0;
+}
+
+// true when sequence a is after b, holds across wrap of the counter
+inline bool valueSeqAfter(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) > 0;
+}
+
+// value changed after sequence since, since 0 is before first change
+inline bool valueChanged(const DeviceValue &value, uint32_t since)
+{
+  return value.seq != 0 && (since == 0 || valueSeqAfter(value.seq, since));
+}
+
+// since is sequence of "epoch:seq" cursor from client, false and since 0 (all values) when it is from other boot or ahead of this one
+inline bool valueSince(const char *cursor, uint32_t &since)
+{
+  char *end;
+  uint32_t epoch = strtoul(cursor, &end, 10);
+  since = 0;
+  if (end == cursor || *end != ':' || epoch != valueEpoch())
   {
-    return DEVICE_MOTION;
+    return false;
   }
-  else if (type == "RELAY")
+  uint32_t seq = strtoul(end + 1, NULL, 10);
+  if (valueSeqAfter(seq, valueSeq()))
   {
-    return DEVICE_RELAY;
+    return false;
   }
-  else if (type == "SWITCH")
+  since = seq;
+  return true;
+}
+
+// str must have WS_VALUE_CURSOR_LEN bytes
+inline void valueCursor(uint32_t seq, char *str)
+{
+  snprintf(str, WS_VALUE_CURSOR_LEN, "%lu:%lu", (unsigned long)valueEpoch(), (unsigned long)seq);
+}
+
+// 0 is left for "before first change" when the counter wraps
+inline void valueStamp(DeviceValue &value)
+{
+  if (++valueSeq() == 0)
   {
-    return DEVICE_SWITCH;
+    ++valueSeq();
   }
-  else if (type == "TEMP_DALLAS")
+  value.seq = valueSeq();
+}
+
+inline void valueInit(DeviceValue &value, DeviceValueKind kind, byte decimals)
+{
+  value.raw = 0;
+  value.kind = kind;
+  value.decimals = decimals > 4 ? 4 : decimals;
+  valueStamp(value);
+}
+
+inline bool valueSetNumber(DeviceValue &value, float number)
+{
+  int32_t raw = lroundf(number * valueScale[value.decimals]);
+  bool changed = raw != value.raw;
+  value.raw = raw;
+  if (changed)
   {
-    return DEVICE_TEMP_DALLAS;
+    valueStamp(value);
   }
-  return DEVICE_UNKNOWN;
+  return changed;
 }
 
-inline String deviceTypetoStr(DeviceType type)
+inline bool valueSetState(DeviceValue &value, bool state)
 {
-  switch (type)
+  bool changed = value.raw != (int32_t)state;
+  value.raw = state;
+  if (changed)
   {
-  case DEVICE_BUTTON:
-    return "BUTTON";
-  case DEVICE_DHT22:
-    return "DHT22";
-  case DEVICE_GENERIC_ANALOG_INPUT:
-    return "GENERIC_ANALOG";
-  case DEVICE_GENERIC_DIGITAL_INPUT:
-    return "GENERIC_DIGITAL";
-  case DEVICE_MOTION:
-    return "MOTION";
-  case DEVICE_RELAY:
-    return "RELAY";
-  case DEVICE_SWITCH:
-    return "SWITCH";
-  case DEVICE_TEMP_DALLAS:
-    return "TEMP_DALLAS";
-  default:
-    return "UNKNOWN";
+    valueStamp(value);
   }
+  return changed;
 }
 
-inline int pinModeFromStr(String &pinMode)
+inline float valueToFloat(const DeviceValue &value)
 {
-  Serial.println(pinMode);  //TODO
+  return (float)value.raw / valueScale[value.decimals];
+}
 
-  if (pinMode == "INPUT")
+// str must have WS_VALUE_STR_LEN bytes
+inline void valueToStr(const DeviceValue &value, char *str)
+{
+  if (value.kind == VALUE_STATE)
   {
-    return 0;
+    strcpy(str, value.raw ? "on" : "off");
   }
-  else if (pinMode == "OUTPUT")
+  else if (value.kind == VALUE_BINARY || value.decimals == 0)
   {
-    return 1;
+    snprintf(str, WS_VALUE_STR_LEN, "%ld", (long)value.raw);
   }
-  else if (pinMode == "INPUT_PULLUP")
-  {
-    return 2;
-  }
-  return 0;
-}
-
-inline String pinModeToStr(int mode)
-{
-  switch (mode)
+  else
   {
-  case 0:
-    return "INPUT";
-  case 1:
-    return "OUTPUT";
-  case 2:
-    return "INPUT_PULLUP";
-  default:
-    return "INPUT";
+    // sign, up to 10 digits, point and up to 4 decimals fit WS_VALUE_STR_LEN, fraction digits are written by hand
+    uint32_t absRaw = value.raw < 0 ? 0UL - (uint32_t)value.raw : (uint32_t)value.raw;
+    uint32_t scale = valueScale[value.decimals];
+    uint32_t fraction = absRaw % scale;
+    byte len = snprintf(str, WS_VALUE_STR_LEN, "%s%lu", value.raw < 0 ? "-" : "", (unsigned long)(absRaw / scale));
+    str[len] = '.';
+    for (byte i = value.decimals; i > 0; i--)
+    {
+      str[len + i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    str[len + value.decimals + 1] = '\0';
   }
 }
 
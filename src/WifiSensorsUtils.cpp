@@ -5,16 +5,140 @@
 
 extern WiFiClient wifiClient;
 
-extern bool deviceConfigUpdated(Hashtable<String, String> *config, Device *dev);
+// outbound callbacks have own socket, wifiClient may belong to request being served
+static WiFiClient callbackClient;
+
+extern bool deviceConfigUpdated(Form *config, Device *dev);
 extern byte deviceValuesNames(DeviceType type, byte deviceId);
 extern void setupNewDevice(byte deviceId, bool update);
+extern unsigned long timeNow(ServerStats &stats);
 
 #ifdef __arm__
+#include <reent.h>
+
 extern "C" char *sbrk(int incr); // Wywołaj z argumentem 0, aby otrzymać początkowy adres wolnej pamięci
 #else
 extern int *__brkval; // Wskaźnik na ostatni zapisany adres kopca (lub 0)
 #endif
 
+#define WS_STACK_PAINT 0xA5A5A5A5UL
+#define WS_STACK_PAINT_MARGIN 256
+
+#if defined(__arm__) && WS_HEAP_STATS
+static HeapStats heapCounters;
+
+// newlib-nano free list, walked to find largest free chunk
+struct MallocChunk
+{
+  long size;
+  MallocChunk *next;
+};
+
+extern "C"
+{
+  extern MallocChunk *__malloc_free_list;
+
+  void *_malloc_r(struct _reent *reent, size_t size);
+  void _free_r(struct _reent *reent, void *ptr);
+  void *_realloc_r(struct _reent *reent, void *ptr, size_t size);
+  void *_calloc_r(struct _reent *reent, size_t count, size_t size);
+  size_t _malloc_usable_size_r(struct _reent *reent, void *ptr);
+}
+
+static void heapCountAlloc(void *ptr)
+{
+  if (ptr == NULL)
+  {
+    heapCounters.failed++;
+    return;
+  }
+  size_t size = _malloc_usable_size_r(_REENT, ptr);
+  heapCounters.allocs++;
+  heapCounters.used += size;
+  heapCounters.allocated += size;
+  if (heapCounters.used > heapCounters.peak)
+  {
+    heapCounters.peak = heapCounters.used;
+  }
+}
+
+static void heapCountFree(void *ptr)
+{
+  if (ptr != NULL)
+  {
+    heapCounters.frees++;
+    heapCounters.used -= _malloc_usable_size_r(_REENT, ptr);
+  }
+}
+
+// replace newlib malloc wrappers, everything (new, String, libraries) goes through them
+extern "C" void *malloc(size_t size)
+{
+  void *ptr = _malloc_r(_REENT, size);
+  heapCountAlloc(ptr);
+  return ptr;
+}
+
+extern "C" void free(void *ptr)
+{
+  heapCountFree(ptr);
+  _free_r(_REENT, ptr);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  void *ptr = _calloc_r(_REENT, count, size);
+  heapCountAlloc(ptr);
+  return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  if (ptr == NULL)
+  {
+    return malloc(size);
+  }
+  if (size == 0)
+  {
+    free(ptr);
+    return NULL;
+  }
+
+  size_t oldSize = _malloc_usable_size_r(_REENT, ptr);
+  void *newPtr = _realloc_r(_REENT, ptr, size);
+  if (newPtr == NULL)
+  {
+    heapCounters.failed++;
+    return NULL;
+  }
+  heapCounters.allocs++;
+  heapCounters.frees++;
+  size_t newSize = _malloc_usable_size_r(_REENT, newPtr);
+  heapCounters.used -= oldSize;
+  heapCounters.used += newSize;
+  heapCounters.allocated += newSize;
+  if (heapCounters.used > heapCounters.peak)
+  {
+    heapCounters.peak = heapCounters.used;
+  }
+  return newPtr;
+}
+#endif
+
+#if WS_ALLOC_CHECK
+static volatile unsigned long heapOps = 0UL;
+
+// newlib takes this lock on every malloc/realloc/free, so counting it catches all heap traffic (String, new, libraries)
+extern "C" void __malloc_lock(struct _reent *reent)
+{
+  heapOps++;
+}
+
+extern "C" void __malloc_unlock(struct _reent *reent)
+{
+}
+#endif
+
 float WifiSensorsUtils::adjustPercent(float original, float adjustment)
 {
   if (adjustment == 0.0)
@@ -24,68 +148,25 @@ float WifiSensorsUtils::adjustPercent(float original, float adjustment)
   return original += adjustment * original;
 }
 
-void WifiSensorsUtils::configToString(Device &dev, String &str)
+void WifiSensorsUtils::configToString(Device &dev, Print &out)
 {
-  str = "{";
-  switch (dev.type)
+  out.print("{");
+  const DeviceDriver *driver = deviceDriver(dev.type);
+  if (driver != NULL)
   {
-  case DEVICE_BUTTON:
-    str += "\"bounce\":";
-    str += dev.config.ints[DEVICE_CONFIG_INTS_DEBOUNCE];
-    break;
-  case DEVICE_DHT22:
-    str += "\"humid_adj\":";
-    str += dev.config.floats[DEVICE_CONFIG_FLOAT_HUMID_ADJ];
-    str += ",\"temp_adj\":";
-    str += dev.config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
-    break;
-  case DEVICE_GENERIC_ANALOG_INPUT:
-    str += "\"min\":";
-    str += dev.config.floats[DEVICE_CONFIG_FLOAT_MIN];
-    str += ",\"max\":";
-    str += dev.config.floats[DEVICE_CONFIG_FLOAT_MAX];
-    str += ",\"readcnt\":";
-    str += dev.config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_CNT];
-    str += ",\"readdelay\":";
-    str += dev.config.ints[DEVICE_CONFIG_INTS_ANALOG_READ_DELAY];
-    str += ",\"removeminmax\":";
-    str += dev.config.bytes[DEVICE_CONFIG_BYTES_ANALOG_READ_REMOVE_MINMAX] == 0x0 ? "\"false\"" : "\"true\"";
-    break;
-  case DEVICE_MOTION:
-    str += "\"bounce\":";
-    str += dev.config.ints[DEVICE_CONFIG_INTS_DEBOUNCE];
-    break;
-  case DEVICE_RELAY:
-    str += "\"trigger\":";
-    str += dev.config.bytes[DEVICE_CONFIG_BYTES_TRIGGER] == 0x0 ? "\"LOW\"" : "\"HIGH\"";
-    break;
-  case DEVICE_SWITCH:
-    str += "\"bounce\":";
-    str += dev.config.ints[DEVICE_CONFIG_INTS_DEBOUNCE];
-    break;
-  case DEVICE_TEMP_DALLAS:
-    str += "\"temp_adj\":";
-    str += dev.config.floats[DEVICE_CONFIG_FLOAT_TEMP_ADJ];
-    break;
+    driver->configToString(dev, out);
   }
-  str += "}";
+  out.print("}");
 }
 
 byte WifiSensorsUtils::deviceRequirePins(DeviceType type)
 {
-  switch (type)
+  const DeviceDriver *driver = deviceDriver(type);
+  if (driver == NULL)
   {
-  case DEVICE_BUTTON:
-  case DEVICE_DHT22:
-  case DEVICE_GENERIC_ANALOG_INPUT:
-  case DEVICE_GENERIC_DIGITAL_INPUT:
-  case DEVICE_MOTION:
-  case DEVICE_RELAY:
-  case DEVICE_SWITCH:
-  case DEVICE_TEMP_DALLAS:
-    return 1;
+    return 0;
   }
-  return 0;
+  return driver->pins;
 }
 
 void WifiSensorsUtils::digitalWriteAnalogPin(int pin, byte value)
@@ -127,175 +208,305 @@ void WifiSensorsUtils::getStatusStr(String &str, ServerStats *stats)
   str += "\",\"mac\":\"";
   str += stats->macStr;
   str += "\",\"ssid\":\"";
-  str += WiFi.SSID();
+  str += stats->link.ssid;
   str += "\",\"ip\":\"";
-  str += WiFi.localIP().toString();
+  str += IPAddress(stats->link.ip).toString();
   str += "\",\"rssi\":\"";
-  str += WiFi.RSSI();
-  str += "\",\"memory\":";
+  str += stats->link.rssi;
+  str += "\",\"link\":{\"status\":";
+  str += stats->link.status;
+  str += ",\"down\":";
+  str += stats->link.down ? "true" : "false";
+  str += ",\"rssi_age\":";
+  str += (millis() - stats->link.lastRssi) / 1000;
+  str += ",\"checks\":";
+  str += stats->link.checks;
+  str += ",\"changes\":";
+  str += stats->link.changes;
+  str += ",\"bssid\":\"";
+  char bssid[18];
+  snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x",
+           stats->link.bssid[5], stats->link.bssid[4], stats->link.bssid[3], stats->link.bssid[2], stats->link.bssid[1], stats->link.bssid[0]);
+  str += bssid;
+  str += "\",\"connects\":";
+  str += stats->link.connects;
+  str += ",\"connect_ms\":";
+  str += stats->link.connectTime;
+  str += ",\"reconnecting\":";
+  str += stats->link.reconnecting ? "true" : "false";
+  str += "},\"boot\":{";
+  for (byte i = 0; i < BOOT_PHASES; i++)
+  {
+    if (i > 0)
+    {
+      str += ",";
+    }
+    str += "\"";
+    str += bootPhaseNames[i];
+    str += "\":";
+    str += stats->boot[i];
+  }
+  str += "},\"memory\":";
   str += stats->freeMem;
-  str += ",\"devices\":";
+  str += ",\"heap\":{\"allocs\":";
+  str += stats->heap.allocs;
+  str += ",\"frees\":";
+  str += stats->heap.frees;
+  str += ",\"failed\":";
+  str += stats->heap.failed;
+  str += ",\"used\":";
+  str += stats->heap.used;
+  str += ",\"peak\":";
+  str += stats->heap.peak;
+  str += ",\"allocated\":";
+  str += stats->heap.allocated;
+  str += ",\"free\":";
+  str += stats->heap.free;
+  str += ",\"largest_free\":";
+  str += stats->heap.largestFree;
+  str += ",\"fragmentation\":";
+  str += stats->heap.fragmentation;
+  str += ",\"stack_gap\":";
+  str += stats->heap.stackGap;
+  str += ",\"stack_low_water\":";
+  str += stats->heap.stackLowWater;
+  str += "}";
+  str += ",\"history_memory\":";
+  str += stats->historyMemory;
+  str += ",\"pools\":[";
+  for (byte i = 0; i < stats->poolsCount; i++)
+  {
+    PoolStats *pool = stats->pools[i];
+    if (i > 0)
+    {
+      str += ",";
+    }
+    str += "{\"name\":\"";
+    str += pool->name;
+    str += "\",\"size\":";
+    str += pool->size;
+    str += ",\"used\":";
+    str += pool->used;
+    str += ",\"peak\":";
+    str += pool->peak;
+    str += ",\"failed\":";
+    str += pool->failed;
+    str += ",\"memory\":";
+    str += pool->size * pool->objectSize;
+    str += "}";
+  }
+  str += "],\"stores\":[";
+  for (byte i = 0; i < stats->storesCount; i++)
+  {
+    PersistStats *store = stats->stores[i];
+    if (i > 0)
+    {
+      str += ",";
+    }
+    str += "{\"name\":\"";
+    str += store->name;
+    str += "\",\"seq\":";
+    str += store->seq;
+    str += ",\"slot\":";
+    str += store->slot;
+    str += ",\"dirty\":";
+    str += store->dirty ? "true" : "false";
+    str += ",\"coalesced\":";
+    str += store->coalesced;
+    str += ",\"commits\":";
+    str += store->commits;
+    str += ",\"skipped\":";
+    str += store->skipped;
+    str += ",\"failed\":";
+    str += store->failed;
+    str += ",\"erases\":";
+    str += store->rowErases;
+    str += ",\"written\":";
+    str += store->bytesWritten;
+    str += ",\"relocated\":";
+    str += store->relocated;
+    str += ",\"max_erases\":";
+    str += store->maxErases;
+    str += ",\"invalid\":";
+    str += store->invalid;
+    str += "}";
+  }
+  str += "],\"devices\":";
   str += stats->devices;
   str += ",\"devices_slow_process\":";
   str += stats->devicesProcessingThresold;
   str += ",\"warnings\":";
   str += stats->processingWarnings;
   str += ",\"last_warn\":\"";
-  str += stats->lastWarning;
+  str += stats->lastWarning.c_str();
   str += "\",\"now\":";
   str += stats->wifiConnectionTime + millis() / 1000;
   str += ",\"connected\":";
   str += stats->wifiConnectionTime;
+#if WS_ALLOC_CHECK
+  str += ",\"alloc_check\":{\"loops\":";
+  str += stats->allocLoops;
+  str += ",\"failed\":";
+  str += stats->allocFailures;
+  str += ",\"last_ops\":";
+  str += stats->allocLastOps;
+  str += "}";
+#endif
   str += "}";
 }
 
-bool WifiSensorsUtils::isCallbackUrlValid(Hashtable<String, String> *config, Callback &callback, bool needDecode)
+unsigned long WifiSensorsUtils::heapOperations()
 {
-  callback.set = false;
-
-  String callbackStr;
-  String callbackAuth;
-
-  if (config->containsKey("callback"))
-  {
-    callbackStr = *config->get("callback");
-    if (needDecode)
-    {
-      callbackStr = decode(callbackStr);
-    }
-  }
+#if WS_ALLOC_CHECK
+  return heapOps;
+#else
+  return 0UL;
+#endif
+}
 
-  if (callbackStr.length() == 0)
-  {
-    return true;
-  }
+const char *WifiSensorsUtils::parseCallbackUrl(Form *config, Callback &callback)
+{
+  callback.set = false;
 
-  if (config->containsKey("auth_header"))
+  const char *url = formGet(*config, FORM_KEY("callback"));
+  if (url == NULL || url[0] == '\0')
   {
-    callbackAuth = *config->get("auth_header");
-    if (needDecode)
-    {
-      callbackAuth.replace("+", " ");
-    }
+    return NULL;
   }
 
-  if (callbackStr.substring(0, 4) == "https")
+  if (strncmp(url, "https", 5) == 0)
   {
-    String msg = String("https not supported");
-    sendError(msg);
-    return false;
+    return "https not supported";
   }
 
-  int pos1, pos2;
-
   // remove prefix
-  pos1 = callbackStr.indexOf("://");
-  if (pos1 > -1)
+  const char *prefix = strstr(url, "://");
+  if (prefix != NULL)
   {
-    callbackStr = callbackStr.substring(pos1 + 3);
+    url = prefix + 3;
   }
 
-  pos1 = callbackStr.indexOf(':');
-  pos2 = callbackStr.indexOf('/');
-  if (pos2 < 1)
+  const char *path = strchr(url, '/');
+  if (path == NULL || path == url)
   {
-    String msg = String("callback invalid") + callbackStr;
-    sendError(msg);
-    return false;
+    return "callback invalid";
   }
-
-  String host;
-  String path;
-  if (pos1 > -1)
+  const char *port = strchr(url, ':');
+  if (port != NULL && port > path)
   {
-    host = callbackStr.substring(0, pos1);
-    String p = callbackStr.substring(pos1 + 1, pos2);
-    callback.port = p.toInt();
+    port = NULL;
   }
-  else
+  size_t hostLen = (port != NULL ? port : path) - url;
+  if (hostLen >= sizeof(callback.host) || strlen(path) >= sizeof(callback.path))
   {
-    host = callbackStr.substring(0, pos2);
-    callback.port = 80;
+    return "callback too long";
   }
-  path = callbackStr.substring(pos2);
 
   callback.set = true;
   memset(callback.host, 0, sizeof(callback.host));
-  strncpy(callback.host, host.c_str(), strlen(host.c_str()));
+  memcpy(callback.host, url, hostLen);
+  callback.port = port != NULL ? atoi(port + 1) : 80;
   memset(callback.path, 0, sizeof(callback.path));
-  strncpy(callback.path, path.c_str(), strlen(path.c_str()));
-  if (callbackAuth.length() > 0)
+  strcpy(callback.path, path);
+  const char *auth = formGet(*config, FORM_KEY("auth_header"));
+  if (auth != NULL && auth[0] != '\0')
   {
     memset(callback.auth, 0, sizeof(callback.auth));
-    strncpy(callback.auth, callbackAuth.c_str(), strlen(callbackAuth.c_str()));
+    strncpy(callback.auth, auth, sizeof(callback.auth) - 1);
   }
 
-  return true;
+  return NULL;
 }
 
-void WifiSensorsUtils::parseConfigFromJson(String &json, Hashtable<String, String> *config)
+// flat object of config values, e.g. {"bounce":20,"trigger":"LOW"}, split in place
+void WifiSensorsUtils::parseConfigFromJson(char *json, Form *config)
 {
-  int pos1, pos2;
-  String tmp, val;
-  json = json.substring(1, json.length() - 1);
-  do
+  formInit(*config);
+  char *p = json;
+  while (p != NULL && (p = strchr(p, '"')) != NULL)
   {
-    pos1 = json.indexOf(",\"");
-    if (pos1 > -1)
+    char *key = p + 1;
+    char *keyEnd = strchr(key, '"');
+    if (keyEnd == NULL || keyEnd[1] != ':')
+    {
+      return;
+    }
+    *keyEnd = '\0';
+    char *value = keyEnd + 2;
+    char *valueEnd;
+    if (*value == '"')
     {
-      tmp = json.substring(0, pos1);
-      json = json.substring(pos1 + 1);
+      value++;
+      valueEnd = strchr(value, '"');
+      p = valueEnd != NULL ? valueEnd + 1 : NULL;
     }
     else
     {
-      tmp = json;
+      valueEnd = strpbrk(value, ",}");
+      p = valueEnd != NULL ? valueEnd + 1 : NULL;
     }
-
-    pos2 = tmp.indexOf("\":");
-    if (pos2 > -1)
+    if (valueEnd != NULL)
     {
-      val = tmp.substring(pos2 + 2);
-      if (val.charAt(0) == '"' && val.charAt(val.length() - 1) == '"')
-      {
-        val = val.substring(1, val.length() - 1);
-      }
-      config->put(tmp.substring(1, pos2), val);
+      *valueEnd = '\0';
     }
-  } while (pos1 > -1);
+    if (!formAdd(*config, formHashStr(key), value))
+    {
+      return;
+    }
+  }
 }
 
-void WifiSensorsUtils::parseConfigFromPayload(String &payload, Hashtable<String, String> *config)
+void WifiSensorsUtils::parseConfigFromPayload(String &payload, Form *config)
 {
+  formParse(*config, payload.begin());
 #if DEBUG
   Serial.println(F("PAYLOAD"));
+  for (byte i = 0; i < config->count; i++)
+  {
+    Serial.print(config->fields[i].key, HEX);
+    Serial.print("=");
+    Serial.println(config->fields[i].value);
+  }
 #endif
+}
 
-  int pos1, pos2;
-  String tmp;
-  do
-  {
-    pos1 = payload.indexOf("&");
-    if (pos1 > -1)
-    {
-      tmp = payload.substring(0, pos1);
-      payload = payload.substring(pos1 + 1);
-    }
-    else
+void WifiSensorsUtils::heapStats(HeapStats &heap)
+{
+  heap.stackGap = memoryFree();
+  heap.free = heap.stackGap;
+  heap.largestFree = heap.stackGap;
+  heap.stackLowWater = heap.stackGap;
+  heap.fragmentation = 0;
+#if defined(__arm__) && WS_HEAP_STATS
+  heap.allocs = heapCounters.allocs;
+  heap.frees = heapCounters.frees;
+  heap.failed = heapCounters.failed;
+  heap.used = heapCounters.used;
+  heap.peak = heapCounters.peak;
+  heap.allocated = heapCounters.allocated;
+
+  for (MallocChunk *chunk = __malloc_free_list; chunk != NULL; chunk = chunk->next)
+  {
+    heap.free += chunk->size;
+    if ((unsigned int)chunk->size > heap.largestFree)
     {
-      tmp = payload;
+      heap.largestFree = chunk->size;
     }
+  }
+  heap.fragmentation = heap.free > 0 ? 100 - (100UL * heap.largestFree / heap.free) : 0;
 
-    pos2 = tmp.indexOf('=');
-    if (pos2 > -1)
-    {
-      config->put(tmp.substring(0, pos2), tmp.substring(pos2 + 1));
-#if DEBUG
-      Serial.print(tmp.substring(0, pos2));
-      Serial.print("=");
-      Serial.println(tmp.substring(pos2 + 1));
+  // painted words still untouched above heap top = lowest gap stack ever left, scan ends at current stack pointer
+  // (heap may be a global, its address is not on the stack)
+  uint32_t *p = reinterpret_cast<uint32_t *>((reinterpret_cast<uintptr_t>(sbrk(0)) + 3) & ~3UL);
+  uint32_t *top = reinterpret_cast<uint32_t *>(reinterpret_cast<uintptr_t>(&p) & ~3UL);
+  unsigned int painted = 0;
+  while (p < top && *p == WS_STACK_PAINT)
+  {
+    painted += sizeof(uint32_t);
+    p++;
+  }
+  heap.stackLowWater = painted;
 #endif
-    }
-  } while (pos1 > -1);
 }
 
 int WifiSensorsUtils::memoryFree()
@@ -316,6 +527,18 @@ int WifiSensorsUtils::memoryFree()
   return freeValue;
 }
 
+void WifiSensorsUtils::paintStack()
+{
+#ifdef __arm__
+  uint32_t *p = reinterpret_cast<uint32_t *>((reinterpret_cast<uintptr_t>(sbrk(0)) + 3) & ~3UL);
+  uint32_t *top = reinterpret_cast<uint32_t *>(reinterpret_cast<uintptr_t>(&p) - WS_STACK_PAINT_MARGIN);
+  while (p < top)
+  {
+    *p++ = WS_STACK_PAINT;
+  }
+#endif
+}
+
 void WifiSensorsUtils::parseParam(String &s, byte cnt, HttpRequest &req)
 {
   int pos = s.indexOf('=');
@@ -359,7 +582,7 @@ void WifiSensorsUtils::parseRequestString(String &s, HttpRequest &req)
           }
 
           j++;
-        } while (pos > -1 && j < 8);
+        } while (pos > -1 && j < WS_MAX_REQUEST_PARAMS);
       }
       else
       {
@@ -388,55 +611,87 @@ void WifiSensorsUtils::printWifiStatus(ServerStats *stats)
   Serial.println(stats->macStr);
 
   Serial.print(F("SSID: "));
-  Serial.println(WiFi.SSID());
+  Serial.println(stats->link.ssid);
 
   Serial.print(F("IP Address: "));
-  Serial.println(WiFi.localIP());
+  Serial.println(IPAddress(stats->link.ip));
 
   Serial.print(F("signal strength (RSSI):"));
-  Serial.print(WiFi.RSSI());
+  Serial.print(stats->link.rssi);
   Serial.println(F(" dBm"));
 
   Serial.print(F("time: "));
   Serial.println(WiFi.getTime());
 }
 
-void WifiSensorsUtils::prepareCallbackValues(char *raw, String &value1, String &path, String &value0Name)
+void WifiSensorsUtils::prepareCallbackValues(const char *raw, const char *value1, CallbackPath &path, const char *value0Name)
 {
-  path = String(raw);
-  String replString = String("<") + value0Name + ">";
-  String strValue1 = String(value1);
-  strValue1 = encode(strValue1);
-  path.replace(replString, strValue1);
+  path = raw;
+  replacePlaceholder(path, value0Name, "", value1);
 }
 
-void WifiSensorsUtils::prepareCallbackValues(char *raw, String &value1, String &value2, String &path, String &value0Name, String &value1Name)
+void WifiSensorsUtils::prepareCallbackPath(const char *raw, DevicesValues &values, byte valuesCount, CallbackPath &path)
 {
-  path = String(raw);
-  String strValue1 = String(value1);
-  String replString = String("<") + value0Name + ">";
-  strValue1 = encode(strValue1);
-  path.replace(replString, strValue1);
-  String strValue2 = String(value2);
-  replString = String("<") + value1Name + ">";
-  strValue2 = encode(strValue2);
-  path.replace(replString, strValue2);
+  path = raw;
+  char str[WS_VALUE_STR_LEN];
+  for (byte j = 0; j < valuesCount; j++)
+  {
+    valueToStr(values.values[j], str);
+    replacePlaceholder(path, values.names[j], "", str);
+  }
+  prepareCallbackStats(path, values, valuesCount);
+}
+
+void WifiSensorsUtils::prepareCallbackStats(CallbackPath &path, DevicesValues &values, byte valuesCount)
+{
+  if (path.indexOf('<') < 0)
+  {
+    return;
+  }
+
+  FixedString<WS_VALUE_STR_LEN> str;
+  unsigned long now = millis();
+  for (byte j = 0; j < valuesCount; j++)
+  {
+    ValueAggregate agg;
+    statsRoll(values.stats[j], now);
+    statsWindow(values.stats[j], 0, agg);
+    str.clear();
+    str.print(agg.min, 2);
+    replacePlaceholder(path, values.names[j], "_min", str.c_str());
+    str.clear();
+    str.print(agg.max, 2);
+    replacePlaceholder(path, values.names[j], "_max", str.c_str());
+    str.clear();
+    str.print(agg.mean, 2);
+    replacePlaceholder(path, values.names[j], "_mean", str.c_str());
+  }
 }
 
 void WifiSensorsUtils::processWarning(Callback &callback, ServerStats &stats)
 {
   if (callback.set)
   {
-    String path;     
-    static String msgTemplate = "msg";
-    prepareCallbackValues(callback.path, stats.lastWarning, path, msgTemplate);
-    if (!sendHttpRequest(callback, path))
+    CallbackPath path;
+    prepareCallbackValues(callback.path, stats.lastWarning.c_str(), path, "msg");
+    if (sendHttpRequest(callback, path.c_str()) != 0)
     {
       Serial.println(F("Process warning failed!"));
     }
   }
 }
 
+void WifiSensorsUtils::pushCallbackToString(Callback &callback, Print &out)
+{
+  if (callback.set)
+  {
+    out.print(callback.host);
+    out.print(":");
+    out.print(callback.port);
+    out.print(callback.path);
+  }
+}
+
 void WifiSensorsUtils::pushCallbackToString(Callback &callback, String &str)
 {
   if (callback.set)
@@ -448,9 +703,22 @@ void WifiSensorsUtils::pushCallbackToString(Callback &callback, String &str)
   }
 }
 
+bool WifiSensorsUtils::readHeader(HttpRequest &req, const char *name, String &value)
+{
+  for (byte i = 0; i < WS_MAX_REQUEST_HEADERS; i++)
+  {
+    if (req.headersNames[i] == name)
+    {
+      value = req.headersValues[i];
+      return true;
+    }
+  }
+  return false;
+}
+
 bool WifiSensorsUtils::readParam(HttpRequest &req, const char *name, String &value)
 {
-  for (byte i = 0; i < 8; i++)
+  for (byte i = 0; i < WS_MAX_REQUEST_PARAMS; i++)
   {
     if (req.paramsNames[i] == name)
     {
@@ -461,13 +729,61 @@ bool WifiSensorsUtils::readParam(HttpRequest &req, const char *name, String &val
   return false;
 }
 
+bool WifiSensorsUtils::readStaticIp(Form *config, ServerConfig &serverConfig)
+{
+  const char *ipStr = formGet(*config, FORM_KEY("ip"));
+  if (ipStr == NULL)
+  {
+    return true;
+  }
+
+  // empty ip switches back to DHCP
+  if (ipStr[0] == '\0')
+  {
+    serverConfig.staticIp = 0;
+    serverConfig.staticGateway = 0;
+    serverConfig.staticSubnet = 0;
+    serverConfig.staticDns = 0;
+    return true;
+  }
+
+  IPAddress ip;
+  if (!ip.fromString(ipStr))
+  {
+    return false;
+  }
+  IPAddress gateway(ip[0], ip[1], ip[2], 1);
+  const char *value = formGet(*config, FORM_KEY("gateway"));
+  if (value != NULL && !gateway.fromString(value))
+  {
+    return false;
+  }
+  IPAddress subnet(255, 255, 255, 0);
+  value = formGet(*config, FORM_KEY("subnet"));
+  if (value != NULL && !subnet.fromString(value))
+  {
+    return false;
+  }
+  IPAddress dns = gateway;
+  value = formGet(*config, FORM_KEY("dns"));
+  if (value != NULL && !dns.fromString(value))
+  {
+    return false;
+  }
+
+  serverConfig.staticIp = (uint32_t)ip;
+  serverConfig.staticGateway = (uint32_t)gateway;
+  serverConfig.staticSubnet = (uint32_t)subnet;
+  serverConfig.staticDns = (uint32_t)dns;
+  return true;
+}
+
 void WifiSensorsUtils::readPayloadData(String &payload)
 {
   while (wifiClient.available())
   {
     payload += char(wifiClient.read());
   }
-  payload = decode(payload);
 #if DEBUG
   Serial.println(F("PAYLOAD"));
   Serial.println(payload);
@@ -509,7 +825,7 @@ bool WifiSensorsUtils::restoreBackup(ServerConfig &serverConfig, Pinout &pinout,
   return ret;
 }
 
-bool WifiSensorsUtils::restoreDevice(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, Pinout &pinout, String str)
+bool WifiSensorsUtils::restoreDevice(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &, Pinout &pinout, String str)
 {
   String tmp;
   if (!findStrInJson(str, "id", tmp))
@@ -572,8 +888,8 @@ bool WifiSensorsUtils::restoreDevice(Devices &devices, Array<DevicesValues, WS_M
   {
     return false;
   }
-  Hashtable<String, String> config;
-  parseConfigFromJson(configStr, &config);
+  Form config;
+  parseConfigFromJson(configStr.begin(), &config);
   String callbackStr;
   if (!findStrInJson(str, "callback", callbackStr))
   {
@@ -585,11 +901,12 @@ bool WifiSensorsUtils::restoreDevice(Devices &devices, Array<DevicesValues, WS_M
     return false;
   }
   callbackauth = decrypt(callbackauth);
-  Hashtable<String, String> callbackConfig;
-  callbackConfig.put("callback", callbackStr);
-  callbackConfig.put("auth_header", callbackauth);
+  Form callbackConfig;
+  formInit(callbackConfig);
+  formAdd(callbackConfig, FORM_KEY("callback"), callbackStr.c_str());
+  formAdd(callbackConfig, FORM_KEY("auth_header"), callbackauth.c_str());
   Callback callback;
-  isCallbackUrlValid(&callbackConfig, callback, false);
+  parseCallbackUrl(&callbackConfig, callback);
   devices.devices[id].pushCallback = callback;
 
   if (!deviceConfigUpdated(&config, &devices.devices[id]))
@@ -664,16 +981,31 @@ bool WifiSensorsUtils::restoreServerConf(ServerConfig &serverConfig, String str,
   }
   callbackauth = decrypt(callbackauth);
 
-  Hashtable<String, String> config;
-  config.put("callback", callbackStr);
-  config.put("auth_header", callbackauth);
+  Form config;
+  formInit(config);
+  formAdd(config, FORM_KEY("callback"), callbackStr.c_str());
+  formAdd(config, FORM_KEY("auth_header"), callbackauth.c_str());
 
   Callback callback;
-  isCallbackUrlValid(&config, callback, false);
+  parseCallbackUrl(&config, callback);
 
-  writeServerConfig(serverConfig, ssid, pass, serverauth, callback);
+  writeServerConfig(serverConfig, ssid.c_str(), pass.c_str(), serverauth.c_str(), callback);
   authHeader = serverauth;
 
+  // static ip is optional in backup
+  const char *ipKeys[] = {"ip", "gateway", "subnet", "dns"};
+  String ipStrs[4];
+  Form ipConfig;
+  formInit(ipConfig);
+  for (byte i = 0; i < 4; i++)
+  {
+    if (findStrInJson(str, ipKeys[i], ipStrs[i]))
+    {
+      formAdd(ipConfig, formHashStr(ipKeys[i]), ipStrs[i].c_str());
+    }
+  }
+  readStaticIp(&ipConfig, serverConfig);
+
   return true;
 }
 
@@ -683,17 +1015,26 @@ void WifiSensorsUtils::sendBackup(ServerConfig &serverConfig, Devices &devices,
   wifiClient.print("\"ssid\":\"");
   wifiClient.print(serverConfig.ssid);
   wifiClient.print("\",\"pass\":\"");
-  wifiClient.print(crypt(String(serverConfig.pass)));
+  crypt(serverConfig.pass, wifiClient);
   wifiClient.print("\",\"serverauth\":\"");
-  wifiClient.print(crypt(String(serverConfig.serverauth)));
+  crypt(serverConfig.serverauth, wifiClient);
   wifiClient.print("\",\"callback\":\"");
-  String callbackStr;
-  pushCallbackToString(serverConfig.callback, callbackStr);
-  wifiClient.print(callbackStr);
+  pushCallbackToString(serverConfig.callback, wifiClient);
   wifiClient.print("\",\"callbackauth\":\"");
   if (serverConfig.callback.set)
   {
-    wifiClient.print(crypt(String(serverConfig.callback.auth)));
+    crypt(serverConfig.callback.auth, wifiClient);
+  }
+  if (linkStaticIp(serverConfig))
+  {
+    wifiClient.print("\",\"ip\":\"");
+    wifiClient.print(IPAddress(serverConfig.staticIp));
+    wifiClient.print("\",\"gateway\":\"");
+    wifiClient.print(IPAddress(serverConfig.staticGateway));
+    wifiClient.print("\",\"subnet\":\"");
+    wifiClient.print(IPAddress(serverConfig.staticSubnet));
+    wifiClient.print("\",\"dns\":\"");
+    wifiClient.print(IPAddress(serverConfig.staticDns));
   }
   wifiClient.print("\"},");
   sendDevices(devices, devicesValues, false, true);
@@ -717,6 +1058,7 @@ void WifiSensorsUtils::sendConfigHtml()
   wifiClient.println("<form action='/creds' method='POST'>");
   wifiClient.println("<p>SSID<input name='ssid' value='' required></p>");
   wifiClient.println("<p>PASSWORD<input name='pass' type='password' value='' required/></p>");
+  wifiClient.println("<p>STATIC IP (puste - DHCP)<input name='ip' value=''/></p>");
   wifiClient.println("<h2>Ustawienia serwera http:</h2>");
   wifiClient.println("<p>AUTH HEADER<input name='serverauth' value=''/></p>");
   wifiClient.println("<p>WARNING CALLBACK<input name='callback' value=''/></p>");
@@ -738,21 +1080,17 @@ void WifiSensorsUtils::sendDevice(Device &dev, DevicesValues &values, bool callb
   wifiClient.print("\",\"poll\":");
   wifiClient.print(dev.pollInterval);
   wifiClient.print(",\"callback\":\"");
-  String callbackStr;
-  WifiSensorsUtils::pushCallbackToString(dev.pushCallback, callbackStr);
-  wifiClient.print(callbackStr);
+  WifiSensorsUtils::pushCallbackToString(dev.pushCallback, wifiClient);
   if (callbackAuth)
   {
     wifiClient.print("\",\"callbackauth\":\"");
     if (dev.pushCallback.set)
     {
-      wifiClient.print(crypt(dev.pushCallback.auth));
+      crypt(dev.pushCallback.auth, wifiClient);
     }
   }
-  String configStr;
-  WifiSensorsUtils::configToString(dev, configStr);
   wifiClient.print("\",\"config\":");
-  wifiClient.print(configStr);
+  WifiSensorsUtils::configToString(dev, wifiClient);
   wifiClient.print(",\"pins\":{");
   for (byte j = 0; j < WifiSensorsUtils::deviceRequirePins(dev.type); j++)
   {
@@ -760,8 +1098,9 @@ void WifiSensorsUtils::sendDevice(Device &dev, DevicesValues &values, bool callb
     {
       wifiClient.print(",");
     }
-    String pinId = String("pin") + (j + 1);
-    wifiClient.print("\"" + pinId + "\":{");
+    wifiClient.print("\"pin");
+    wifiClient.print(j + 1);
+    wifiClient.print("\":{");
     DevicePin dpin = dev.pins[j];
     wifiClient.print("\"pin\":\"");
     wifiClient.print(dpin.type);
@@ -771,6 +1110,7 @@ void WifiSensorsUtils::sendDevice(Device &dev, DevicesValues &values, bool callb
     wifiClient.print("\"}");
   }
 
+  char valueStr[WS_VALUE_STR_LEN];
   wifiClient.print("},\"values\":{");
   for (byte j = 0; j < dev.valuesCount; j++)
   {
@@ -778,10 +1118,11 @@ void WifiSensorsUtils::sendDevice(Device &dev, DevicesValues &values, bool callb
     {
       wifiClient.print(",");
     }
+    valueToStr(values.values[j], valueStr);
     wifiClient.print("\"");
     wifiClient.print(values.names[j]);
     wifiClient.print("\":\"");
-    wifiClient.print(values.values[j]);
+    wifiClient.print(valueStr);
     wifiClient.print("\"");
   }
   wifiClient.print("},\"units\":{");
@@ -823,24 +1164,78 @@ void WifiSensorsUtils::sendDevices(Devices &devices, Array<DevicesValues, WS_MAX
   }
 }
 
+void WifiSensorsUtils::sendDevicesStats(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues)
+{
+  wifiClient.print("{\"stats\":[");
+  for (byte i = 0; i < devices.count; i++)
+  {
+    if (i > 0)
+    {
+      wifiClient.print(",");
+    }
+    sendDeviceStats(devices.devices[i], devicesValues[i]);
+  }
+  wifiClient.println("]}");
+}
+
 void WifiSensorsUtils::sendDevicesTypes()
 {
+  bool first = true;
   wifiClient.print("{\"types\":[");
   for (int i = 0; i != DEVICE_UNKNOWN; i++)
   {
-    if (i > 0)
+    const DeviceDriver *driver = deviceDriver(static_cast<DeviceType>(i));
+    if (driver == NULL)
+    {
+      continue;
+    }
+    if (!first)
     {
       wifiClient.print(",");
     }
+    first = false;
 
-    DeviceType t = static_cast<DeviceType>(i);
     wifiClient.print("{\"name\":\"");
-    wifiClient.print(deviceTypetoStr(t));
+    wifiClient.print(driver->name);
     wifiClient.print("\"}");
   }
   wifiClient.println("]}");
 }
 
+void WifiSensorsUtils::sendDeviceStats(Device &dev, DevicesValues &values)
+{
+  unsigned long now = millis();
+  wifiClient.print("{\"id\":\"");
+  wifiClient.print(dev.deviceId);
+  wifiClient.print("\",\"values\":{");
+  for (byte j = 0; j < dev.valuesCount; j++)
+  {
+    if (j > 0)
+    {
+      wifiClient.print(",");
+    }
+    statsRoll(values.stats[j], now);
+    wifiClient.print("\"");
+    wifiClient.print(values.names[j]);
+    wifiClient.print("\":{");
+    for (byte k = 0; k < WS_STATS_WINDOWS; k++)
+    {
+      if (k > 0)
+      {
+        wifiClient.print(",");
+      }
+      wifiClient.print("\"");
+      wifiClient.print(statsWindowsMs[k] / 1000);
+      wifiClient.print("\":");
+      ValueAggregate agg;
+      statsWindow(values.stats[j], k, agg);
+      sendValueAggregate(agg, statsWindowSpan(values.stats[j], k, now));
+    }
+    wifiClient.print("}");
+  }
+  wifiClient.print("}}");
+}
+
 void WifiSensorsUtils::sendError(const char *msg)
 {
   wifiClient.println();
@@ -855,19 +1250,92 @@ void WifiSensorsUtils::sendHeader(const char *code, const char *contentType)
   wifiClient.print("HTTP/1.1 ");
   wifiClient.println(code);
   wifiClient.println("Connection: close");
-  if (contentType != "")
+  if (contentType[0] != '\0')
   {
     wifiClient.print("Content-Type: ");
     wifiClient.println(contentType);
   }
 }
 
-byte WifiSensorsUtils::sendHttpRequest(Callback &callback, String path)
+void WifiSensorsUtils::sendHistory(Device &dev, DevicesValues &values, ValueHistory *history, unsigned long from, int res)
+{
+  // one column per value, rings are merged by time, partial is 1 for bucket still in progress
+  wifiClient.print("time");
+  for (byte j = 0; j < dev.valuesCount; j++)
+  {
+    wifiClient.print(",");
+    wifiClient.print(values.names[j]);
+  }
+  wifiClient.println(",partial");
+
+  byte age[WS_MAX_DEVICE_VALUES];
+  for (byte j = 0; j < dev.valuesCount; j++)
+  {
+    age[j] = 0;
+  }
+  while (true)
+  {
+    bool found = false;
+    unsigned long time = 0;
+    for (byte j = 0; j < dev.valuesCount; j++)
+    {
+      unsigned long entryTime;
+      float value;
+      bool partial;
+      if (historyEntry(history[j], res, age[j], entryTime, value, partial) && (!found || entryTime < time))
+      {
+        found = true;
+        time = entryTime;
+      }
+    }
+    if (!found)
+    {
+      break;
+    }
+
+    bool partialRow = false;
+    bool empty = true;
+    float rowValues[WS_MAX_DEVICE_VALUES];
+    for (byte j = 0; j < dev.valuesCount; j++)
+    {
+      unsigned long entryTime;
+      bool partial;
+      rowValues[j] = NAN;
+      if (historyEntry(history[j], res, age[j], entryTime, rowValues[j], partial) && entryTime == time)
+      {
+        age[j]++;
+        partialRow = partialRow || partial;
+        empty = empty && isnan(rowValues[j]);
+      }
+      else
+      {
+        rowValues[j] = NAN;
+      }
+    }
+    if (time < from || empty)
+    {
+      continue;
+    }
+
+    wifiClient.print(time);
+    for (byte j = 0; j < dev.valuesCount; j++)
+    {
+      wifiClient.print(",");
+      if (!isnan(rowValues[j]))
+      {
+        wifiClient.print(rowValues[j]);
+      }
+    }
+    wifiClient.println(partialRow ? ",1" : ",0");
+  }
+}
+
+byte WifiSensorsUtils::sendHttpRequest(Callback &callback, const char *path)
 {
-  // wait for client to finish processing
+  // wait for previous callback to finish processing
   for (byte i = 0; i < 20; i++)
   {
-    if (wifiClient.connected())
+    if (callbackClient.connected())
     {
 #if DEBUG
       Serial.print(F("Wait for client to close "));
@@ -881,27 +1349,27 @@ byte WifiSensorsUtils::sendHttpRequest(Callback &callback, String path)
     }
   }
 
-  wifiClient.stop();
+  callbackClient.stop();
 
-  if (wifiClient.connect(callback.host, callback.port))
+  if (callbackClient.connect(callback.host, callback.port))
   {
     Serial.print(millis());
     Serial.print(F(" Sending: "));
     Serial.println(path);
 
-    wifiClient.print("GET ");
-    wifiClient.print(path);
-    wifiClient.println(" HTTP/1.1");
-    wifiClient.print("Host: ");
-    wifiClient.println(callback.host);
-    wifiClient.println("User-Agent: ArduinoWiFi/1.1");
-    if (callback.auth != "")
+    callbackClient.print("GET ");
+    callbackClient.print(path);
+    callbackClient.println(" HTTP/1.1");
+    callbackClient.print("Host: ");
+    callbackClient.println(callback.host);
+    callbackClient.println("User-Agent: ArduinoWiFi/1.1");
+    if (callback.auth[0] != '\0')
     {
-      wifiClient.print("Authorization: ");
-      wifiClient.println(callback.auth);
+      callbackClient.print("Authorization: ");
+      callbackClient.println(callback.auth);
     }
-    wifiClient.println("Connection: close");
-    wifiClient.println();
+    callbackClient.println("Connection: close");
+    callbackClient.println();
     return 0;
   }
 
@@ -912,6 +1380,23 @@ byte WifiSensorsUtils::sendHttpRequest(Callback &callback, String path)
   return 1;
 }
 
+void WifiSensorsUtils::sendLatencyHistogram(LatencyHistogram &histogram)
+{
+  wifiClient.print("{\"count\":");
+  wifiClient.print(histogram.count);
+  wifiClient.print(",\"mean\":");
+  wifiClient.print(histogram.count > 0 ? (unsigned long)(histogram.total / histogram.count) : 0UL);
+  wifiClient.print(",\"p50\":");
+  wifiClient.print(histogramPercentile(histogram, 50));
+  wifiClient.print(",\"p90\":");
+  wifiClient.print(histogramPercentile(histogram, 90));
+  wifiClient.print(",\"p99\":");
+  wifiClient.print(histogramPercentile(histogram, 99));
+  wifiClient.print(",\"max\":");
+  wifiClient.print(histogram.max);
+  wifiClient.print("}");
+}
+
 void WifiSensorsUtils::sendPinout(Pinout &pinout)
 {
   wifiClient.print("{");
@@ -988,6 +1473,75 @@ void WifiSensorsUtils::sendPinsValues()
   wifiClient.println("}");
 }
 
+void WifiSensorsUtils::sendValueAggregate(ValueAggregate &agg, unsigned long span)
+{
+  wifiClient.print("{\"span\":");
+  wifiClient.print(span / 1000);
+  wifiClient.print(",\"count\":");
+  wifiClient.print(agg.count);
+  wifiClient.print(",\"min\":");
+  wifiClient.print(agg.min);
+  wifiClient.print(",\"max\":");
+  wifiClient.print(agg.max);
+  wifiClient.print(",\"mean\":");
+  wifiClient.print(agg.mean);
+  wifiClient.print(",\"var\":");
+  wifiClient.print(statsAggregateVariance(agg));
+  wifiClient.print("}");
+}
+
+void WifiSensorsUtils::sendProfile(LoopProfile &profile, Devices &devices, DeviceProfile *devicesProfile)
+{
+  unsigned long elapsed = millis() - profile.since;
+  wifiClient.print("{\"since\":");
+  wifiClient.print(elapsed / 1000);
+  wifiClient.print(",\"loops\":");
+  wifiClient.print(profile.loops);
+  wifiClient.print(",\"loop_hz\":");
+  wifiClient.print(elapsed > 0 ? profile.loops * 1000.0 / elapsed : 0.0);
+  wifiClient.print(",\"stages\":{");
+  for (byte i = 0; i < LOOP_STAGES; i++)
+  {
+    if (i > 0)
+    {
+      wifiClient.print(",");
+    }
+    wifiClient.print("\"");
+    wifiClient.print(loopStageNames[i]);
+    wifiClient.print("\":");
+    sendLatencyHistogram(profile.stages[i]);
+  }
+  wifiClient.print("},\"devices\":{");
+  bool first = true;
+  for (byte i = 0; i < devices.count; i++)
+  {
+    if (!devices.devices[i].active)
+    {
+      continue;
+    }
+    if (!first)
+    {
+      wifiClient.print(",");
+    }
+    first = false;
+    DeviceProfile &deviceProfile = devicesProfile[i];
+    wifiClient.print("\"");
+    wifiClient.print(i);
+    wifiClient.print("\":{\"type\":\"");
+    wifiClient.print(deviceTypetoStr(devices.devices[i].type));
+    wifiClient.print("\",\"read\":");
+    sendLatencyHistogram(deviceProfile.read);
+    wifiClient.print(",\"read_failures\":");
+    wifiClient.print(deviceProfile.readFailures);
+    wifiClient.print(",\"push\":");
+    sendLatencyHistogram(deviceProfile.push);
+    wifiClient.print(",\"push_failures\":");
+    wifiClient.print(deviceProfile.pushFailures);
+    wifiClient.print("}");
+  }
+  wifiClient.println("}}");
+}
+
 void WifiSensorsUtils::sendStatusOk()
 {
   wifiClient.println();
@@ -1051,9 +1605,33 @@ void WifiSensorsUtils::serverConfigToString(ServerConfig &serverConfig, String &
   {
     str += "(redacted)";
   }
+  str += "\",\"ip\":\"";
+  if (linkStaticIp(serverConfig))
+  {
+    str += IPAddress(serverConfig.staticIp).toString();
+    str += "\",\"gateway\":\"";
+    str += IPAddress(serverConfig.staticGateway).toString();
+    str += "\",\"subnet\":\"";
+    str += IPAddress(serverConfig.staticSubnet).toString();
+    str += "\",\"dns\":\"";
+    str += IPAddress(serverConfig.staticDns).toString();
+  }
   str += "\"}";
 }
 
+void WifiSensorsUtils::replacePlaceholder(CallbackPath &path, const char *name, const char *suffix, const char *value)
+{
+  FixedString<WS_CALLBACK_PLACEHOLDER_LEN> placeholder;
+  placeholder.print("<");
+  placeholder.print(name);
+  placeholder.print(suffix);
+  placeholder.print(">");
+
+  char encoded[WS_WARNING_LEN * 3 + 1];
+  encode(value, encoded, sizeof(encoded));
+  path.replace(placeholder.c_str(), encoded);
+}
+
 void WifiSensorsUtils::setAnalogPinMode(int pin, int mode)
 {
   switch (pin)
@@ -1085,6 +1663,7 @@ void WifiSensorsUtils::setAnalogPinMode(int pin, int mode)
   case 6:
     pinMode(A6, mode == 0 ? INPUT : mode == 1 ? OUTPUT
                                               : INPUT_PULLUP);
+    break;
   case 7:
     pinMode(A7, mode == 0 ? INPUT : mode == 1 ? OUTPUT
                                               : INPUT_PULLUP);
@@ -1119,6 +1698,24 @@ void WifiSensorsUtils::setPinMode(Pinout &pinout, DevicePin &pin)
   pinout.set = true;
 }
 
+void WifiSensorsUtils::setWarning(ServerStats &stats, const __FlashStringHelper *msg, const char *detail)
+{
+  stats.lastWarning.clear();
+  stats.lastWarning.print(msg);
+  stats.lastWarning.print(detail);
+  stats.lastWarning.print(" ");
+  stats.lastWarning.print(timeNow(stats));
+}
+
+void WifiSensorsUtils::setWarning(ServerStats &stats, const __FlashStringHelper *msg, long detail)
+{
+  stats.lastWarning.clear();
+  stats.lastWarning.print(msg);
+  stats.lastWarning.print(detail);
+  stats.lastWarning.print(" ");
+  stats.lastWarning.print(timeNow(stats));
+}
+
 void WifiSensorsUtils::setPinValue(char pinType, int pin, byte value)
 {
   if (pinType == 'D')
@@ -1153,8 +1750,8 @@ bool WifiSensorsUtils::statusAuthorizationForbidden(String &serverauth, HttpRequ
       sendStatusForbidden();
       return true;
     }
-    return false;
   }
+  return false;
 }
 
 void WifiSensorsUtils::unsetPinMode(Pinout &pinout, DevicePin &pin)
@@ -1169,37 +1766,34 @@ void WifiSensorsUtils::unsetPinMode(Pinout &pinout, DevicePin &pin)
   }
 }
 
-int WifiSensorsUtils::waitForWiFiStatus()
+void WifiSensorsUtils::writeServerConfig(ServerConfig &serverConfig, const char *ssid, const char *pass, const char *serverauth, Callback &callback)
 {
-  unsigned long start = millis();
-  while((!WiFi.status() || WiFi.status() >= WL_DISCONNECTED) && (millis() - start) < 1000)
+  if (!serverConfig.set)
   {
-    delay(100);
+    serverConfig.staticIp = 0;
+    serverConfig.staticGateway = 0;
+    serverConfig.staticSubnet = 0;
+    serverConfig.staticDns = 0;
   }
-  return WiFi.status();
-}
-
-void WifiSensorsUtils::writeServerConfig(ServerConfig &serverConfig, String &ssid, String &pass, String &serverauth, Callback &callback)
-{
   serverConfig.set = true;
   serverConfig.valid = false;
   memset(serverConfig.ssid, 0, sizeof(serverConfig.ssid));
-  strncpy(serverConfig.ssid, ssid.c_str(), strlen(ssid.c_str()));
+  strncpy(serverConfig.ssid, ssid, sizeof(serverConfig.ssid) - 1);
   Serial.print("Zapisano SSID: ");
   Serial.println(serverConfig.ssid);
 
-  if (pass.length() > 0)
+  if (pass[0] != '\0')
   {
     memset(serverConfig.pass, 0, sizeof(serverConfig.pass));
-    strncpy(serverConfig.pass, pass.c_str(), strlen(pass.c_str()));
+    strncpy(serverConfig.pass, pass, sizeof(serverConfig.pass) - 1);
   }
   if (callback.set)
   {
     serverConfig.callback = callback;
   }
-  if (serverauth.length() > 0)
+  if (serverauth[0] != '\0')
   {
     memset(serverConfig.serverauth, 0, sizeof(serverConfig.serverauth));
-    strncpy(serverConfig.serverauth, serverauth.c_str(), strlen(serverauth.c_str()));
+    strncpy(serverConfig.serverauth, serverauth, sizeof(serverConfig.serverauth) - 1);
   }
 }
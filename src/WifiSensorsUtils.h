@@ -1,10 +1,15 @@
 #ifndef WIFISENSORS_UTILS_H
 #define WIFISENSORS_UTILS_H
 
+#include "WifiSensorsDrivers.h"
+#include "WifiSensorsForm.h"
+#include "WifiSensorsHistory.h"
+#include "WifiSensorsLink.h"
+#include "WifiSensorsProfile.h"
+#include "WifiSensorsStats.h"
 #include "WifiSensorsTypes.h"
 #include "parsers.h"
 
-#include <Hashtable.h>
 #include <WiFiNINA.h>
 
 class WifiSensorsUtils
@@ -12,7 +17,7 @@ class WifiSensorsUtils
 public:
   static float adjustPercent(float original, float adjustment);
 
-  static void configToString(Device &dev, String &str);
+  static void configToString(Device &dev, Print &out);
 
   static byte deviceRequirePins(DeviceType type);
 
@@ -20,13 +25,20 @@ public:
 
   static void getStatusStr(String &str, ServerStats *stats);
 
-  static bool isCallbackUrlValid(Hashtable<String, String> *config, Callback &callback, bool needDecode);
+  static unsigned long heapOperations();
+
+  static void heapStats(HeapStats &heap);
 
   static int memoryFree();
 
-  static void parseConfigFromJson(String &json, Hashtable<String, String> *config);
+  static void paintStack();
+
+  // callback from form fields callback and auth_header, returns error or NULL, not set when form has no callback
+  static const char *parseCallbackUrl(Form *config, Callback &callback);
+
+  static void parseConfigFromJson(char *json, Form *config);
 
-  static void parseConfigFromPayload(String &payload, Hashtable<String, String> *config);
+  static void parseConfigFromPayload(String &payload, Form *config);
 
   static void parseParam(String &s, byte cnt, HttpRequest &req);
 
@@ -34,20 +46,30 @@ public:
 
   static bool pinUsedByDevice(Pinout &pinout, String &pinId);
 
-  static void prepareCallbackValues(char *raw, String &value1, String &path, String &value0Name);
+  static void prepareCallbackValues(const char *raw, const char *value1, CallbackPath &path, const char *value0Name);
 
-  static void prepareCallbackValues(char *raw, String &value1, String &value2, String &path, String &value0Name, String &value1Name);
+  static void prepareCallbackPath(const char *raw, DevicesValues &values, byte valuesCount, CallbackPath &path);
+
+  static void prepareCallbackStats(CallbackPath &path, DevicesValues &values, byte valuesCount);
 
   static void processWarning(Callback &callback, ServerStats &stats);
 
+  static void pushCallbackToString(Callback &callback, Print &out);
+
   static void pushCallbackToString(Callback &callback, String &str);
 
   static void printWifiStatus(ServerStats *stats);
 
+  static void replacePlaceholder(CallbackPath &path, const char *name, const char *suffix, const char *value);
+
+  static bool readHeader(HttpRequest &req, const char *name, String &value);
+
   static bool readParam(HttpRequest &req, const char *name, String &value);
 
   static void readPayloadData(String &payload);
 
+  static bool readStaticIp(Form *config, ServerConfig &serverConfig);
+
   static bool restoreBackup(ServerConfig &serverConfig, Pinout &pinout, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, String &str, String &authHeader);
 
   static void sendBackup(ServerConfig &serverConfig, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues);
@@ -66,8 +88,14 @@ public:
 
   static void sendDevices(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, bool jsonPrefix, bool callbackAuth);
 
+  static void sendDevicesStats(Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues);
+
   static void sendDevicesTypes();
 
+  static void sendDeviceStats(Device &dev, DevicesValues &values);
+
+  static void sendValueAggregate(ValueAggregate &agg, unsigned long span);
+
   static void sendError(const char *msg);
 
   static void sendError(String &msg)
@@ -77,12 +105,19 @@ public:
 
   static void sendHeader(const char *code, const char *contentType);
 
-  static byte sendHttpRequest(Callback &callback, String path);
+  static void sendHistory(Device &dev, DevicesValues &values, ValueHistory *history, unsigned long from, int res);
+
+  // 0 when request was sent, 1 when connection failed
+  static byte sendHttpRequest(Callback &callback, const char *path);
+
+  static void sendLatencyHistogram(LatencyHistogram &histogram);
 
   static void sendPinout(Pinout &pinout);
 
   static void sendPinsValues();
 
+  static void sendProfile(LoopProfile &profile, Devices &devices, DeviceProfile *devicesProfile);
+
   static void sendStatusOk();
 
   static void sendStatusForbidden();
@@ -95,15 +130,17 @@ public:
 
   static void setPinMode(Pinout &pinout, DevicePin &pin);
 
+  static void setWarning(ServerStats &stats, const __FlashStringHelper *msg, const char *detail);
+
+  static void setWarning(ServerStats &stats, const __FlashStringHelper *msg, long detail);
+
   static void setPinValue(char pinType, int pin, byte value);
 
   static bool statusAuthorizationForbidden(String &serverauth, HttpRequest &req);
 
   static void unsetPinMode(Pinout &pinout, DevicePin &pin);
 
-  static int waitForWiFiStatus();
-
-  static void writeServerConfig(ServerConfig &serverConfig, String &ssid, String &pass, String &serverauth, Callback &callback);
+  static void writeServerConfig(ServerConfig &serverConfig, const char *ssid, const char *pass, const char *serverauth, Callback &callback);
 };
 
 #endif
@@ -0,0 +1,411 @@
+#ifndef WIFISENSORS_WEBSOCKET_H
+#define WIFISENSORS_WEBSOCKET_H
+
+/*
+WebSocket (RFC 6455) on GET /ws of the same server, for value changes and commands over one connection.
+Value changes are sent like /events (change sequence cursor per client, in sequence order, latest state only), one text frame
+per change: {"seq":"epoch:seq","id":"..","name":"..","value":".."}, frames of one loop go out in one write of at most WS_WEBSOCKET_BUFFER bytes.
+Client sends url-encoded command in text frame (cmd=turnon&id=3, cmd=set&id=D5, cmd=config&id=2&interval=1000...),
+it is parsed in place and handed to command callback, which writes reply frame payload.
+Frames from client must be masked, not fragmented and fit WS_WEBSOCKET_RX bytes, otherwise connection is closed.
+*/
+
+#include "WifiSensorsEvents.h"
+#include "WifiSensorsForm.h"
+#include "WifiSensorsTypes.h"
+
+#include <WiFiNINA.h>
+
+#ifndef WS_WEBSOCKET_CLIENTS
+#define WS_WEBSOCKET_CLIENTS 2
+#endif
+#ifndef WS_WEBSOCKET_RX
+#define WS_WEBSOCKET_RX 160
+#endif
+#ifndef WS_WEBSOCKET_BUFFER
+#define WS_WEBSOCKET_BUFFER 512
+#endif
+#ifndef WS_WEBSOCKET_REPLY
+#define WS_WEBSOCKET_REPLY 96
+#endif
+
+#define WS_WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+// Sec-WebSocket-Accept value length with NUL
+#define WS_WEBSOCKET_ACCEPT_LEN 29
+
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+#define WS_CLOSE_NORMAL 1000
+#define WS_CLOSE_PROTOCOL 1002
+#define WS_CLOSE_UNSUPPORTED 1003
+#define WS_CLOSE_TOO_BIG 1009
+
+// reply is payload of text frame sent back
+typedef void (*WebSocketCommand)(Form &command, Print &reply);
+
+typedef struct
+{
+  bool active;
+  WiFiClient client;
+  // sequence of last sent change
+  uint32_t seq;
+  uint16_t rxLen;
+  byte rx[WS_WEBSOCKET_RX];
+} WebSocketClient;
+
+typedef struct
+{
+  byte clients;
+  unsigned long sent;
+  unsigned long commands;
+  WebSocketClient client[WS_WEBSOCKET_CLIENTS];
+} WebSockets;
+
+inline uint32_t wsRotate(uint32_t value, byte bits)
+{
+  return (value << bits) | (value >> (32 - bits));
+}
+
+inline void wsSha1Block(uint32_t *hash, const byte *block)
+{
+  uint32_t w[16];
+  for (byte i = 0; i < 16; i++)
+  {
+    w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+  uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3], e = hash[4];
+  for (byte t = 0; t < 80; t++)
+  {
+    if (t >= 16)
+    {
+      w[t & 15] = wsRotate(w[(t + 13) & 15] ^ w[(t + 8) & 15] ^ w[(t + 2) & 15] ^ w[t & 15], 1);
+    }
+    uint32_t f, k;
+    if (t < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999UL;
+    }
+    else if (t < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1UL;
+    }
+    else if (t < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDCUL;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6UL;
+    }
+    uint32_t temp = wsRotate(a, 5) + f + e + k + w[t & 15];
+    e = d;
+    d = c;
+    c = wsRotate(b, 30);
+    b = a;
+    a = temp;
+  }
+  hash[0] += a;
+  hash[1] += b;
+  hash[2] += c;
+  hash[3] += d;
+  hash[4] += e;
+}
+
+inline void wsSha1(const byte *data, size_t len, byte *digest)
+{
+  uint32_t hash[5] = {0x67452301UL, 0xEFCDAB89UL, 0x98BADCFEUL, 0x10325476UL, 0xC3D2E1F0UL};
+  size_t done = 0;
+  for (; done + 64 <= len; done += 64)
+  {
+    wsSha1Block(hash, data + done);
+  }
+
+  // padding: 0x80, zeros, length in bits big endian in last 8 bytes
+  byte block[64];
+  size_t rest = len - done;
+  memset(block, 0, sizeof(block));
+  memcpy(block, data + done, rest);
+  block[rest] = 0x80;
+  if (rest >= 56)
+  {
+    wsSha1Block(hash, block);
+    memset(block, 0, sizeof(block));
+  }
+  uint64_t bits = (uint64_t)len * 8;
+  for (byte i = 0; i < 8; i++)
+  {
+    block[63 - i] = (byte)(bits >> (8 * i));
+  }
+  wsSha1Block(hash, block);
+
+  for (byte i = 0; i < 20; i++)
+  {
+    digest[i] = (byte)(hash[i / 4] >> (24 - 8 * (i % 4)));
+  }
+}
+
+// out must have 4 * ((len + 2) / 3) + 1 bytes
+inline void wsBase64(const byte *data, size_t len, char *out)
+{
+  const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < len; i += 3)
+  {
+    uint32_t chunk = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0) | (i + 2 < len ? data[i + 2] : 0);
+    *out++ = alphabet[(chunk >> 18) & 0x3F];
+    *out++ = alphabet[(chunk >> 12) & 0x3F];
+    *out++ = i + 1 < len ? alphabet[(chunk >> 6) & 0x3F] : '=';
+    *out++ = i + 2 < len ? alphabet[chunk & 0x3F] : '=';
+  }
+  *out = '\0';
+}
+
+// Sec-WebSocket-Accept for Sec-WebSocket-Key, false when key is not 24 chars long
+inline bool wsAcceptKey(const char *key, char *accept)
+{
+  char buf[24 + sizeof(WS_WEBSOCKET_GUID)];
+  if (strlen(key) != 24)
+  {
+    return false;
+  }
+  memcpy(buf, key, 24);
+  memcpy(buf + 24, WS_WEBSOCKET_GUID, sizeof(WS_WEBSOCKET_GUID));
+  byte digest[20];
+  wsSha1((const byte *)buf, strlen(buf), digest);
+  wsBase64(digest, sizeof(digest), accept);
+  return true;
+}
+
+// server frames are never masked
+inline void wsFrame(Print &out, byte opcode, const byte *payload, size_t len)
+{
+  out.write(0x80 | opcode);
+  if (len < 126)
+  {
+    out.write((byte)len);
+  }
+  else
+  {
+    out.write(126);
+    out.write((byte)(len >> 8));
+    out.write((byte)len);
+  }
+  out.write(payload, len);
+}
+
+inline bool wsAccept(WebSockets &sockets, WiFiClient &client, uint32_t seq)
+{
+  for (byte i = 0; i < WS_WEBSOCKET_CLIENTS; i++)
+  {
+    WebSocketClient &socket = sockets.client[i];
+    if (!socket.active)
+    {
+      socket.active = true;
+      socket.client = client;
+      socket.seq = seq;
+      socket.rxLen = 0;
+      sockets.clients++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// true when client is open WebSocket connection
+inline bool wsOwns(WebSockets &sockets, WiFiClient &client)
+{
+  for (byte i = 0; i < WS_WEBSOCKET_CLIENTS; i++)
+  {
+    if (sockets.client[i].active && sockets.client[i].client == client)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void wsDrop(WebSockets &sockets, WebSocketClient &socket)
+{
+  socket.client.stop();
+  socket.active = false;
+  sockets.clients--;
+}
+
+inline void wsClose(WebSockets &sockets, WebSocketClient &socket, uint16_t code)
+{
+  byte frame[4] = {0x80 | WS_OPCODE_CLOSE, 2, (byte)(code >> 8), (byte)code};
+  socket.client.write(frame, sizeof(frame));
+  wsDrop(sockets, socket);
+}
+
+// handles whole frames in rx buffer while there is room for reply in out, returns false when connection was closed
+template <size_t N>
+bool wsReceive(WebSockets &sockets, WebSocketClient &socket, FixedString<N> &out, WebSocketCommand command)
+{
+  int available = socket.client.available();
+  if (available > 0 && socket.rxLen < WS_WEBSOCKET_RX)
+  {
+    size_t len = WS_WEBSOCKET_RX - socket.rxLen;
+    len = (size_t)available < len ? available : len;
+    int read = socket.client.read(socket.rx + socket.rxLen, len);
+    socket.rxLen += read > 0 ? read : 0;
+  }
+
+  // pong echoes up to WS_WEBSOCKET_RX bytes, 4 bytes of frame header
+  while (socket.rxLen >= 2 && out.length() + WS_WEBSOCKET_RX + 4 <= out.capacity())
+  {
+    byte opcode = socket.rx[0] & 0x0F;
+    bool fin = socket.rx[0] & 0x80;
+    bool masked = socket.rx[1] & 0x80;
+    size_t len = socket.rx[1] & 0x7F;
+    size_t header = 2;
+    if (len == 126)
+    {
+      if (socket.rxLen < 4)
+      {
+        return true;
+      }
+      len = (size_t)socket.rx[2] << 8 | socket.rx[3];
+      header = 4;
+    }
+    else if (len == 127)
+    {
+      wsClose(sockets, socket, WS_CLOSE_TOO_BIG);
+      return false;
+    }
+    if (!masked)
+    {
+      wsClose(sockets, socket, WS_CLOSE_PROTOCOL);
+      return false;
+    }
+    if (!fin || opcode == 0x0)
+    {
+      wsClose(sockets, socket, WS_CLOSE_UNSUPPORTED);
+      return false;
+    }
+    // one byte more for NUL of text payload
+    if (header + 4 + len + 1 > WS_WEBSOCKET_RX)
+    {
+      wsClose(sockets, socket, WS_CLOSE_TOO_BIG);
+      return false;
+    }
+    if (socket.rxLen < header + 4 + len)
+    {
+      return true;
+    }
+
+    byte *mask = socket.rx + header;
+    byte *payload = mask + 4;
+    for (size_t i = 0; i < len; i++)
+    {
+      payload[i] ^= mask[i & 3];
+    }
+
+    if (opcode == WS_OPCODE_CLOSE)
+    {
+      wsClose(sockets, socket, WS_CLOSE_NORMAL);
+      return false;
+    }
+    else if (opcode == WS_OPCODE_PING)
+    {
+      wsFrame(out, WS_OPCODE_PONG, payload, len);
+    }
+    else if (opcode == WS_OPCODE_TEXT)
+    {
+      // form values point into rx, reply is written before frame is removed
+      char end = payload[len];
+      payload[len] = '\0';
+      Form form;
+      formParse(form, (char *)payload);
+      FixedString<WS_WEBSOCKET_REPLY> reply;
+      command(form, reply);
+      payload[len] = end;
+      wsFrame(out, WS_OPCODE_TEXT, (const byte *)reply.c_str(), reply.length());
+      sockets.commands++;
+    }
+
+    size_t frame = header + 4 + len;
+    memmove(socket.rx, socket.rx + frame, socket.rxLen - frame);
+    socket.rxLen -= frame;
+  }
+  return true;
+}
+
+inline void wsFormatChange(Print &out, Device &dev, DevicesValues &values, byte value)
+{
+  char valueStr[WS_VALUE_STR_LEN];
+  char cursor[WS_VALUE_CURSOR_LEN];
+  valueToStr(values.values[value], valueStr);
+  valueCursor(values.values[value].seq, cursor);
+  out.print("{\"seq\":\"");
+  out.print(cursor);
+  out.print("\",\"id\":\"");
+  out.print(dev.deviceId);
+  out.print("\",\"name\":\"");
+  out.print(values.names[value]);
+  out.print("\",\"value\":\"");
+  out.print(valueStr);
+  out.print("\"}");
+}
+
+// answers commands and sends value changes of every client
+inline void wsPump(WebSockets &sockets, Devices &devices, Array<DevicesValues, WS_MAX_DEVICES> &devicesValues, WebSocketCommand command)
+{
+  for (byte i = 0; i < WS_WEBSOCKET_CLIENTS; i++)
+  {
+    WebSocketClient &socket = sockets.client[i];
+    if (!socket.active)
+    {
+      continue;
+    }
+    if (!socket.client.connected())
+    {
+      wsDrop(sockets, socket);
+      continue;
+    }
+
+    FixedString<WS_WEBSOCKET_BUFFER> buffer;
+    if (!wsReceive(sockets, socket, buffer, command))
+    {
+      continue;
+    }
+
+    uint32_t seq = socket.seq;
+    unsigned long sent = 0;
+    byte device, value;
+    while (eventsNext(devices, devicesValues, seq, device, value))
+    {
+      FixedString<WS_EVENT_MAX_LEN> change;
+      DevicesValues &values = devicesValues[devices.devices[device].deviceId];
+      wsFormatChange(change, devices.devices[device], values, value);
+      // 2 bytes of frame header
+      if (buffer.length() + change.length() + 2 > buffer.capacity())
+      {
+        break;
+      }
+      wsFrame(buffer, WS_OPCODE_TEXT, (const byte *)change.c_str(), change.length());
+      seq = values.values[value].seq;
+      sent++;
+    }
+
+    if (buffer.length() == 0)
+    {
+      continue;
+    }
+    if (socket.client.write((const uint8_t *)buffer.c_str(), buffer.length()) != buffer.length())
+    {
+      wsDrop(sockets, socket);
+      continue;
+    }
+    socket.seq = seq;
+    sockets.sent += sent;
+  }
+}
+
+#endif
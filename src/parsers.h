@@ -39,59 +39,112 @@ inline int hex2dec(char c)
 
 inline String decode(String &urlcode)
 {
-  String strcode = "";
-  int i = 0;
+  String strcode;
   int len = urlcode.length();
-  for (i = 0; i < len; ++i)
+  strcode.reserve(len);
+  for (int i = 0; i < len; ++i)
   {
     char c = urlcode[i];
-    if (c != '%')
+    if (c != '%' || i + 2 >= len)
     {
-      strcode += String(c);
+      strcode += c;
     }
     else
     {
       char c1 = urlcode[++i];
       char c0 = urlcode[++i];
-      int num = 0;
-      num = hex2dec(c1) * 16 + hex2dec(c0);
-      strcode += String((char)num);
+      strcode += (char)(hex2dec(c1) * 16 + hex2dec(c0));
     }
   }
   return strcode;
 }
 
+inline bool encodeSafe(char c)
+{
+  return ('0' <= c && c <= '9') || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '/' || c == '.';
+}
+
+// url encode into out buffer, returns encoded length (truncated on whole characters if buffer is too small)
+inline size_t encode(const char *strcode, char *out, size_t outSize)
+{
+  size_t n = 0;
+  for (; *strcode != '\0'; strcode++)
+  {
+    byte c = (byte)*strcode;
+    if (encodeSafe(c))
+    {
+      if (n + 1 >= outSize)
+      {
+        break;
+      }
+      out[n++] = c;
+    }
+    else
+    {
+      if (n + 3 >= outSize)
+      {
+        break;
+      }
+      out[n++] = '%';
+      out[n++] = dec2hex(c >> 4);
+      out[n++] = dec2hex(c & 0x0F);
+    }
+  }
+  out[n] = '\0';
+  return n;
+}
+
 inline String encode(String &strcode)
 {
-  String urlcode = "";
-  int i = 0;
+  String urlcode;
   int len = strcode.length();
-  for (i = 0; i < len; ++i)
+  urlcode.reserve(len * 3);
+  for (int i = 0; i < len; ++i)
   {
-    char c = strcode[i];
-    if (('0' <= c && c <= '9') ||
-        ('a' <= c && c <= 'z') ||
-        ('A' <= c && c <= 'Z') ||
-        c == '/' || c == '.')
+    byte c = (byte)strcode[i];
+    if (encodeSafe(c))
     {
-      urlcode += String(c);
+      urlcode += (char)c;
     }
     else
     {
-      int j = (short int)c;
-      if (j < 0)
-        j += 256;
-      int i1, i0;
-      i1 = j / 16;
-      i0 = j - i1 * 16;
-      urlcode += String('%');
-      urlcode += String((char)dec2hex(i1));
-      urlcode += String((char)dec2hex(i0));
+      urlcode += '%';
+      urlcode += dec2hex(c >> 4);
+      urlcode += dec2hex(c & 0x0F);
     }
   }
   return urlcode;
 }
 
+inline void romToStr(const uint8_t *rom, byte len, char *str)
+{
+  for (byte i = 0; i < len; i++)
+  {
+    str[i * 2] = dec2hex(rom[i] >> 4);
+    str[i * 2 + 1] = dec2hex(rom[i] & 0x0F);
+  }
+  str[len * 2] = '\0';
+}
+
+inline bool romFromStr(const char *str, uint8_t *rom, byte len)
+{
+  if (strlen(str) != (size_t)len * 2)
+  {
+    return false;
+  }
+  for (byte i = 0; i < len; i++)
+  {
+    int c1 = hex2dec(str[i * 2]);
+    int c0 = hex2dec(str[i * 2 + 1]);
+    if (c1 < 0 || c0 < 0)
+    {
+      return false;
+    }
+    rom[i] = c1 * 16 + c0;
+  }
+  return true;
+}
+
 template <typename T>
 inline String serialize(const T &v)
 {
@@ -100,24 +153,32 @@ inline String serialize(const T &v)
   return String(buffer, sizeof(T));
 }
 
-inline String crypt(String strin)
+inline String crypt(const String &strin)
 {
   String strout;
-  for (int i = 0; i < strin.length(); i++)
+  strout.reserve(strin.length());
+  for (unsigned int i = 0; i < strin.length(); i++)
   {
-    char c = strin[i];
-    strout += String((char)(c + 3));
+    strout += (char)(strin[i] + 3);
   }
   return strout;
 }
 
-inline String decrypt(String strin)
+inline void crypt(const char *strin, Print &out)
+{
+  for (; *strin != '\0'; strin++)
+  {
+    out.write((char)(*strin + 3));
+  }
+}
+
+inline String decrypt(const String &strin)
 {
   String strout;
-  for (int i = 0; i < strin.length(); i++)
+  strout.reserve(strin.length());
+  for (unsigned int i = 0; i < strin.length(); i++)
   {
-    char c = strin[i];
-    strout += String((char)(c - 3));
+    strout += (char)(strin[i] - 3);
   }
   return strout;
 }